@@ -0,0 +1,112 @@
+/*************************************************************************
+	> File Name: bench/bench_dtoa.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Number formatting against sprintf, and an exact round
+	               trip of every formatted double through json_parse.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define COUNT 1000000
+#define ROUNDS 5
+
+static uint64_t seed = 88172645463325252ULL;
+
+static uint64_t next_rand(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Random bit patterns, plus prices and coordinates like real exports */
+static double random_double(int i) {
+    double d;
+    if (i % 3 == 0)
+        return (double)(next_rand() % 10000000) / 100.0;
+    if (i % 3 == 1)
+        return ((double)(next_rand() % 360000000) / 1e6) - 180.0;
+    do {
+        uint64_t bits = next_rand();
+        memcpy(&d, &bits, sizeof(d));
+    } while (d != d || d - d != 0);
+    return d;
+}
+
+int main(void) {
+    double *nums = (double *)malloc(sizeof(double) * COUNT);
+    int *ints = (int *)malloc(sizeof(int) * COUNT);
+    for (int i = 0; i < COUNT; i++) {
+        nums[i] = random_double(i);
+        ints[i] = (int)next_rand();
+    }
+    JNODE_p doubles = json_double_array(nums, COUNT);
+    JNODE_p integers = json_int_array(ints, COUNT);
+
+    size_t cap = 0;
+    json_format_into(doubles, NULL, 0, &cap);
+    char *text = (char *)malloc(cap);
+    char tmp[64];
+    double best_sprintf = 1e30, best_format = 1e30, best_isprintf = 1e30, best_iformat = 1e30;
+    size_t sprintf_bytes = 0;
+
+    for (int r = 0; r < ROUNDS; r++) {
+        double t = now();
+        sprintf_bytes = 0;
+        for (int i = 0; i < COUNT; i++)
+            sprintf_bytes += sprintf(tmp, "%.17g", nums[i]);
+        t = now() - t;
+        if (t < best_sprintf) best_sprintf = t;
+
+        t = now();
+        json_format_into(doubles, text, cap, NULL);
+        t = now() - t;
+        if (t < best_format) best_format = t;
+
+        t = now();
+        for (int i = 0; i < COUNT; i++)
+            sprintf(tmp, "%d", ints[i]);
+        t = now() - t;
+        if (t < best_isprintf) best_isprintf = t;
+
+        t = now();
+        json_format_into(integers, text, cap, NULL);
+        t = now() - t;
+        if (t < best_iformat) best_iformat = t;
+    }
+
+    printf("doubles:  sprintf %%.17g %6.1f ns/op, json_format_into %6.1f ns/op (%.2fx)\n",
+           best_sprintf * 1e9 / COUNT, best_format * 1e9 / COUNT, best_sprintf / best_format);
+    printf("integers: sprintf %%d    %6.1f ns/op, json_format_into %6.1f ns/op (%.2fx)\n",
+           best_isprintf * 1e9 / COUNT, best_iformat * 1e9 / COUNT, best_isprintf / best_iformat);
+
+    /* Round trip: every double must come back bit for bit */
+    json_format_into(doubles, text, cap, NULL);
+    JNODE_p back = json_parse(text);
+    long mismatch = 0;
+    JNODE_p a = doubles->child, b = back ? back->child : NULL;
+    for (; a && b; a = a->next, b = b->next)
+        if (b->type != J_Double || memcmp(&a->value.double_val, &b->value.double_val, sizeof(double)))
+            mismatch++;
+    printf("round trip: %ld mismatches of %d, %.1f bytes/number vs %.1f with %%.17g\n",
+           mismatch + (a || b), COUNT, (double)(strlen(text) - 2 * COUNT) / COUNT,
+           (double)sprintf_bytes / COUNT);
+
+    json_delete(back);
+    json_delete(doubles);
+    json_delete(integers);
+    free(text);
+    free(nums);
+    free(ints);
+    return mismatch != 0;
+}
@@ -0,0 +1,83 @@
+/*************************************************************************
+	> File Name: bench/bench_engine.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Recursive descent against the two stage parser, on
+	               compact and indented text, with every SIMD level.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define RECORDS 50000
+#define ROUNDS 10
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Records with numbers, short strings, a nested object and an array */
+static char *make_text(int indent) {
+    size_t cap = (size_t)RECORDS * 400, n = 0;
+    char *text = (char *)malloc(cap);
+    const char *nl = indent ? "\n\t\t" : "";
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s%s{%s\"id\": %d,%s\"name\": \"user-%d\",%s\"email\": \"u%d@example.com\","
+                      "%s\"score\": %d.%02d,%s\"active\": %s,%s\"tags\": [\"a\", \"bb\", \"ccc\"],"
+                      "%s\"geo\": {\"lat\": %d.5, \"lon\": -%d.25},%s\"note\": \"say \\\"hi\\\"\"}",
+                      i ? "," : "", indent ? "\n\t" : "", nl, i, nl, i, nl, i, nl, i % 1000, i % 100,
+                      nl, i % 3 ? "true" : "false", nl, nl, i % 90, i % 180, nl);
+    n += snprintf(text + n, cap - n, "%s]", indent ? "\n" : "");
+    return text;
+}
+
+/* Rounds alternate between the engines so both see the same machine state */
+static void best_of(const char *text, double best[2]) {
+    const int engines[2] = {JSON_ENGINE_DESCENT, JSON_ENGINE_INDEX};
+    best[0] = best[1] = 1e30;
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int e = 0; e < 2; e++) {
+            JARENA_p arena = json_arena_create(strlen(text));
+            json_engine_select(engines[e]);
+            double t = now();
+            JNODE_p root = json_parse_arena(text, arena);
+            t = now() - t;
+            if (!root)
+                printf("  parse failed\n");
+            json_arena_destroy(arena);
+            if (t < best[e]) best[e] = t;
+        }
+    }
+}
+
+static void run(const char *title, char *text) {
+    size_t len = strlen(text);
+    const char *names[] = {"scalar", "sse2", "avx2"};
+
+    printf("%s: %zu bytes, arena, best of %d\n", title, len, ROUNDS);
+    for (int level = SIMD_SCALAR; level <= SIMD_AVX2; level++) {
+        if (json_simd_select(level) != level) {
+            printf("  %-8s unsupported\n", names[level]);
+            continue;
+        }
+        double best[2];
+        best_of(text, best);
+        printf("  %-8s descent %8.1f MB/s  index %8.1f MB/s  %.2fx\n", names[level],
+               len / best[0] / 1e6, len / best[1] / 1e6, best[0] / best[1]);
+    }
+    json_engine_select(JSON_ENGINE_DESCENT);
+    json_simd_select(SIMD_AVX2);
+    free(text);
+}
+
+int main(void) {
+    run("compact records", make_text(0));
+    run("indented records", make_text(1));
+    return 0;
+}
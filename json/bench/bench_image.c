@@ -0,0 +1,90 @@
+/*************************************************************************
+	> File Name: bench/bench_image.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Start up cost of a large reference document: reading and
+	               parsing its text against opening its saved image, and
+	               the first lookup after each.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <unistd.h>
+#include "cjson.h"
+
+#define RECORDS 500000
+#define ROUNDS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(void) {
+    size_t cap = (size_t)RECORDS * 200, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "{\"version\":3,\"records\":[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s{\"id\":%d,\"user\":\"user-%d\",\"score\":%d.%02d,\"tags\":[\"a\",\"b\",\"c\"],"
+                      "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"ok\":%s}",
+                      i ? "," : "", i, i, i % 1000, i % 100, i % 90, i % 180, i % 3 ? "true" : "false");
+    n += snprintf(text + n, cap - n, "]}");
+    return text;
+}
+
+int main(void) {
+    char text_path[] = "/tmp/bench_image_XXXXXX", image_path[] = "/tmp/bench_image_XXXXXX";
+    int text_fd = mkstemp(text_path), image_fd = mkstemp(image_path);
+    char *text = make_text();
+    size_t len = strlen(text);
+    double best[3] = {1e30, 1e30, 1e30}, check[2] = {0};
+
+    if (text_fd < 0 || image_fd < 0 || write(text_fd, text, len) != (ssize_t)len)
+        return 1;
+    close(text_fd);
+    close(image_fd);
+    JNODE_p root = json_parse(text);
+    double t = now();
+    json_save_image(root, image_path);
+    double save = now() - t;
+    json_delete(root);
+
+    for (int r = 0; r < ROUNDS; r++) {
+        JARENA_p arena = json_arena_create(len);
+        t = now();
+        JNODE_p doc = json_read_r(text_path, arena, NULL);
+        JNODE_p last = json_array_get(json_object_get(doc, "records"), RECORDS - 1);
+        check[0] = json_object_get(last, "score")->value.double_val;
+        if ((t = now() - t) < best[0]) best[0] = t;
+        json_arena_destroy(arena);
+
+        t = now();
+        JTAPE_p image = json_open_image(image_path);
+        size_t records = json_tape_get(image, 0, "records");
+        size_t at = json_tape_index(image, records, RECORDS - 1);
+        check[1] = json_tape_double(image, json_tape_get(image, at, "score"));
+        if ((t = now() - t) < best[1]) best[1] = t;
+        json_tape_free(image);
+
+        /* The cheapest case: one member of the root */
+        t = now();
+        image = json_open_image(image_path);
+        check[1] += json_tape_int64(image, json_tape_get(image, 0, "version")) - 3;
+        if ((t = now() - t) < best[2]) best[2] = t;
+        json_tape_free(image);
+    }
+
+    printf("image: %d records, %zu bytes of text, saved in %.1f ms, best of %d\n", RECORDS, len, save * 1e3, ROUNDS);
+    printf("  read + parse + lookup     %9.3f ms\n", best[0] * 1e3);
+    printf("  open image + last record  %9.3f ms  %8.0fx\n", best[1] * 1e3, best[0] / best[1]);
+    printf("  open image + root member  %9.3f ms  %8.0fx\n", best[2] * 1e3, best[0] / best[2]);
+    if (check[0] != check[1])
+        printf("  results differ\n");
+    unlink(text_path);
+    unlink(image_path);
+    free(text);
+    return 0;
+}
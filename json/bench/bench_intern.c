@@ -0,0 +1,91 @@
+/*************************************************************************
+	> File Name: bench/bench_intern.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Memory and load time of a document of many records with
+	               the same keys, member names copied per node against
+	               names interned in a pool, and member lookup on both.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define RECORDS 200000
+#define ROUNDS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(size_t *len) {
+    size_t cap = (size_t)RECORDS * 260, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s{\"identifier\":%d,\"user_name\":\"user-%d\",\"account_score\":%d.%02d,"
+                      "\"location\":{\"latitude\":%d.5,\"longitude\":-%d.25},\"is_active\":%s,"
+                      "\"created_timestamp\":%d}",
+                      i ? "," : "", i, i, i % 1000, i % 100, i % 90, i % 180,
+                      i % 3 ? "true" : "false", 1600000000 + i);
+    n += snprintf(text + n, cap - n, "]");
+    *len = n;
+    return text;
+}
+
+/* With a pool the keys are interned too, and match on the address */
+static double lookups(JNODE_p root, JPOOL_p pool) {
+    const char *location = pool ? json_pool_intern(pool, "location") : "location";
+    const char *created = pool ? json_pool_intern(pool, "created_timestamp") : "created_timestamp";
+    const char *longitude = pool ? json_pool_intern(pool, "longitude") : "longitude";
+    double sum = 0;
+    for (JNODE_p rec = root->child; rec; rec = rec->next) {
+        JNODE_p geo = json_object_get(rec, location);
+        sum += json_object_get(rec, created)->value.int_val;
+        sum += json_object_get(geo, longitude)->value.double_val;
+    }
+    return sum;
+}
+
+int main(void) {
+    size_t len = 0;
+    char *text = make_text(&len);
+    double parse[2] = {1e30, 1e30}, get[2] = {1e30, 1e30}, check[2] = {0};
+    size_t used[2] = {0}, names = 0, bytes = 0;
+
+    printf("intern: %d records, %zu bytes, arena, best of %d\n", RECORDS, len, ROUNDS);
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int interned = 0; interned < 2; interned++) {
+            JARENA_p arena = json_arena_create(len);
+            JPOOL_p pool = interned ? json_pool_create() : NULL;
+            if (pool)
+                json_arena_intern(arena, pool);
+            double t = now();
+            JNODE_p root = json_parse_arena(text, arena);
+            if ((t = now() - t) < parse[interned]) parse[interned] = t;
+            t = now();
+            check[interned] = lookups(root, pool);
+            if ((t = now() - t) < get[interned]) get[interned] = t;
+            json_arena_stats(arena, NULL, &used[interned], NULL);
+            if (pool) {
+                json_pool_stats(pool, &names, &bytes);
+                used[interned] += bytes;
+            }
+            json_arena_destroy(arena);
+            json_pool_free(pool);
+        }
+    }
+    printf("  copied    %10zu bytes  parse %7.2f ms  lookup %6.2f ms\n", used[0], parse[0] * 1e3, get[0] * 1e3);
+    printf("  interned  %10zu bytes  parse %7.2f ms  lookup %6.2f ms  (%zu names)\n", used[1], parse[1] * 1e3,
+           get[1] * 1e3, names);
+    printf("  %.2fx less memory, parse %.2fx, lookup %.2fx\n", (double)used[0] / used[1], parse[0] / parse[1],
+           get[0] / get[1]);
+    if (check[0] != check[1])
+        printf("  results differ\n");
+    free(text);
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*************************************************************************
+	> File Name: bench/bench_msgpack.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: One document through the text path, json_format and
+	               json_parse, against MessagePack, json_msgpack and
+	               json_msgpack_parse: bytes on the wire and time each way.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define RECORDS 200000
+#define ROUNDS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(void) {
+    size_t cap = (size_t)RECORDS * 220, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s{\"id\":%d,\"user\":\"user-%d\",\"score\":%d.%02d,\"tags\":[\"a\",\"b\",\"c\"],"
+                      "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"ok\":%s,\"ts\":%lld}",
+                      i ? "," : "", i, i, i % 1000, i % 100, i % 90, i % 180, i % 3 ? "true" : "false",
+                      1600000000000LL + i);
+    n += snprintf(text + n, cap - n, "]");
+    return text;
+}
+
+int main(void) {
+    char *text = make_text();
+    JNODE_p root = json_parse(text);
+    size_t len = 0;
+    char *packed = json_msgpack(root, &len), *formatted = json_format(root);
+    size_t text_len = strlen(formatted);
+    double best[6] = {1e30, 1e30, 1e30, 1e30, 1e30, 1e30};
+
+    for (int r = 0; r < ROUNDS; r++) {
+        double t = now();
+        char *out = json_format(root);
+        if ((t = now() - t) < best[0]) best[0] = t;
+        free(out);
+        t = now();
+        out = json_msgpack(root, NULL);
+        if ((t = now() - t) < best[1]) best[1] = t;
+        free(out);
+
+        t = now();
+        JNODE_p doc = json_parse(formatted);
+        if ((t = now() - t) < best[2]) best[2] = t;
+        json_delete(doc);
+        t = now();
+        doc = json_msgpack_parse(packed, len, NULL, NULL);
+        if ((t = now() - t) < best[3]) best[3] = t;
+        json_delete(doc);
+
+        JARENA_p arena = json_arena_create(text_len);
+        t = now();
+        (void)json_parse_arena(formatted, arena);
+        if ((t = now() - t) < best[4]) best[4] = t;
+        json_arena_destroy(arena);
+        arena = json_arena_create(text_len);
+        t = now();
+        (void)json_msgpack_parse(packed, len, arena, NULL);
+        if ((t = now() - t) < best[5]) best[5] = t;
+        json_arena_destroy(arena);
+    }
+
+    printf("msgpack: %d records, best of %d\n", RECORDS, ROUNDS);
+    printf("  size          text %10zu bytes  msgpack %10zu bytes  %.2fx smaller\n", text_len, len,
+           (double)text_len / len);
+    printf("  encode        text %8.2f ms  msgpack %8.2f ms  %.2fx\n", best[0] * 1e3, best[1] * 1e3, best[0] / best[1]);
+    printf("  decode heap   text %8.2f ms  msgpack %8.2f ms  %.2fx\n", best[2] * 1e3, best[3] * 1e3, best[2] / best[3]);
+    printf("  decode arena  text %8.2f ms  msgpack %8.2f ms  %.2fx\n", best[4] * 1e3, best[5] * 1e3, best[4] / best[5]);
+
+    json_delete(root);
+    free(formatted);
+    free(packed);
+    free(text);
+    return 0;
+}
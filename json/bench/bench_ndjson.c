@@ -0,0 +1,83 @@
+/*************************************************************************
+	> File Name: bench/bench_ndjson.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: NDJSON records per second, json_parse line by line on
+	               one core against json_ndjson_parse on 1..N threads.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <unistd.h>
+#include "cjson.h"
+
+#define RECORDS 500000
+#define ROUNDS 3
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_lines(size_t *len) {
+    size_t cap = (size_t)RECORDS * 160, n = 0;
+    char *text = (char *)malloc(cap);
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "{\"id\":%d,\"user\":\"user-%d\",\"score\":%d.%02d,\"tags\":[\"a\",\"b\",\"c\"],"
+                      "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"ok\":%s}\n",
+                      i, i, i % 1000, i % 100, i % 90, i % 180, i % 3 ? "true" : "false");
+    *len = n;
+    return text;
+}
+
+/* What callers did before: split the lines and json_parse each one */
+static double line_by_line(const char *text, size_t len) {
+    char line[512];
+    double t = now();
+    for (const char *p = text, *end = text + len; p < end;) {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        size_t n = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        memcpy(line, p, n);
+        line[n] = 0;
+        json_delete(json_parse(line));
+        p += n + 1;
+    }
+    return now() - t;
+}
+
+int main(void) {
+    size_t len = 0;
+    char *text = make_lines(&len);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    double base = 1e30;
+
+    printf("ndjson: %d records, %zu bytes, %ld cores, best of %d\n", RECORDS, len, cores, ROUNDS);
+    for (int r = 0; r < ROUNDS; r++) {
+        double t = line_by_line(text, len);
+        if (t < base) base = t;
+    }
+    printf("  %-12s %8.1f ms %8.1f MB/s %6.2f Mrec/s\n", "json_parse", base * 1e3,
+           len / base / 1e6, RECORDS / base / 1e6);
+
+    for (long threads = 1; threads <= (cores > 1 ? cores : 2); threads *= 2) {
+        double best = 1e30;
+        for (int r = 0; r < ROUNDS; r++) {
+            double t = now();
+            JBATCH_p batch = json_ndjson_parse(text, len, (int)threads);
+            t = now() - t;
+            if (json_batch_size(batch) != RECORDS)
+                printf("  wrong record count\n");
+            json_batch_free(batch);
+            if (t < best) best = t;
+        }
+        printf("  %2ld threads   %8.1f ms %8.1f MB/s %6.2f Mrec/s  %5.2fx\n", threads, best * 1e3,
+               len / best / 1e6, RECORDS / best / 1e6, base / best);
+        if (threads < cores && threads * 2 > cores)
+            threads = cores / 2;  // finish on the core count itself
+    }
+    free(text);
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*************************************************************************
+	> File Name: bench/bench_simd.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Parse throughput of the scalar, SSE2 and AVX2 scanners
+	               on the tab indented text json_format produces.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define RECORDS 20000
+#define ROUNDS 20
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Nested records with short keys and a mix of short and long strings */
+static char *make_text(void) {
+    char text[256];
+    JNODE_p root = create_array();
+    for (int i = 0; i < RECORDS; i++) {
+        JNODE_p rec = create_object();
+        JNODE_p tags = create_object();
+        json_add_int(rec, "id", i);
+        snprintf(text, sizeof(text), "user-%d", i);
+        json_add_string(rec, "name", text);
+        snprintf(text, sizeof(text), "Lorem ipsum dolor sit amet, consectetur adipiscing "
+                 "elit, sed do eiusmod tempor incididunt ut labore %d \"et\" dolore", i);
+        json_add_string(rec, "about", text);
+        json_add_true(tags, "active");
+        json_add_string(tags, "group", "benchmark");
+        json_add_to_object(rec, "tags", tags, 1);
+        json_add_to_array(root, rec);
+    }
+    char *out = json_format(root);
+    json_delete(root);
+    return out;
+}
+
+/* Few large strings, where the string scanner dominates */
+static char *make_strings(void) {
+    char text[2048];
+    JNODE_p root = create_array();
+    for (int i = 0; i < RECORDS / 10; i++) {
+        for (size_t j = 0; j < sizeof(text) - 1; j++)
+            text[j] = 'a' + (i + j) % 26;
+        text[sizeof(text) - 1] = 0;
+        json_add_to_array(root, create_string(text));
+    }
+    char *out = json_format(root);
+    json_delete(root);
+    return out;
+}
+
+static void run(const char *title, char *text) {
+    size_t len = strlen(text);
+    const char *names[] = {"scalar", "sse2", "avx2"};
+    double base = 0;
+
+    printf("%s: %zu bytes, best of %d\n", title, len, ROUNDS);
+    for (int level = SIMD_SCALAR; level <= SIMD_AVX2; level++) {
+        if (json_simd_select(level) != level) {
+            printf("  %-8s unsupported\n", names[level]);
+            continue;
+        }
+        double best = 1e30, arena_best = 1e30;
+        for (int r = 0; r < ROUNDS; r++) {
+            double t = now();
+            JNODE_p root = json_parse(text);
+            t = now() - t;
+            json_delete(root);
+            if (t < best) best = t;
+
+            JARENA_p arena = json_arena_create(len);
+            t = now();
+            (void)json_parse_arena(text, arena);
+            t = now() - t;
+            json_arena_destroy(arena);
+            if (t < arena_best) arena_best = t;
+        }
+        if (level == SIMD_SCALAR) base = best;
+        printf("  %-8s parse %8.1f MB/s  arena %8.1f MB/s  speedup %.2fx\n", names[level],
+               len / best / 1e6, len / arena_best / 1e6, base / best);
+    }
+    json_simd_select(SIMD_AVX2);
+    free(text);
+}
+
+int main(void) {
+    run("indented records", make_text());
+    run("long strings", make_strings());
+    return 0;
+}
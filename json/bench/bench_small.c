@@ -0,0 +1,76 @@
+/*************************************************************************
+	> File Name: bench/bench_small.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Heap documents of short keys and values: parse, member
+	               access and delete, and what the same document takes in
+	               an arena.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define RECORDS 200000
+#define ROUNDS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(size_t *len) {
+    size_t cap = (size_t)RECORDS * 200, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s{\"id\":%d,\"user\":\"u%d\",\"kind\":\"%s\",\"tags\":[\"a\",\"bb\",\"ccc\"],"
+                      "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"state\":\"%s\"}",
+                      i ? "," : "", i, i % 100000, i % 2 ? "read" : "write", i % 90, i % 180,
+                      i % 3 ? "open" : "closed");
+    n += snprintf(text + n, cap - n, "]");
+    *len = n;
+    return text;
+}
+
+static size_t walk(JNODE_p root) {
+    size_t sum = 0;
+    for (JNODE_p rec = root->child; rec; rec = rec->next) {
+        sum += strlen(json_object_get(rec, "user")->value.string_val);
+        sum += json_object_get(rec, "state")->value.string_val[0];
+        sum += json_object_get(json_object_get(rec, "geo"), "lon") != NULL;
+    }
+    return sum;
+}
+
+int main(void) {
+    size_t len = 0, used = 0, check = 0;
+    char *text = make_text(&len);
+    double best[3] = {1e30, 1e30, 1e30};
+
+    for (int r = 0; r < ROUNDS; r++) {
+        double t = now();
+        JNODE_p root = json_parse(text);
+        if ((t = now() - t) < best[0]) best[0] = t;
+        t = now();
+        check = walk(root);
+        if ((t = now() - t) < best[1]) best[1] = t;
+        t = now();
+        json_delete(root);
+        if ((t = now() - t) < best[2]) best[2] = t;
+    }
+    JARENA_p arena = json_arena_create(len);
+    (void)json_parse_arena(text, arena);
+    json_arena_stats(arena, NULL, &used, NULL);
+    json_arena_destroy(arena);
+
+    printf("small: %d records, %zu bytes, %zu byte nodes, best of %d\n", RECORDS, len, sizeof(JNODE_t), ROUNDS);
+    printf("  heap   parse %7.2f ms  access %6.2f ms  delete %6.2f ms  (%zu)\n", best[0] * 1e3, best[1] * 1e3,
+           best[2] * 1e3, check);
+    printf("  arena  %zu bytes used\n", used);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*************************************************************************
+	> File Name: bench/bench_split.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Load time of one large top level array, json_parse_arena
+	               on one core against json_parse_parallel on 1..N threads.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <unistd.h>
+#include "cjson.h"
+
+#define RECORDS 500000
+#define ROUNDS 3
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(size_t *len) {
+    size_t cap = (size_t)RECORDS * 160, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s\n{\"id\":%d,\"user\":\"user-%d\",\"score\":%d.%02d,\"tags\":[\"a\",\"b\",\"c\"],"
+                      "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"ok\":%s}",
+                      i ? "," : "", i, i, i % 1000, i % 100, i % 90, i % 180, i % 3 ? "true" : "false");
+    n += snprintf(text + n, cap - n, "\n]");
+    *len = n;
+    return text;
+}
+
+int main(void) {
+    size_t len = 0;
+    char *text = make_text(&len);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    double base = 1e30;
+
+    printf("split: %d elements, %zu bytes, %ld cores, arena, best of %d\n", RECORDS, len, cores, ROUNDS);
+    for (int r = 0; r < ROUNDS; r++) {
+        JARENA_p arena = json_arena_create(len);
+        double t = now();
+        (void)json_parse_arena(text, arena);
+        t = now() - t;
+        json_arena_destroy(arena);
+        if (t < base) base = t;
+    }
+    printf("  %-12s %8.1f ms %8.1f MB/s\n", "json_parse", base * 1e3, len / base / 1e6);
+
+    for (long threads = 1; threads <= (cores > 1 ? cores : 2); threads *= 2) {
+        double best = 1e30;
+        for (int r = 0; r < ROUNDS; r++) {
+            JARENA_p arena = json_arena_create(len);
+            double t = now();
+            JNODE_p root = json_parse_parallel(text, NULL, arena, (int)threads, NULL);
+            t = now() - t;
+            if (json_array_size(root) != RECORDS)
+                printf("  wrong element count\n");
+            json_arena_destroy(arena);
+            if (t < best) best = t;
+        }
+        printf("  %2ld threads   %8.1f ms %8.1f MB/s  %5.2fx\n", threads, best * 1e3,
+               len / best / 1e6, base / best);
+        if (threads < cores && threads * 2 > cores)
+            threads = cores / 2;  // finish on the core count itself
+    }
+    free(text);
+    return 0;
+}
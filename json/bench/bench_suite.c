@@ -0,0 +1,264 @@
+/*************************************************************************
+	> File Name: bench/bench_suite.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Throughput over generated corpora of different shapes:
+	               parse and format in MB/s, lookup and delete in ns/op,
+	               with the allocations each makes. Linked against the
+	               optimized library, see make lib and make pgo.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "cjson.h"
+
+#define ROUNDS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Allocations made inside the library, on the workers of the parallel
+   parsers too */
+static JMEMSTATS_t counts;
+
+static void count_reset(void) {
+    json_mem_stats(NULL, 1);
+}
+
+static void count_read(size_t *allocs, size_t *bytes) {
+    json_mem_stats(&counts, 0);
+    *allocs = counts.allocs;
+    *bytes = counts.bytes;
+}
+
+/* Corpora */
+typedef struct Text {
+    char *buf;
+    size_t len, cap;
+} TEXT_t;
+
+static void put(TEXT_t *t, const char *fmt, ...) {
+    va_list ap;
+    for (;;) {
+        va_start(ap, fmt);
+        int n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, ap);
+        va_end(ap);
+        if ((size_t)n < t->cap - t->len) {
+            t->len += n;
+            return;
+        }
+        t->cap = t->cap * 2 + n;
+        t->buf = (char *)realloc(t->buf, t->cap);
+    }
+}
+
+#define WIDE_RECORDS 20000
+#define WIDE_FIELDS 48
+#define DEEP_ITEMS 2000
+#define DEEP_LEVELS 200
+#define NUMBERS 1000000
+#define ESCAPED 200000
+#define LARGE_RECORDS 600000
+
+static void gen_wide(TEXT_t *t) {
+    put(t, "[");
+    for (int i = 0; i < WIDE_RECORDS; i++) {
+        put(t, "%s{", i ? "," : "");
+        for (int f = 0; f < WIDE_FIELDS; f++) {
+            const char *sep = f ? "," : "";
+            switch (f % 4) {
+                case 0: put(t, "%s\"field_%02d\":%d", sep, f, i * f); break;
+                case 1: put(t, "%s\"field_%02d\":\"value %d of %d\"", sep, f, f, i); break;
+                case 2: put(t, "%s\"field_%02d\":%s", sep, f, (i + f) % 2 ? "true" : "null"); break;
+                default: put(t, "%s\"field_%02d\":%d.%03d", sep, f, i, f); break;
+            }
+        }
+        put(t, "}");
+    }
+    put(t, "]");
+}
+
+static void gen_deep(TEXT_t *t) {
+    put(t, "[");
+    for (int i = 0; i < DEEP_ITEMS; i++) {
+        put(t, "%s", i ? "," : "");
+        for (int d = 0; d < DEEP_LEVELS; d++)
+            put(t, "{\"a\":");
+        put(t, "{\"v\":%d}", i);
+        for (int d = 0; d < DEEP_LEVELS; d++)
+            put(t, "}");
+    }
+    put(t, "]");
+}
+
+static void gen_numeric(TEXT_t *t) {
+    put(t, "[");
+    for (int i = 0; i < NUMBERS; i++) {
+        const char *sep = i ? "," : "";
+        switch (i % 4) {
+            case 0: put(t, "%s%d", sep, i * 7919); break;
+            case 1: put(t, "%s-%d.%06d", sep, i % 1000, i); break;
+            case 2: put(t, "%s%d.%de-%d", sep, i % 10, i % 997, i % 300); break;
+            default: put(t, "%s%lld", sep, 1600000000000LL + i); break;
+        }
+    }
+    put(t, "]");
+}
+
+static void gen_escape(TEXT_t *t) {
+    put(t, "[");
+    for (int i = 0; i < ESCAPED; i++)
+        put(t, "%s\"line %d\\nnext \\\"quoted\\\"\\ttab \\u00e9\\u4e2d\\\\path\\/%d\\r\"", i ? "," : "", i, i);
+    put(t, "]");
+}
+
+static void gen_large(TEXT_t *t) {
+    put(t, "{\"version\":3,\"records\":[");
+    for (int i = 0; i < LARGE_RECORDS; i++)
+        put(t, "%s{\"id\":%d,\"user\":\"user-%d\",\"score\":%d.%02d,\"tags\":[\"a\",\"b\",\"c\"],"
+               "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"ok\":%s}",
+            i ? "," : "", i, i, i % 1000, i % 100, i % 90, i % 180, i % 3 ? "true" : "false");
+    put(t, "]}");
+}
+
+/* Lookups, each returns the number of operations done */
+static size_t look_wide(JNODE_p root) {
+    size_t ops = 0;
+    for (size_t i = 0; i < WIDE_RECORDS; i++, ops += 2) {
+        JNODE_p rec = json_array_get(root, i);
+        if (!json_object_get(rec, "field_47") || !json_object_get(rec, "field_00"))
+            printf("  lookup failed\n");
+    }
+    return ops;
+}
+
+static size_t look_deep(JNODE_p root) {
+    size_t ops = 0;
+    for (size_t i = 0; i < DEEP_ITEMS; i++) {
+        JNODE_p node = json_array_get(root, i);
+        for (int d = 0; d < DEEP_LEVELS; d++, ops++)
+            node = json_object_get(node, "a");
+        if (!json_object_get(node, "v"))
+            printf("  lookup failed\n");
+    }
+    return ops;
+}
+
+static size_t look_array(JNODE_p root) {
+    size_t n = json_array_size(root), ops = 0;
+    for (size_t i = 0; i < n; i += 7, ops++)
+        if (!json_array_get(root, i))
+            printf("  lookup failed\n");
+    return ops;
+}
+
+static size_t look_large(JNODE_p root) {
+    JNODE_p records = json_object_get(root, "records");
+    size_t ops = 1;
+    for (size_t i = 0; i < LARGE_RECORDS; i += 101, ops += 2)
+        if (!json_object_get(json_array_get(records, i), "score"))
+            printf("  lookup failed\n");
+    return ops;
+}
+
+static size_t count_nodes(JNODE_p node) {
+    size_t n = 1;
+    for (JNODE_p c = node->child; c; c = c->next)
+        n += count_nodes(c);
+    return n;
+}
+
+typedef struct Corpus {
+    const char *name;
+    void (*gen)(TEXT_t *);
+    size_t (*lookup)(JNODE_p);
+    int from_file;  // parse with json_read_r
+} CORPUS_t;
+
+static JNODE_p parse(const CORPUS_t *c, const TEXT_t *t, const char *path) {
+    return c->from_file ? json_read_r(path, NULL, NULL) : json_parse(t->buf);
+}
+
+static void run(const CORPUS_t *c) {
+    TEXT_t t = {NULL, 0, 0};
+    char path[] = "/tmp/bench_suite_XXXXXX";
+    double best[4] = {1e30, 1e30, 1e30, 1e30};
+    size_t out_len = 0, nodes = 0, ops = 0, a[3] = {0}, b[3] = {0}, f = 0;
+
+    c->gen(&t);
+    if (c->from_file) {
+        int fd = mkstemp(path);
+        if (fd < 0 || write(fd, t.buf, t.len) != (ssize_t)t.len)
+            return;
+        close(fd);
+    }
+    for (int r = 0; r < ROUNDS; r++) {
+        count_reset();
+        double s = now();
+        JNODE_p root = parse(c, &t, path);
+        if ((s = now() - s) < best[0]) best[0] = s;
+        count_read(&a[0], &b[0]);
+        if (!root) {
+            printf("  %-8s parse failed\n", c->name);
+            break;
+        }
+
+        count_reset();
+        s = now();
+        char *out = json_format(root);
+        if ((s = now() - s) < best[1]) best[1] = s;
+        count_read(&a[1], &b[1]);
+        out_len = strlen(out);
+        json_free(out);
+
+        count_reset();
+        s = now();
+        ops = c->lookup(root);
+        if ((s = now() - s) < best[2]) best[2] = s;
+        count_read(&a[2], &b[2]);
+
+        nodes = count_nodes(root);
+        count_reset();
+        s = now();
+        json_delete(root);
+        if ((s = now() - s) < best[3]) best[3] = s;
+        json_mem_stats(&counts, 0);
+        f = counts.frees;
+    }
+
+    printf("%-8s %7.1f MB  %9zu nodes\n", c->name, t.len / 1e6, nodes);
+    printf("  parse   %8.1f MB/s %8.1f ns/node  %9zu allocs %10zu bytes\n", t.len / best[0] / 1e6,
+           best[0] * 1e9 / nodes, a[0], b[0]);
+    printf("  format  %8.1f MB/s %8.1f ns/node  %9zu allocs %10zu bytes\n", out_len / best[1] / 1e6,
+           best[1] * 1e9 / nodes, a[1], b[1]);
+    printf("  lookup  %8.1f ns/op  %9zu ops      %9zu allocs %10zu bytes\n", best[2] * 1e9 / ops, ops, a[2], b[2]);
+    printf("  delete  %8.1f ns/node                 %9zu frees\n", best[3] * 1e9 / nodes, f);
+    if (c->from_file)
+        unlink(path);
+    free(t.buf);
+}
+
+int main(int argc, char **argv) {
+    static const CORPUS_t corpora[] = {
+        {"wide", gen_wide, look_wide, 0},
+        {"deep", gen_deep, look_deep, 0},
+        {"numeric", gen_numeric, look_array, 0},
+        {"escape", gen_escape, look_array, 0},
+        {"large", gen_large, look_large, 1},
+    };
+    printf("suite: best of %d, parse from memory, large from a file\n", ROUNDS);
+    for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+        int wanted = argc < 2;  // or only the corpora named
+        for (int k = 1; k < argc; k++)
+            wanted |= !strcmp(argv[k], corpora[i].name);
+        if (wanted)
+            run(&corpora[i]);
+    }
+    return 0;
+}
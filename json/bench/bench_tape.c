@@ -0,0 +1,115 @@
+/*************************************************************************
+	> File Name: bench/bench_tape.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Footprint and traversal speed of a parsed document as a
+	               node tree in an arena against the same document as a
+	               tape.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define RECORDS 200000
+#define ROUNDS 10
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(void) {
+    size_t cap = (size_t)RECORDS * 200, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s{\"id\":%d,\"user\":\"user-%d\",\"score\":%d.%02d,\"tags\":[\"a\",\"b\",\"c\"],"
+                      "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"ok\":%s}",
+                      i ? "," : "", i, i, i % 1000, i % 100, i % 90, i % 180, i % 3 ? "true" : "false");
+    n += snprintf(text + n, cap - n, "]");
+    return text;
+}
+
+/* Every number in the document */
+static double tree_sum(JNODE_p node) {
+    double sum = 0;
+    switch (node->type & 0xFF) {
+        case J_Int: return node->value.int_val;
+        case J_Int64: return (double)node->value.int64_val;
+        case J_Double: return node->value.double_val;
+        default: break;
+    }
+    for (JNODE_p c = node->child; c; c = c->next)
+        sum += tree_sum(c);
+    return sum;
+}
+
+static double tape_sum(JTAPE_p tape, size_t at) {
+    double sum = 0;
+    int type = json_tape_type(tape, at);
+    if (type == J_Int || type == J_Int64 || type == J_Double)
+        return json_tape_double(tape, at);
+    for (size_t c = json_tape_first(tape, at); c != JTAPE_END; c = json_tape_next(tape, c))
+        sum += tape_sum(tape, c);
+    return sum;
+}
+
+/* One member of every record, the rest skipped */
+static double tree_field(JNODE_p root) {
+    double sum = 0;
+    for (JNODE_p rec = root->child; rec; rec = rec->next) {
+        JNODE_p score = json_object_get(rec, "score");
+        sum += score ? score->value.double_val : 0;
+    }
+    return sum;
+}
+
+static double tape_field(JTAPE_p tape) {
+    double sum = 0;
+    for (size_t rec = json_tape_first(tape, 0); rec != JTAPE_END; rec = json_tape_next(tape, rec))
+        sum += json_tape_double(tape, json_tape_get(tape, rec, "score"));
+    return sum;
+}
+
+int main(void) {
+    char *text = make_text();
+    size_t len = strlen(text), used = 0, words = 0, bytes = 0;
+    JARENA_p arena = json_arena_create(len);
+    JNODE_p root = json_parse_arena(text, arena);
+    JTAPE_p tape = json_tape_from_tree(root);
+    double best[4] = {1e30, 1e30, 1e30, 1e30}, check[4] = {0};
+
+    json_arena_stats(arena, NULL, &used, NULL);
+    json_tape_stats(tape, &words, &bytes);
+    printf("tape: %d records, %zu bytes of text, best of %d\n", RECORDS, len, ROUNDS);
+    printf("  tree %10zu bytes\n  tape %10zu bytes  %.2fx smaller\n", used, words * 8 + bytes,
+           (double)used / (words * 8 + bytes));
+
+    for (int r = 0; r < ROUNDS; r++) {
+        double t = now();
+        check[0] = tree_sum(root);
+        if ((t = now() - t) < best[0]) best[0] = t;
+        t = now();
+        check[1] = tape_sum(tape, 0);
+        if ((t = now() - t) < best[1]) best[1] = t;
+        t = now();
+        check[2] = tree_field(root);
+        if ((t = now() - t) < best[2]) best[2] = t;
+        t = now();
+        check[3] = tape_field(tape);
+        if ((t = now() - t) < best[3]) best[3] = t;
+    }
+    printf("  full walk    tree %7.2f ms  tape %7.2f ms  %.2fx\n", best[0] * 1e3, best[1] * 1e3, best[0] / best[1]);
+    printf("  one member   tree %7.2f ms  tape %7.2f ms  %.2fx\n", best[2] * 1e3, best[3] * 1e3, best[2] / best[3]);
+    if (check[0] != check[1] || check[2] != check[3])
+        printf("  results differ\n");
+
+    json_tape_free(tape);
+    json_arena_destroy(arena);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*************************************************************************
+	> File Name: bench/bench_threads.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: json_parse_r on 1..N threads at once over a shared text,
+	               with malformed documents mixed in that must come back
+	               with their error codes rather than stop the process.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "cjson.h"
+
+#define ITEMS 20000
+#define PASSES 8
+
+typedef struct Bad {
+    const char *text;
+    int code;
+} BAD_t;
+
+static const BAD_t bad[] = {
+    {"{\"a\":1", JSON_ERR_END},
+    {"[1,2 3]", JSON_ERR_ARRAY},
+    {"{\"a\":1 \"b\":2}", JSON_ERR_OBJECT},
+    {"{a:1}", JSON_ERR_KEY},
+    {"{\"a\" 1}", JSON_ERR_COLON},
+    {"[\"open", JSON_ERR_STRING},
+    {"[-x]", JSON_ERR_NUMBER},
+    {"[nul]", JSON_ERR_VALUE},
+};
+
+typedef struct Worker {
+    const char *text;
+    int failures;
+} WORKER_t;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(size_t *len) {
+    size_t cap = (size_t)ITEMS * 128, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < ITEMS; i++)
+        n += snprintf(text + n, cap - n, "%s{\"id\":%d,\"name\":\"item-%d\",\"price\":%d.%02d,\"tags\":[\"x\",\"y\"]}",
+                      i ? "," : "", i, i, i % 500, i % 100);
+    n += snprintf(text + n, cap - n, "]");
+    *len = n;
+    return text;
+}
+
+static void *worker(void *arg) {
+    WORKER_t *w = (WORKER_t *)arg;
+    JERROR_t err;
+    for (int pass = 0; pass < PASSES; pass++) {
+        JNODE_p root = json_parse_r(w->text, NULL, &err);
+        if (!root || err.code != JSON_OK)
+            w->failures++;
+        json_delete(root);
+        const BAD_t *b = &bad[pass % (sizeof(bad) / sizeof(bad[0]))];
+        if (json_parse_r(b->text, NULL, &err) || err.code != b->code)
+            w->failures++;
+    }
+    return NULL;
+}
+
+static double run(const char *text, int threads, int *failures) {
+    pthread_t pool[64];
+    WORKER_t work[64];
+    double t = now();
+    for (int i = 0; i < threads; i++) {
+        work[i].text = text;
+        work[i].failures = 0;
+        pthread_create(&pool[i], NULL, worker, &work[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(pool[i], NULL);
+        *failures += work[i].failures;
+    }
+    return now() - t;
+}
+
+int main(void) {
+    size_t len = 0;
+    char *text = make_text(&len);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int failures = 0;
+    double base = 0;
+
+    printf("threads: %zu bytes, %d passes per thread, %ld cores\n", len, PASSES, cores);
+    for (long threads = 1; threads <= (cores > 1 ? cores : 2) && threads <= 64; threads *= 2) {
+        double t = run(text, (int)threads, &failures);
+        if (threads == 1)
+            base = t;
+        printf("  %2ld threads   %8.1f ms %8.1f MB/s  %5.2fx\n", threads, t * 1e3,
+               len * PASSES * threads / t / 1e6, base * threads / t);
+    }
+    printf("  %d wrong results\n", failures);
+    free(text);
+    return failures != 0;
+}
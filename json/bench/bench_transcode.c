@@ -0,0 +1,93 @@
+/*************************************************************************
+	> File Name: bench/bench_transcode.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Minifying and reindenting a document: the transcoder
+	               against a json_parse and json_format_style round trip,
+	               and the output size of each layout.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "cjson.h"
+
+#define RECORDS 200000
+#define ROUNDS 5
+#define CHUNK 65536
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char *make_text(void) {
+    size_t cap = (size_t)RECORDS * 200, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < RECORDS; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s{\"id\":%d,\"user\":\"user-%d\",\"score\":%d.%02d,\"tags\":[\"a\",\"b\",\"c\"],"
+                      "\"geo\":{\"lat\":%d.5,\"lon\":-%d.25},\"ok\":%s}",
+                      i ? "," : "", i, i, i % 1000, i % 100, i % 90, i % 180, i % 3 ? "true" : "false");
+    n += snprintf(text + n, cap - n, "]");
+    return text;
+}
+
+static int count(void *ctx, const char *data, size_t len) {
+    (void)data;
+    *(size_t *)ctx += len;
+    return 1;
+}
+
+/* Fed in chunks, as a file or socket would */
+static size_t transcode(const char *text, size_t len, int indent) {
+    size_t bytes = 0;
+    JXCODE_p x = json_transcoder_create(indent, count, &bytes);
+    for (size_t at = 0; at < len; at += CHUNK)
+        json_transcoder_feed(x, text + at, len - at < CHUNK ? len - at : CHUNK);
+    if (!json_transcoder_finish(x))
+        printf("  transcoding failed\n");
+    json_transcoder_free(x);
+    return bytes;
+}
+
+static size_t round_trip(const char *text, int indent) {
+    size_t bytes = 0;
+    JNODE_p root = json_parse(text);
+    json_write_style(root, indent, count, &bytes);
+    json_delete(root);
+    return bytes;
+}
+
+int main(void) {
+    char *raw = make_text();
+    JNODE_p root = json_parse(raw);
+    char *text = json_format(root);  // the usual input: what json_format wrote
+    size_t len = strlen(text);
+    json_delete(root);
+
+    printf("transcode: %d records, %zu bytes of json_format text, best of %d\n", RECORDS, len, ROUNDS);
+    const int indents[] = {JSON_MINIFY, 2};
+    for (int k = 0; k < 2; k++) {
+        double best[2] = {1e30, 1e30};
+        size_t bytes[2] = {0};
+        for (int r = 0; r < ROUNDS; r++) {
+            double t = now();
+            bytes[0] = transcode(text, len, indents[k]);
+            if ((t = now() - t) < best[0]) best[0] = t;
+            t = now();
+            bytes[1] = round_trip(text, indents[k]);
+            if ((t = now() - t) < best[1]) best[1] = t;
+        }
+        printf("  %-8s %10zu bytes (%4.1f%%)  transcoder %7.1f MB/s  parse + format %7.1f MB/s  %.2fx\n",
+               k ? "indent 2" : "minify", bytes[0], 100.0 * bytes[0] / len, len / best[0] / 1e6,
+               len / best[1] / 1e6, best[1] / best[0]);
+        if (bytes[0] != bytes[1])
+            printf("  output sizes differ\n");
+    }
+    free(text);
+    free(raw);
+    return 0;
+}
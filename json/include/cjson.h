@@ -1,87 +1,398 @@
-/*************************************************************************
-	> File Name: include/cjson.h
-	> Author: racle
-	> Mail: racleray@qq.com
-	> Created Time: Wed 25 Aug 2021 06:25:21 PM CST
- ************************************************************************/
-
-#ifndef _INCLUDE_CJSON_H
-#define _INCLUDE_CJSON_H
-
-#include <ctype.h>
-#include <float.h>
-#include <inttypes.h>
-#include <math.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-/* JSON struct */
-typedef struct JsonNode {
-    struct JsonNode *next, *prev;
-    struct JsonNode* child;
-
-    int type;
-    char* name; // node name
-
-    union {
-        char* string_val;
-        int int_val;
-        double double_val;
-    } value;
-} JNODE_t, *JNODE_p;
-
-
-/* Functions for input and output */
-JNODE_p text_to_json(char *);
-JNODE_p read_json(char *);
-void output_json(JNODE_p, FILE *);
-
-/* Functions for parsing text to json */
-JNODE_p json_parse(const char*);
-void json_delete(JNODE_p);
-
-/* Function for formating json struct, return char* to a print function */
-char* json_format(JNODE_p);
-
-/* Functions to create object */
-JNODE_p create_null(void);
-JNODE_p create_true(void);
-JNODE_p create_false(void);
-JNODE_p create_int(int);
-JNODE_p create_double(double);
-JNODE_p create_string(const char*);
-JNODE_p create_array(void);
-JNODE_p create_object(void);
-/* Functions to create array with elements */
-JNODE_p json_int_array(const int*, int);
-JNODE_p json_double_array(const double*, int);
-JNODE_p json_string_array(const char**, int);
-
-/* Functions to add node at object(with a name) */
-void json_add_null(JNODE_p, const char*);
-void json_add_true(JNODE_p, const char*);
-void json_add_false(JNODE_p, const char*);
-void json_add_int(JNODE_p, const char*, int);
-void json_add_double(JNODE_p, const char*, double);
-void json_add_string(JNODE_p, const char*, char*);
-
-/* Functions to add node at array or object(with a name) */
-void json_add_to_array(JNODE_p, JNODE_p);
-void json_add_to_object(JNODE_p, const char*, JNODE_p, int); // if on_heap == 0, don`t need free. stack memory.
-
-/* Functions to delete node from array or object(with a name) */
-void json_del_from_array(JNODE_p, int);
-void json_del_from_object(JNODE_p, const char*);
-JNODE_p json_detach_from_array(JNODE_p, int, int);
-JNODE_p json_detach_from_object(JNODE_p, const char *);
-
-/* Functions to replace a node in array or object(with a name) */
-void json_replace_array(JNODE_p, int, JNODE_p, int);
-int json_replace_object(JNODE_p, const char*, JNODE_p);
-
-/* Functions to find a node by name*/
-JNODE_p json_get(JNODE_p, const char *);
-
-#endif
-
+/*************************************************************************
+	> File Name: include/cjson.h
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Created Time: Wed 25 Aug 2021 06:25:21 PM CST
+ ************************************************************************/
+
+#ifndef _INCLUDE_CJSON_H
+#define _INCLUDE_CJSON_H
+
+#include <ctype.h>
+#include <float.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Node types, the low byte of JsonNode.type */
+enum {
+    J_NULL = 0,
+    J_True,
+    J_False,
+    J_Int,
+    J_Double,
+    J_String,
+    J_Array,
+    J_Object,
+    J_Int64     // integers outside the range of int
+};
+
+/* JSON struct, one cache line. Strings of up to 7 bytes are held in the
+ * node itself, string_val and name then point inside it. */
+typedef struct JsonNode {
+    struct JsonNode *next, *prev;
+    struct JsonNode* child;
+
+    int type;
+    unsigned int size; // children of an array or object
+    char* name; // node name
+
+    union {
+        char* string_val;
+        int int_val;
+        int64_t int64_val;
+        double double_val;
+        struct {
+            struct JsonNode *tail;    // last child
+            struct JsonIndex *index;  // lookup table built on demand, NULL if none
+        } list;                       // arrays and objects
+        struct {
+            char *ptr;                // string_val, at bytes
+            char bytes[8];
+        } small;                      // short string values
+    } value;
+    char small_name[8];               // short names
+} JNODE_t, *JNODE_p;
+
+/* Bump allocator owning every node and string of the documents parsed into it */
+typedef struct JsonArena JARENA_t, *JARENA_p;
+
+
+/* Sink for streamed output, returns 0 on failure */
+typedef int (*JWRITE_f)(void *ctx, const char *data, size_t len);
+
+/* Functions for input and output */
+JNODE_p text_to_json(char *);
+JNODE_p read_json(char *);
+void output_json(JNODE_p, FILE *);
+
+/* Functions streaming formatted text in bounded memory, return 0 on failure */
+int json_write(JNODE_p, JWRITE_f, void *);
+int json_write_file(JNODE_p, FILE *);
+int json_write_fd(JNODE_p, int);
+
+/* Layouts besides the json_format one: JSON_MINIFY drops all whitespace,
+ * a positive indent puts every element on a line of its own, indented by
+ * that many spaces per level (JSON_TABS: a tab), with ": " after names.
+ * Other negative indents are rejected with NULL or 0. */
+#define JSON_MINIFY 0
+#define JSON_TABS (-1)
+char *json_format_style(JNODE_p, int);
+int json_write_style(JNODE_p, int, JWRITE_f, void*);
+
+/* Text to text in one of the layouts above, without building nodes and
+ * in memory bounded by the nesting depth, fed in chunks split anywhere.
+ * Numbers, strings and escapes are copied as written. A sequence of
+ * documents (NDJSON included) comes out one document per line when
+ * minified. Feeding returns 0 once the text is malformed or the sink
+ * failed; finish flushes and returns 0 unless the text was complete. */
+typedef struct JsonTranscoder JXCODE_t, *JXCODE_p;
+JXCODE_p json_transcoder_create(int, JWRITE_f, void*);
+int json_transcoder_feed(JXCODE_p, const char*, size_t);
+int json_transcoder_finish(JXCODE_p); // ready for the next text
+void json_transcoder_free(JXCODE_p);
+int json_transcode(const char*, size_t, int, JWRITE_f, void*);
+int json_transcode_file(FILE*, FILE*, int); // in, out, indent
+
+/* Functions for parsing text to json */
+JNODE_p json_parse(const char*);
+void json_delete(JNODE_p);
+
+/* Reentrant parsing: all parse state is per call, so any number of threads
+ * may parse at once, and nothing exits on bad input. The only shared
+ * settings are the engine, which each call reads once, and the SIMD
+ * level, to be chosen before threads start parsing (see below). On
+ * failure NULL is returned and err, when given, tells what went wrong and
+ * where (offset from 0, line and column from 1). The arena may be NULL
+ * for heap nodes. */
+enum {
+    JSON_OK = 0,
+    JSON_ERR_END,     // text ended inside a value
+    JSON_ERR_VALUE,   // no value starts here
+    JSON_ERR_NUMBER,
+    JSON_ERR_STRING,  // unterminated string
+    JSON_ERR_KEY,     // member name is not a string
+    JSON_ERR_COLON,
+    JSON_ERR_ARRAY,   // missing ',' or ']'
+    JSON_ERR_OBJECT,  // missing ',' or '}'
+    JSON_ERR_NOMEM,   // the allocator ran out
+    JSON_ERR_IO       // json_read_r could not read the file
+};
+typedef struct JsonError {
+    int code;
+    size_t offset, line, column;
+} JERROR_t;
+JNODE_p json_parse_r(const char*, JARENA_p, JERROR_t*);
+JNODE_p json_parse_insitu_r(char*, JARENA_p, JERROR_t*);
+JNODE_p json_read_r(const char*, JARENA_p, JERROR_t*);
+const char *json_strerror(int);
+
+/* Functions for parsing into an arena, freed all at once by json_arena_destroy.
+ * json_delete on arena nodes is a no-op; heap nodes linked into an arena
+ * document with json_add_* are released together with the arena. */
+JARENA_p json_arena_create(size_t);               // hint: expected text length, 0 for default
+void json_arena_reserve(JARENA_p, size_t, size_t); // hint: node count, string bytes
+JNODE_p json_parse_arena(const char*, JARENA_p);
+void json_arena_destroy(JARENA_p);
+void json_arena_stats(JARENA_p, size_t*, size_t*, size_t*); // nodes, bytes used, bytes reserved
+
+/* Memory. Everything the library allocates goes through these hooks,
+ * malloc, realloc and free until set (NULLs restore them); ctx is passed
+ * back on every call, from the worker threads of the parallel parsers
+ * too. Set them before any document exists: memory goes back to the
+ * allocator it came from, and json_free releases what json_format,
+ * json_msgpack and the like return. Not thread safe. An arena made by
+ * json_arena_create_with takes its own memory from the hooks given
+ * there instead, so one document can live in a budget or a thread's
+ * pool of its own. Running out of memory is never fatal: parsers fail
+ * with JSON_ERR_NOMEM, the rest return NULL or 0. */
+typedef void *(*JALLOC_f)(void *ctx, size_t size);
+typedef void *(*JREALLOC_f)(void *ctx, void *ptr, size_t size);
+typedef void (*JFREE_f)(void *ctx, void *ptr);
+void json_set_allocator(JALLOC_f, JREALLOC_f, JFREE_f, void*);
+void json_free(void*);
+JARENA_p json_arena_create_with(size_t, JALLOC_f, JFREE_f, void*); // hint as for json_arena_create
+
+/* Allocation counts of the calling thread, including what the parallel
+ * parsers allocate for it on their workers. Reset, parse or format, then
+ * read them to see what one call costs. */
+typedef struct JsonMemStats {
+    size_t allocs;  // successful allocations, reallocations included
+    size_t frees;
+    size_t bytes;   // requested by those allocations
+    size_t failed;  // requests the allocator turned down
+} JMEMSTATS_t;
+void json_mem_stats(JMEMSTATS_t*, int); // reset after reading if the int is set
+
+/* Interned member names. An arena given a pool stores each distinct name
+ * once there, for every node parsed or added into it afterwards, so
+ * repeated keys cost one copy and compare by address first. One pool may
+ * be shared by many arenas and threads; it must outlive them. Heap trees
+ * share pooled names through json_add_to_object with on_heap 0. */
+typedef struct JsonPool JPOOL_t, *JPOOL_p;
+JPOOL_p json_pool_create(void);
+const char *json_pool_intern(JPOOL_p, const char*);
+void json_pool_stats(JPOOL_p, size_t*, size_t*); // distinct names, bytes
+void json_pool_free(JPOOL_p);
+void json_arena_intern(JARENA_p, JPOOL_p);        // NULL: a pool of its own
+
+/* Event parser, for input too large to hold as a tree. Reads a sequence
+ * of whitespace separated values (NDJSON included) through a window that
+ * only needs to fit the current token. Callbacks may be NULL and return
+ * SAX_GO to go on or SAX_STOP to stop; key, start_object and start_array
+ * may also return SAX_TREE to get the member value or the container as
+ * one tree through tree() instead of as events. The tree then belongs to
+ * the handler. Strings, including the name of a scalar, are only valid
+ * during the callback. */
+enum { SAX_STOP = 0, SAX_GO, SAX_TREE };
+typedef struct JsonSax {
+    int (*start_object)(void *ctx);
+    int (*end_object)(void *ctx);
+    int (*start_array)(void *ctx);
+    int (*end_array)(void *ctx);
+    int (*key)(void *ctx, const char *name, size_t len);
+    int (*scalar)(void *ctx, const JNODE_t *value);
+    int (*tree)(void *ctx, JNODE_p node);
+} JSAX_t;
+/* Return 1 at the end of input, 0 on malformed input or a read error,
+ * -1 when a callback stopped the parser */
+int json_sax_parse(const char*, const JSAX_t*, void*);
+int json_sax_parse_file(FILE*, const JSAX_t*, void*);
+int json_sax_parse_fd(int, const JSAX_t*, void*);
+
+/* Incremental parser for text arriving in pieces: chunks may split the
+ * text anywhere, even inside a string, number or escape, and parsing
+ * resumes where the last chunk ended. Nodes go to the arena when given;
+ * a document that is malformed, incomplete or abandoned gives back all
+ * it took from the arena, so allocate nothing else there between its
+ * first chunk and json_parser_finish. */
+typedef struct JsonParser JPARSER_t, *JPARSER_p;
+JPARSER_p json_parser_create(JARENA_p); // NULL: nodes on the heap
+int json_parser_feed(JPARSER_p, const char*, size_t); // 0 once the text is malformed
+JNODE_p json_parser_finish(JPARSER_p); // NULL if malformed or incomplete; ready for the next document
+void json_parser_free(JPARSER_p);
+
+/* Newline delimited JSON (JSON Lines) parsed on a pool of threads, 0 for
+ * one per core. Every non blank line is a record; records come back in
+ * input order, NULL for a malformed one. Each worker allocates from arenas
+ * of its own. A batch owns all of its trees; NULL when memory runs out. */
+typedef struct JsonBatch JBATCH_t, *JBATCH_p;
+JBATCH_p json_ndjson_parse(const char*, size_t, int);
+JBATCH_p json_ndjson_parse_file(const char*, int); // also NULL if the file cannot be read
+size_t json_batch_size(JBATCH_p);
+JNODE_p json_batch_get(JBATCH_p, size_t);
+void json_batch_free(JBATCH_p);
+/* Streaming form: each record is handed to the callback on the calling
+ * thread, in order, and freed when it returns; return 0 to stop. Only a
+ * few blocks per thread are held at a time. Returns 1 when every record
+ * was seen, -1 when stopped, 0 if the file cannot be read or memory runs
+ * out. */
+typedef int (*JRECORD_f)(void *ctx, size_t idx, JNODE_p root);
+int json_ndjson_each(const char*, size_t, int, JRECORD_f, void*);
+int json_ndjson_each_file(const char*, int, JRECORD_f, void*);
+
+/* One large array parsed on a pool of threads, 0 for one per core. The
+ * pointer (RFC 6901, NULL or "" for the root) names the array; its
+ * element boundaries come from the structural index, runs of elements
+ * are parsed at once and linked back in order, and the document around
+ * it is parsed as usual. Same tree and errors as json_parse_r; anything
+ * that is not an array there is parsed on the calling thread. */
+JNODE_p json_parse_parallel(const char*, const char*, JARENA_p, int, JERROR_t*);
+
+/* MessagePack, for services exchanging documents without the text in
+ * between. Maps and arrays carry their element count up front and
+ * strings their length, so nothing is scanned for an end. Output goes
+ * to a buffer (json_free it), a FILE or a sink in bounded memory. Reading
+ * accepts every type except the extensions; bin is read as a string,
+ * unsigned values past INT64_MAX as doubles. The error offset is the
+ * byte where decoding stopped, line and column are 0. */
+char *json_msgpack(JNODE_p, size_t*);  // length in the size_t
+int json_msgpack_write(JNODE_p, JWRITE_f, void*);
+int json_msgpack_file(JNODE_p, FILE*);
+JNODE_p json_msgpack_parse(const void*, size_t, JARENA_p, JERROR_t*);
+
+/* Functions for parsing in situ: strings are unescaped inside the given
+ * buffer and nodes point into it, so it must outlive the tree. On
+ * failure json_parse_insitu_r gives the exact offset, but counts line
+ * and column over the buffer as rewritten so far: a \n escape already
+ * unescaped before the error counts as a line break. */
+JNODE_p json_parse_insitu(char*);
+JNODE_p json_parse_insitu_arena(char*, JARENA_p);
+
+/* Function for formating json struct, return char* to a print function */
+char* json_format(JNODE_p);
+/* No allocation. *needed gets the full size with the terminator; 0 when
+ * cap is too small, buf then holding the first cap - 1 bytes of the text. */
+int json_format_into(JNODE_p, char*, size_t, size_t*);
+
+/* Functions to create object */
+JNODE_p create_null(void);
+JNODE_p create_true(void);
+JNODE_p create_false(void);
+JNODE_p create_int(int);
+JNODE_p create_int64(int64_t);
+JNODE_p create_double(double);
+JNODE_p create_string(const char*);
+JNODE_p create_array(void);
+JNODE_p create_object(void);
+/* Functions to create array with elements */
+JNODE_p json_int_array(const int*, int);
+JNODE_p json_double_array(const double*, int);
+JNODE_p json_string_array(const char**, int);
+
+/* Functions to add node at object(with a name), 0 when out of memory */
+int json_add_null(JNODE_p, const char*);
+int json_add_true(JNODE_p, const char*);
+int json_add_false(JNODE_p, const char*);
+int json_add_int(JNODE_p, const char*, int);
+int json_add_int64(JNODE_p, const char*, int64_t);
+int json_add_double(JNODE_p, const char*, double);
+int json_add_string(JNODE_p, const char*, char*);
+
+/* Functions to add node at array or object(with a name). They return 0,
+ * leaving node to the caller, when it is NULL (a create_* that ran out
+ * of memory) or its name cannot be copied. */
+int json_add_to_array(JNODE_p, JNODE_p);
+int json_add_to_object(JNODE_p, const char*, JNODE_p, int); // if on_heap == 0, don`t need free. stack memory.
+
+/* Functions for positional access to array or object, O(1) for arrays:
+ * the first json_array_get on a large array builds an index view of it,
+ * kept on append and dropped by any other change to the array. */
+size_t json_array_size(JNODE_p);
+JNODE_p json_array_get(JNODE_p, size_t); // NULL when out of range
+
+/* Functions to delete node from array or object(with a name) */
+void json_del_from_array(JNODE_p, int);
+void json_del_from_object(JNODE_p, const char*);
+JNODE_p json_detach_from_array(JNODE_p, int, int); // no_child = 1: first argument is a bare sibling chain
+JNODE_p json_detach_from_object(JNODE_p, const char *);
+
+/* Functions to replace a node in array or object(with a name). They
+ * return 0, leaving newitem to the caller, when it is NULL (a create_*
+ * that ran out of memory) or cannot be linked in for want of memory. */
+int json_replace_array(JNODE_p, int, JNODE_p, int); // no_child as for json_detach_from_array
+int json_replace_object(JNODE_p, const char*, JNODE_p);
+
+/* SIMD level of the parser's byte scanners, the best one is picked at start up */
+enum { SIMD_SCALAR = 0, SIMD_SSE2, SIMD_AVX2 };
+int json_simd_level(void);
+int json_simd_select(int); // not thread safe, returns the level now in use
+
+/* Engine behind json_parse, json_parse_arena and json_parse_r: recursive
+ * descent, or a two stage parser that indexes the structural characters
+ * of the whole text with the SIMD scanners first, then builds the same
+ * tree from the index. AUTO, still experimental, takes the index for
+ * texts of 64KB and up when SSE2 or AVX2 is in use; measured end to end
+ * it is only 0.94-1.16x descent there. Errors are always reported as
+ * recursive descent finds them, and in situ parsing always descends. */
+enum { JSON_ENGINE_DESCENT = 0, JSON_ENGINE_INDEX, JSON_ENGINE_AUTO };
+int json_engine(void);
+int json_engine_select(int); // atomic, returns the engine now in use
+
+/* Functions to find a node by name*/
+JNODE_p json_get(JNODE_p, const char *);
+
+/* Functions for RFC 6901 JSON Pointers ("/a/0/b", "" is the root itself):
+ * compile once, then evaluate against any number of documents. Only the
+ * addressed path is followed, names compare exactly and nothing is
+ * printed; NULL when the pointer is malformed or does not resolve.
+ * The first visit of a large container builds its lookup table, so warm
+ * a shared document up before reading it from several threads. */
+typedef struct JsonPath JPATH_t, *JPATH_p;
+JPATH_p json_path_compile(const char*);
+JNODE_p json_path_get(JNODE_p, JPATH_p);
+void json_path_free(JPATH_p);
+JNODE_p json_pointer(JNODE_p, const char*); // compile, get and free in one call
+
+/* Read only documents as a tape: every value is a 64 bit word (two for
+ * int64 and double) in document order, strings sit in one side buffer,
+ * and containers know where they end, so skipping a subtree is O(1).
+ * Values are named by their position on the tape, the root is at 0.
+ * Iteration yields the elements of an array or the member values of an
+ * object; json_tape_name gives the name of such a member value. Names
+ * compare exactly. Positions past the end are JTAPE_END. */
+#define JTAPE_END ((size_t)-1)
+typedef struct JsonTape JTAPE_t, *JTAPE_p;
+JTAPE_p json_tape_parse(const char*, JERROR_t*);
+JTAPE_p json_tape_from_tree(JNODE_p);
+JNODE_p json_tape_to_tree(JTAPE_p, size_t, JARENA_p); // arena may be NULL
+void json_tape_free(JTAPE_p);
+void json_tape_stats(JTAPE_p, size_t*, size_t*); // words, string bytes
+int json_tape_type(JTAPE_p, size_t); // J_*, -1 when not a value
+int64_t json_tape_int64(JTAPE_p, size_t);
+double json_tape_double(JTAPE_p, size_t);
+const char *json_tape_string(JTAPE_p, size_t, size_t*); // NULL if not a string
+size_t json_tape_size(JTAPE_p, size_t);
+size_t json_tape_first(JTAPE_p, size_t);
+size_t json_tape_next(JTAPE_p, size_t);
+size_t json_tape_skip(JTAPE_p, size_t); // position past the value
+const char *json_tape_name(JTAPE_p, size_t);
+size_t json_tape_get(JTAPE_p, size_t, const char*);
+size_t json_tape_index(JTAPE_p, size_t, size_t);
+
+/* Document images: a tape saved to a file and mapped back read only,
+ * ready to navigate with the json_tape_* functions at once, without
+ * parsing or allocating per value, and shared between the processes
+ * mapping it. json_tape_to_tree gives an editable copy; json_tape_free
+ * unmaps. Images are read on machines of the byte order that wrote
+ * them, NULL otherwise or when the file is not an image. Only the header
+ * is checked on open; a damaged image reads as wrong values or NULL, but
+ * never outside the file. */
+int json_save_image(JNODE_p, const char*);  // 0 on failure
+int json_tape_save(JTAPE_p, const char*);
+JTAPE_p json_open_image(const char*);
+
+/* Functions on the direct members of an object, in insertion order. Large
+ * objects get a hash index on first lookup, so these are O(1) on average;
+ * every function above that links or unlinks members keeps it current.
+ * Names compare ignoring ASCII case, like json_get, unless the object is
+ * made case sensitive, which is also the faster mode. */
+JNODE_p json_object_get(JNODE_p, const char*);
+JNODE_p json_object_detach(JNODE_p, const char*);
+int json_object_replace(JNODE_p, const char*, JNODE_p); // newitem takes the member's name
+void json_object_case_sensitive(JNODE_p, int);
+
+#endif
+
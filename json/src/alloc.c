@@ -0,0 +1,44 @@
+/*************************************************************************
+	> File Name: src/alloc.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Allocation hooks and the per-thread counters behind
+	               json_mem_stats. The calls themselves are inline in
+	               internal.h; only the state lives here.
+ ************************************************************************/
+
+#include "internal.h"
+
+JALLOCATOR_t mem_heap = {NULL, NULL, NULL, NULL};
+__thread JMEMSTATS_t mem_counts;
+
+void json_set_allocator(JALLOC_f alloc, JREALLOC_f grow, JFREE_f release, void *ctx) {
+    JALLOCATOR_t hooks = {alloc, grow, release, ctx};
+    if (!alloc || !grow || !release)
+        memset(&hooks, 0, sizeof(hooks));  // all or nothing
+    mem_heap = hooks;
+}
+
+void json_free(void *ptr) {
+    safe_free(ptr);
+}
+
+void json_mem_stats(JMEMSTATS_t *stats, int reset) {
+    if (stats)
+        *stats = mem_counts;
+    if (reset)
+        memset(&mem_counts, 0, sizeof(mem_counts));
+}
+
+/* Counts of a worker thread, handed to the thread it works for */
+void mem_stats_take(JMEMSTATS_t *stats) {
+    *stats = mem_counts;
+    memset(&mem_counts, 0, sizeof(mem_counts));
+}
+
+void mem_stats_add(const JMEMSTATS_t *stats) {
+    mem_counts.allocs += stats->allocs;
+    mem_counts.frees += stats->frees;
+    mem_counts.bytes += stats->bytes;
+    mem_counts.failed += stats->failed;
+}
@@ -0,0 +1,335 @@
+/*************************************************************************
+	> File Name: src/arena.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Bump allocator for parsed documents. Nodes are carved
+	               from aligned slabs so the owning arena can be found from
+	               any node pointer; strings come from plain byte blocks.
+ ************************************************************************/
+
+#include "internal.h"
+
+#define SLAB_SHIFT 16
+#define SLAB_SIZE ((size_t)1 << SLAB_SHIFT)
+#define SLAB_HEAD 64                     // keeps the first node cache aligned
+#define SLAB_NODES ((SLAB_SIZE - SLAB_HEAD) / sizeof(JNODE_t))
+#define MAX_GROUP 64                     // slabs per allocation, at most 4 MB
+#define MIN_BLOCK 4096
+#define MAX_BLOCK ((size_t)4 << 20)
+#define NAME_CACHE 64                    // recent interned names, no lock
+
+/* Every raw allocation starts with this link */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t slabs;  // node slabs in it, 0 for a string block
+} CHUNK_t;
+
+/* Head of every node slab */
+typedef struct ArenaSlab {
+    JARENA_p arena;
+} SLAB_t;
+
+/* Arena containers that received heap nodes, released on destroy */
+typedef struct ArenaForeign {
+    JNODE_p node;
+    struct ArenaForeign *next;
+} FOREIGN_t;
+
+struct JsonArena {
+    JALLOCATOR_t mem;           // where chunks, and the arena itself, come from
+    CHUNK_t *chunks;
+
+    char *node_cur, *node_end;  // free slots of the current slab
+    char *next_slab;            // following slabs of the current group
+    size_t slabs_left;
+    size_t group;               // slabs in the next group
+
+    char *byte_cur, *byte_end;  // current string block
+    size_t block;               // size of the next string block
+
+    FOREIGN_t *foreign;
+
+    JPOOL_p pool;               // member names are interned here, if set
+    int own_pool;
+    const char *names[NAME_CACHE];
+
+    size_t nodes, used, reserved;
+};
+
+static void *arena_chunk(JARENA_p arena, size_t size) {
+    CHUNK_t *chunk = (CHUNK_t *)mem_alloc(&arena->mem, sizeof(CHUNK_t) + size);
+    if (!chunk)
+        return NULL;
+    chunk->next = arena->chunks;
+    chunk->slabs = 0;
+    arena->chunks = chunk;
+    arena->reserved += sizeof(CHUNK_t) + size;
+    return chunk + 1;
+}
+
+static void arena_new_slab(JARENA_p arena, char *slab) {
+    ((SLAB_t *)slab)->arena = arena;
+    arena->node_cur = slab + SLAB_HEAD;
+    arena->node_end = arena->node_cur + SLAB_NODES * sizeof(JNODE_t);
+}
+
+static inline uintptr_t slab_base(const void *raw) {
+    return ((uintptr_t)raw + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1);
+}
+
+static int arena_new_group(JARENA_p arena, size_t slabs) {
+    /* One spare slab worth of bytes lets us round the start up to SLAB_SIZE */
+    char *raw = (char *)arena_chunk(arena, (slabs + 1) * SLAB_SIZE);
+    if (!raw)
+        return 0;
+    uintptr_t base = slab_base(raw);
+    arena->chunks->slabs = slabs;
+
+    arena_new_slab(arena, (char *)base);
+    arena->next_slab = (char *)base + SLAB_SIZE;
+    arena->slabs_left = slabs - 1;
+    return 1;
+}
+
+static int arena_new_block(JARENA_p arena, size_t size) {
+    if (size < arena->block)
+        size = arena->block;
+    char *block = (char *)arena_chunk(arena, size);
+    if (!block)
+        return 0;
+    arena->byte_cur = block;
+    arena->byte_end = block + size;
+    if (arena->block < MAX_BLOCK)
+        arena->block <<= 1;
+    return 1;
+}
+
+/* Arena internals shared with cjson.c, NULL when out of memory */
+JNODE_p arena_node(JARENA_p arena) {
+    if (arena->node_cur == arena->node_end) {
+        if (arena->slabs_left) {
+            arena_new_slab(arena, arena->next_slab);
+            arena->next_slab += SLAB_SIZE;
+            arena->slabs_left--;
+        } else {
+            if (!arena_new_group(arena, arena->group))
+                return NULL;
+            if (arena->group < MAX_GROUP)
+                arena->group <<= 1;
+        }
+    }
+    JNODE_p node = (JNODE_p)arena->node_cur;
+    arena->node_cur += sizeof(JNODE_t);
+    arena->nodes++;
+    arena->used += sizeof(JNODE_t);
+    memset(node, 0, sizeof(JNODE_t));
+    node->type = ARENA_BIT;
+    return node;
+}
+
+void *arena_alloc(JARENA_p arena, size_t size, size_t align) {
+    uintptr_t cur = ((uintptr_t)arena->byte_cur + align - 1) & ~(uintptr_t)(align - 1);
+    if (!arena->byte_cur || cur + size > (uintptr_t)arena->byte_end) {
+        if (!arena_new_block(arena, size + align))
+            return NULL;
+        cur = ((uintptr_t)arena->byte_cur + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    arena->byte_cur = (char *)(cur + size);
+    arena->used += size;
+    return (void *)cur;
+}
+
+/* Give back ptr, the most recent arena_alloc, and all after it */
+void arena_unalloc(JARENA_p arena, void *ptr) {
+    arena->used -= arena->byte_cur - (char *)ptr;
+    arena->byte_cur = (char *)ptr;
+}
+
+char *arena_strdup(JARENA_p arena, const char *str, size_t len) {
+    char *copy = (char *)arena_alloc(arena, len + 1, 1);
+    if (!copy)
+        return NULL;
+    memcpy(copy, str, len);
+    copy[len] = 0;
+    return copy;
+}
+
+JARENA_p arena_of(JNODE_p node) {
+    return ((SLAB_t *)((uintptr_t)node & ~(uintptr_t)(SLAB_SIZE - 1)))->arena;
+}
+
+JPOOL_p arena_pool(JARENA_p arena) {
+    return arena ? arena->pool : NULL;
+}
+
+/* Interned copy of a member name. A document repeats few names, most
+   are found in the cache without going to the shared pool. */
+const char *arena_intern(JARENA_p arena, const char *name, size_t len) {
+    size_t h = len ? (len * 31 + (unsigned char)name[0]) * 31 + (unsigned char)name[len - 1] : 0;
+    const char **slot = &arena->names[h % NAME_CACHE];
+    if (*slot && !strncmp(*slot, name, len) && !(*slot)[len])
+        return *slot;
+    const char *interned = pool_intern(arena->pool, name, len);
+    if (interned)
+        *slot = interned;
+    return interned;
+}
+
+/* Called before a heap node is linked under an arena container, 0 when
+   the arena cannot keep track of it */
+int arena_adopt(JNODE_p container) {
+    if (!(container->type & ARENA_BIT) || (container->type & FOREIGN_BIT))
+        return 1;
+    JARENA_p arena = arena_of(container);
+    FOREIGN_t *cell = (FOREIGN_t *)arena_alloc(arena, sizeof(FOREIGN_t), sizeof(void *));
+    if (!cell)
+        return 0;
+    cell->node = container;
+    cell->next = arena->foreign;
+    arena->foreign = cell;
+    container->type |= FOREIGN_BIT;
+    return 1;
+}
+
+/* Move all memory of from into arena and destroy from. Slab heads are
+   pointed at arena so arena_of keeps working for the moved nodes. The
+   names of from must not be in a pool of its own, and its memory must
+   come from the same hooks: see arena_create_like. */
+void arena_merge(JARENA_p arena, JARENA_p from) {
+    CHUNK_t *chunk = from->chunks, *next = NULL;
+    for (; chunk; chunk = next) {
+        next = chunk->next;
+        uintptr_t base = slab_base(chunk + 1);
+        for (size_t i = 0; i < chunk->slabs; i++)
+            ((SLAB_t *)(base + i * SLAB_SIZE))->arena = arena;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    while (from->foreign) {
+        FOREIGN_t *cell = from->foreign;
+        from->foreign = cell->next;
+        cell->next = arena->foreign;
+        arena->foreign = cell;
+    }
+    arena->nodes += from->nodes;
+    arena->used += from->used;
+    arena->reserved += from->reserved;
+    mem_free(&from->mem, from);
+}
+
+void arena_mark(JARENA_p arena, MARK_t *mark) {
+    MARK_t now = {arena->chunks, arena->foreign, arena->node_cur, arena->node_end, arena->next_slab,
+                  arena->byte_cur, arena->byte_end, arena->slabs_left, arena->group, arena->block,
+                  arena->nodes, arena->used, arena->reserved};
+    *mark = now;
+}
+
+/* Chunks are listed newest first, merged ones included, so those taken
+   since the mark are the ones before it */
+void arena_rollback(JARENA_p arena, const MARK_t *mark) {
+    while (arena->chunks && arena->chunks != mark->chunks) {
+        CHUNK_t *chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        mem_free(&arena->mem, chunk);
+    }
+    arena->foreign = (FOREIGN_t *)mark->foreign;
+    arena->node_cur = mark->node_cur;
+    arena->node_end = mark->node_end;
+    arena->next_slab = mark->next_slab;
+    arena->byte_cur = mark->byte_cur;
+    arena->byte_end = mark->byte_end;
+    arena->slabs_left = mark->slabs_left;
+    arena->group = mark->group;
+    arena->block = mark->block;
+    arena->nodes = mark->nodes;
+    arena->used = mark->used;
+    arena->reserved = mark->reserved;
+}
+
+/* An empty arena taking its memory where arena does */
+JARENA_p arena_create_like(JARENA_p arena, size_t text_len) {
+    return json_arena_create_with(text_len, arena->mem.alloc, arena->mem.free, arena->mem.ctx);
+}
+
+/* Public interface */
+JARENA_p json_arena_create(size_t text_len) {
+    return json_arena_create_with(text_len, NULL, NULL, NULL);
+}
+
+/* Without hooks, the global ones as they are now */
+JARENA_p json_arena_create_with(size_t text_len, JALLOC_f alloc, JFREE_f release, void *ctx) {
+    JALLOCATOR_t mem = {alloc, NULL, release, ctx};
+    if (!alloc || !release)
+        mem = mem_heap;
+    JARENA_p arena = (JARENA_p)mem_alloc(&mem, sizeof(JARENA_t));
+    if (!arena)
+        return NULL;
+    memset(arena, 0, sizeof(JARENA_t));
+    arena->mem = mem;
+    arena->group = 1;
+    arena->block = MIN_BLOCK;
+    /* A node per 16 bytes of text and a quarter of the text for strings
+       is a cheap upper-middle estimate for typical documents. */
+    if (text_len)
+        json_arena_reserve(arena, text_len / 16, text_len / 4);
+    return arena;
+}
+
+void json_arena_reserve(JARENA_p arena, size_t nodes, size_t bytes) {
+    size_t room = (size_t)(arena->node_end - arena->node_cur) / sizeof(JNODE_t)
+                  + arena->slabs_left * SLAB_NODES;
+    /* The unused tail of the current group is dropped, reserve early.
+       A hint: at most one group and one block of the largest size are
+       taken now, the rest as parsing needs it. Running out of memory here
+       is left for later to report. */
+    if (nodes > room) {
+        size_t slabs = (nodes + SLAB_NODES - 1) / SLAB_NODES;
+        if (slabs > MAX_GROUP)
+            slabs = MAX_GROUP;
+        if (arena_new_group(arena, slabs) && arena->group < slabs)
+            arena->group = slabs;
+    }
+    if (bytes > MAX_BLOCK)
+        bytes = MAX_BLOCK;
+    if (bytes > (size_t)(arena->byte_end - arena->byte_cur)) {
+        if (bytes > arena->block)
+            arena->block = bytes;
+        (void)arena_new_block(arena, bytes);
+    }
+}
+
+void json_arena_destroy(JARENA_p arena) {
+    if (!arena) return;
+    for (FOREIGN_t *cell = arena->foreign; cell; cell = cell->next) {
+        JNODE_p c = cell->node->child, next = NULL;
+        for (; c; c = next) {
+            next = c->next;
+            if (c->type & ARENA_BIT)
+                continue;
+            c->prev = c->next = NULL;
+            json_delete(c);
+        }
+    }
+    CHUNK_t *chunk = arena->chunks, *next = NULL;
+    for (; chunk; chunk = next) {
+        next = chunk->next;
+        mem_free(&arena->mem, chunk);
+    }
+    if (arena->own_pool)
+        json_pool_free(arena->pool);
+    mem_free(&arena->mem, arena);
+}
+
+void json_arena_intern(JARENA_p arena, JPOOL_p pool) {
+    if (arena->own_pool)
+        json_pool_free(arena->pool);
+    arena->pool = pool ? pool : json_pool_create();
+    arena->own_pool = !pool && arena->pool;
+    memset(arena->names, 0, sizeof(arena->names));
+}
+
+void json_arena_stats(JARENA_p arena, size_t *nodes, size_t *used, size_t *reserved) {
+    if (nodes) *nodes = arena->nodes;
+    if (used) *used = arena->used;
+    if (reserved) *reserved = arena->reserved;
+}
@@ -1,988 +1,1321 @@
-/*************************************************************************
-	> File Name: include/cjson.h
-	> Author: racle
-	> Mail: racleray@qq.com
-	> Created Time: Wed 25 Aug 2021 06:25:21 PM CST
- ************************************************************************/
-
-#include "cjson.h"
-
-#define CONST_BIT 256
-
-enum {
-    J_NULL = 0,
-    J_True,
-    J_False,
-    J_Int,
-    J_Double,
-    J_String,
-    J_Array,
-    J_Object
-};
-
-static const char *ep;
-
-static inline void *emalloc(size_t size);
-static inline void safe_free(void *ptr);
-static inline void error_exit(int status, const char *error_msg);
-static int strcmp_case(const char *s1, const char *s2);
-static const char *skip_invalid(const char *value);
-
-static JNODE_p new_node(void);
-
-static const char *parse_value(JNODE_p node, const char *value);
-static const char *parse_string(JNODE_p node, const char *value);
-static const char *parse_number(JNODE_p node, const char *value);
-static const char *parse_array(JNODE_p node, const char *value);
-static const char *parse_object(JNODE_p node, const char *value);
-
-static char *print_const(const char *str);
-static char *print_value(JNODE_p node, int depth);
-static char *print_number(JNODE_p node);
-static char *print_string_base(const char *str);
-static char *print_string(JNODE_p node);
-static char *print_array(JNODE_p node, int depth);
-static char *print_object(JNODE_p node, int depth);
-
-static void show_search_result(JNODE_p node, const char *name);
-
-/* Functions for input and output */
-JNODE_p text_to_json(char *text) {
-    JNODE_p json = NULL;
-    json = json_parse(text);
-    if (!json) {
-        printf("Parsing input failed. Error before: %s \n", ep);
-        exit(EXIT_FAILURE);
-    }
-    return json;
-}
-
-JNODE_p read_json(char *filename) {
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) error_exit(2, "Failed to open input file. \n");
-
-    int len = 0;
-    char tmp = 0;
-    while (tmp != EOF) {
-        tmp = fgetc(fp);
-        len++;
-    }
-    if (ferror(fp)) {
-        fclose(fp); // locate error
-        error_exit(3, "Failed to read input file. \n");
-    }
-    rewind(fp);
-
-    char *text = (char *)emalloc(sizeof(char) * (len + 1));
-    if (fread(text, sizeof(char), len, fp) != (len - 1)) {
-        safe_free(text);
-        fclose(fp);
-        error_exit(3, "Failed to read input file. \n");
-    }
-
-    JNODE_p json = text_to_json(text);
-    safe_free(text);
-    return json;
-}
-
-void output_json(JNODE_p root, FILE *out) {
-    char *text = json_format(root);
-    if (!text) {
-        safe_free(text);
-        error_exit(3, "Failed to foramt json object. \n");
-    }
-    fprintf(out, "%s \n", text);
-    safe_free(text);
-}
-
-/* Functions for parsing text to json */
-JNODE_p json_parse(const char *value) {
-    const char *end = NULL;
-    JNODE_p c = new_node();
-    ep = 0;
-    end = parse_value(c, skip_invalid(value));
-    if (!end) {
-        json_delete(c);
-        return NULL;
-    }
-    return c;
-}
-
-void json_delete(JNODE_p root) {
-    JNODE_p next;
-    while (root) {
-        next = root->next;
-        if (root->child) json_delete(root->child);
-        if ((root->type == J_String) && root->value.string_val)
-            safe_free(root->value.string_val);
-        if (!(root->type & CONST_BIT) && root->name);
-        safe_free(root->name);
-        safe_free(root);
-        root = next;
-    }
-}
-
-/* Function for formating json struct, return char* to arr print function */
-char *json_format(JNODE_p root) {
-    return print_value(root, 0);
-}
-
-/* Functions to create object */
-JNODE_p create_null(void) {
-    JNODE_p node = new_node();
-    node->type = J_NULL;
-    return node;
-}
-
-JNODE_p create_true(void){
-    JNODE_p node = new_node();
-    node->type = J_True;
-    return node;
-}
-
-JNODE_p create_false(void){
-    JNODE_p node = new_node();
-    node->type = J_False;
-    return node;
-}
-
-JNODE_p create_int(int num) {
-    JNODE_p node = new_node();
-    node->type = J_Int;
-    node->value.int_val = num;
-    return node;
-}
-
-JNODE_p create_double(double num) {
-    JNODE_p node = new_node();
-    node->type = J_Double;
-    node->value.double_val = num;
-    return node;
-}
-
-JNODE_p create_string(const char *str) {
-    JNODE_p node = new_node();
-    node->type = J_String;
-    node->value.string_val = print_const(str);
-    return node;
-}
-
-JNODE_p create_array(void) {
-    JNODE_p node = new_node();
-    node->type = J_Array;
-    return node;
-}
-
-JNODE_p create_object(void) {
-    JNODE_p node = new_node();
-    node->type = J_Object;
-    return node;
-}
-
-/* Functions to create array with elements */
-JNODE_p json_int_array(const int *nums, int len) {
-    {
-        JNODE_p next = NULL, prev = NULL, arr = create_array();
-        for (int i = 0; arr && i < len; i++)
-        {
-            next = create_int(nums[i]);
-            if (!i)
-                arr->child = next;
-            else {
-                prev->next = next;
-                next->prev = prev;
-            }
-            prev = next;
-        }
-        return arr;
-    }
-}
-
-JNODE_p json_double_array(const double *nums, int len) {
-    JNODE_p next = NULL, prev = NULL, arr = create_array();
-    for (int i = 0; arr && i < len; i++)
-    {
-        next = create_double(nums[i]);
-        if (!i)
-            arr->child = next;
-        else {
-            prev->next = next;
-            next->prev = prev;
-        }
-        prev = next;
-    }
-    return arr;
-}
-
-JNODE_p json_string_array(const char **strs, int len) {
-    JNODE_p next = NULL, prev = NULL, arr = create_array();
-    for (int i = 0; arr && i < len; i++)
-    {
-        next = create_string(strs[i]);
-        if (!i)
-            arr->child = next;
-        else {
-            prev->next = next;
-            next->prev = prev;
-        }
-        prev = next;
-    }
-    return arr;
-}
-
-/* Functions to add node at object(with arr name) */
-void json_add_null(JNODE_p obj, const char *name) {
-    json_add_to_object(obj, name, create_null(), 1);
-}
-
-void json_add_true(JNODE_p obj, const char *name) {
-    json_add_to_object(obj, name, create_true(), 1);
-}
-
-void json_add_false(JNODE_p obj, const char *name) {
-    json_add_to_object(obj, name, create_false(), 1);
-}
-
-void json_add_int(JNODE_p obj, const char *name, int num) {
-    json_add_to_object(obj, name, create_int(num), 1);
-}
-
-void json_add_double(JNODE_p obj, const char *name, double num) {
-    json_add_to_object(obj, name, create_double(num), 1);
-}
-
-void json_add_string(JNODE_p obj, const char *name, char *str) {
-    json_add_to_object(obj, name, create_string(str), 1);
-}
-
-/* Functions to add node at array or object(with arr name) */
-void json_add_to_array(JNODE_p array, JNODE_p node) {
-    JNODE_p c = array->child;
-    if (!node) error_exit(5, "Add a empty node to array.\n");
-    if (!c)
-        array->child = node;
-    else {
-        while (c->next)
-            c = c->next;
-        c->next = node;
-        node->prev = c;
-    }
-}
-
-void json_add_to_object(JNODE_p object, const char *name, JNODE_p node, int on_heap) {
-    if (!node) error_exit(5, "Add a empty node to object.\n");
-    if (node->name && !(node->type & CONST_BIT))
-        safe_free(node->name);
-    if (on_heap)
-        node->name = print_const(name);  // heap
-    else {
-        node->name = (char *)name;
-        node->type |= CONST_BIT;
-    }
-    json_add_to_array(object, node);
-}
-
-/* Functions to delete node from array or object(with arr name) */
-void json_del_from_array(JNODE_p array, int idx) {
-    json_delete(json_detach_from_array(array, idx, 0));
-}
-
-void json_del_from_object(JNODE_p obj, const char *name) {
-    json_delete(json_detach_from_object(obj, name));
-}
-
-// no_child = 1: when using this function at json_detach_from_object
-JNODE_p json_detach_from_array(JNODE_p array, int idx, int no_child) {
-    JNODE_p c = NULL;
-    if (no_child) c = array;
-    else c = array->child;
-    while (c && idx > 0)
-        c = c->next, idx--;
-    if (!c) error_exit(6, "Failed to detach from json, index error.\n");
-    if (c->prev)
-        c->prev->next = c->next;
-    if (c->next)
-        c->next->prev = c->prev;
-    if (!no_child && c == array->child)  // first child
-        array->child = c->next;
-    c->prev = c->next = NULL;
-    return c;
-}
-
-JNODE_p json_detach_from_object(JNODE_p obj, const char *name) {
-    int i = 0;
-    JNODE_p c = obj, out = NULL;
-    while (c && !out) {
-        if (!strcmp_case(c->name, name)) {
-            out = json_detach_from_array(obj, i, 1);
-            return out;
-        }
-        if (c->child)
-            out = json_detach_from_object(c->child, name);
-        i++, c = c->next;
-    }
-    return out;
-}
-
-/* Functions to replace arr node in array or object(with arr name) */
-// no_child = 1: when using this function at json_replace_object, otherwise 0.
-void json_replace_array(JNODE_p array, int idx, JNODE_p newitem, int no_child) {
-    JNODE_p c = NULL;
-    if (no_child) c = array;
-    else c = array->child;
-
-    while (c && idx > 0)
-        c = c->next, idx--;
-    if (!c) error_exit(6, "Failed to replace from json, index error.\n");
-    newitem->next = c->next;
-    newitem->prev = c->prev;
-    if (newitem->next)
-        newitem->next->prev = newitem;
-    if (!no_child && c == array->child)  // first child
-        array->child = newitem;
-    else if (newitem->prev)  // first node
-        newitem->prev->next = newitem;
-    c->next = c->prev = NULL;
-    json_delete(c);
-}
-
-int json_replace_object(JNODE_p obj, const char *name, JNODE_p newitem) {
-    int i = 0, flag = 0;
-    JNODE_p c = obj;
-    while (c && !flag) {
-        if (!strcmp_case(c->name, name)) {
-            newitem->name = print_const(name);
-            (void)json_replace_array(obj, i, newitem, 1);
-            return 1;
-        }
-        if (c->child)
-            flag = json_replace_object(c->child, name, newitem);
-        i++, c = c->next;
-    }
-    return flag;
-}
-
-/* Functions to find arr node by name*/
-JNODE_p json_get(JNODE_p root, const char *name) {
-    JNODE_p c = root, out = NULL;
-    while (c && !out) {
-        if (!strcmp_case(c->name, name)) {
-            (void)show_search_result(c, name);
-            out = c;
-            return out;
-        }
-        if (c->child)
-            out = json_get(c->child, name);
-        c = c->next;
-    }
-    if (!out) {
-        printf("Key [%s] not found. \n", name);
-        return NULL;
-    }
-    return out;
-}
-
-static void show_search_result(JNODE_p node, const char *name) {
-    switch (node->type) {
-        case J_NULL: {
-            printf("Key: [%s] , value: [%s]. \n", name, "null");
-            break;
-        }
-        case J_False: {
-            printf("Key: [%s] , value: [%s]. \n", name, "false");
-            break;
-        }
-        case J_True: {
-            printf("Key: [%s] , value: [%s]. \n", name, "true");
-            break;
-        }
-        case J_Int: {
-            printf("Key: [%s] , value: [%d]. \n", name, node->value.int_val);
-            break;
-        }
-        case J_Double: {
-            printf("Key: [%s] , value: [%lf]. \n", name, node->value.double_val);
-            break;
-        }
-        case J_String: {
-            printf("Key: [%s] , value: [%s]. \n", name, node->value.string_val);
-            break;
-        }
-        default: {
-            printf("Key: [%s] , can`t get value of this node. \n", name);
-            break;
-        }
-    }
-}
-
-/**********************************************************************************/
-/* Static functions */
-static inline void error_exit(int status, const char *error_msg) {
-    fputs(error_msg, stderr);
-    exit(status);
-}
-
-static inline void *emalloc(size_t size) {
-    void *prev = malloc(size);
-    if (prev == NULL)
-        error_exit(3, "Insufficient memory.");
-    return prev;
-}
-
-static inline void safe_free(void *ptr) {
-    free(ptr);
-    ptr = NULL;
-}
-
-static JNODE_p new_node(void) {
-    JNODE_p node = (JNODE_p)emalloc(sizeof(JNODE_t));
-    if (node) memset(node, 0, sizeof(JNODE_t));
-    return node;
-}
-
-/* If s1 == s2, return 0 */
-static int strcmp_case(const char *s1, const char *s2)
-{
-    if (!s1 || !s2)
-        return 1;
-    for (; tolower(*s1) == tolower(*s2); ++s1, ++s2)
-        if (*s1 == 0)
-            return 0;
-    return 1;
-}
-
-
-static const char *skip_invalid(const char *value) {
-    while (value && *value && (unsigned char) *value <= 32)
-        value++;
-    return value;
-}
-
-static const char *parse_value(JNODE_p node, const char *value) {
-    if (!strncmp(value, "null", 4)) {
-        node->type = J_NULL;
-        return value + 4;
-    }
-    if (!strncmp(value, "false", 5)) {
-        node->type = J_False;
-        node->value.int_val = 0;
-        return value + 5;
-    }
-    if (!strncmp(value, "true", 4)) {
-        node->type = J_True;
-        node->value.int_val = 1;
-        return value + 4;
-    }
-    if (*value == '\"') { return parse_string(node, value); }
-    if (*value == '-' || (*value >= '0' && *value <= '9')) {
-        return parse_number(node, value);
-    }
-    if (*value == '[') { return parse_array(node, value); }
-    if (*value == '{') { return parse_object(node, value); }
-
-    ep = value;
-    return NULL;
-}
-
-static const char *parse_string(JNODE_p node, const char *value) {
-    const char *ptr = value + 1;
-    int len = 0;
-    while (*ptr != '\"' && *ptr && ++len) {
-        if (*ptr++ == '\\')
-            ptr++;  /* Skip escaped quotes. \\ means \ in code. \\ in text is escaped quotes*/
-    }
-
-    char *out = (char *)emalloc(sizeof(char) * (len + 1));
-
-    // scan
-    char *scan = out;
-    ptr = value + 1;
-    while (*ptr != '\"' && *ptr) {
-        if (*ptr != '\\') *scan++ = *ptr++;
-        else {
-            ptr++;
-            switch (*ptr) {
-                case 'b':
-                    *scan++ = '\b';
-                    break;
-                case 'f':
-                    *scan++ = '\f';
-                    break;
-                case 'n':
-                    *scan++ = '\n';
-                    break;
-                case 'r':
-                    *scan++ = '\r';
-                    break;
-                case 't':
-                    *scan++ = '\t';
-                    break;
-                default:
-                    *scan++ = *ptr;
-                    break;
-            }
-            ptr++;
-        }
-    }
-    *scan = 0; // end
-    if (*ptr == '\"') ptr++;
-    node->value.string_val = out;
-    node->type = J_String;
-    return ptr;
-}
-
-static const char *parse_number(JNODE_p node, const char *value) {
-    double next = 0, sign = 1;
-
-    if (*value == '-')
-        sign = -1, value++;
-    if (*value == '0')
-        value++;
-
-    if (*value >= '1' && *value <= '9') {
-        do
-            next = (next * 10.0) + (*value++ - '0');
-        while (*value >= '0' && *value <= '9');
-    }
-
-    int scale = 0;
-    int is_fraction = 0;
-    if (*value == '.' && value[1] >= '0' && value[1] <= '9') // value[1] look ahead.
-    {
-        is_fraction = 1;
-        value++;
-        do
-            next = (next * 10.0) + (*value++ - '0'), scale--;
-        while (*value >= '0' && *value <= '9');
-    }
-
-    if (is_fraction) {
-        next = sign * next * pow(10.0, scale);
-        node->value.double_val = next;
-        node->type = J_Double;
-    } else {
-        next = sign * next;
-        node->value.int_val = (int) next;
-        node->type = J_Int;
-    }
-
-    return value;
-}
-
-static const char *parse_array(JNODE_p node, const char *value) {
-    JNODE_p child = NULL;
-
-    node->type = J_Array;
-    value = skip_invalid(value + 1);
-    if (*value == ']')
-        return value + 1; /* empty array. */
-
-    node->child = child = new_node();
-    value = skip_invalid(parse_value(child, skip_invalid(value)));
-
-    while (*value == ',') {
-        JNODE_p new_item = new_node();
-        child->next = new_item;
-        new_item->prev = child;
-        child = new_item;
-        value = skip_invalid(parse_value(child, skip_invalid(value + 1)));
-    }
-
-    if (*value == ']')
-        return value + 1; /* end of array */
-    else {
-        perror("Incorrect format, without arr ']'.\n");
-        ep = value; // without end correctly
-        return NULL;
-    }
-}
-
-static const char *parse_object(JNODE_p node, const char *value) {
-    JNODE_p child;
-
-    node->type = J_Object;
-    value = skip_invalid(value + 1);
-    if (*value == '}')
-        return value + 1; /* empty array. */
-
-    node->child = child = new_node();
-    // Parse name
-    value = skip_invalid(parse_string(child, skip_invalid(value)));
-    if (!value) return NULL; // Not end yet
-    child->name = child->value.string_val;
-    child->value.string_val = 0;  // reset
-    if (*value != ':') {
-        perror("Incorrect format, without arr ':' before assignment.\n");
-        ep = value;
-        return NULL;
-    }
-    // parse value
-    value = skip_invalid(parse_value(child, skip_invalid(value + 1)));
-    if (!value) return NULL;
-
-    while (*value == ',') {
-        JNODE_p new_item = new_node();
-        child->next = new_item;
-        new_item->prev = child;
-        // Parse name
-        child = new_item;
-        value = skip_invalid(parse_string(child, skip_invalid(value + 1)));
-        if (!value) return NULL;
-        child->name = child->value.string_val;
-        child->value.string_val = 0;  // reset
-        if (*value != ':') {
-            perror("Incorrect format, without arr ':' before assignment.\n");
-            ep = value;
-            return 0;
-        }
-        // parse value
-        value = skip_invalid(parse_value(child, skip_invalid(value + 1)));
-        if (!value) return NULL;
-    }
-
-    if (*value == '}')
-        return value + 1; /* end of object */
-    else {
-        perror("Incorrect format, without arr '}'.\n");
-        ep = value; // without end correctly
-        return NULL;
-    }
-}
-
-
-static char *print_const(const char *str)
-{
-    size_t len;
-    len = strlen(str) + 1;
-    char *copy = (char *)emalloc(sizeof(char) * len);
-    memcpy(copy, str, len);
-    return copy;
-}
-
-static char *print_value(JNODE_p node, int depth) {
-    char *out = 0;
-    if (!node) return NULL;
-    switch ((node->type) & 255) {
-        case J_NULL:
-            out = print_const("null");
-            break;
-        case J_False:
-            out = print_const("false");
-            break;
-        case J_True:
-            out = print_const("true");
-            break;
-        case J_Int:
-            out = print_number(node);
-            break;
-        case J_Double:
-            out = print_number(node);
-            break;
-        case J_String:
-            out = print_string(node);
-            break;
-        case J_Array:
-            out = print_array(node, depth);
-            break;
-        case J_Object:
-            out = print_object(node, depth);
-            break;
-    }
-    return out;
-}
-
-
-static char *print_number(JNODE_p node) {
-    char *str = 0;
-    int type = node->type;
-
-    if (type == J_Int) {
-        int num = node->value.int_val;
-        if (num <= INT32_MAX && num >= INT32_MIN) {
-            str = (char *)emalloc(sizeof(char) * 21);
-            sprintf(str, "%d", node->value.int_val);
-        } else {
-            printf("Node %s : \n", node->name);
-            error_exit(4, "Integer value overflow. \n");
-        }
-    }
-    else if (type == J_Double) {
-        double num = node->value.double_val;
-        if (num <= DBL_MAX && num >= DBL_MIN) {
-            str = (char *)emalloc(sizeof(char) * 64);
-            sprintf(str, "%lf", node->value.double_val);
-        } else {
-            printf("Node %s : \n", node->name);
-            error_exit(4, "Double value overflow. \n");
-        }
-    }
-
-    return str;
-}
-
-
-static char *print_string_base(const char *str) {
-    const char *ptr = NULL;
-    char *out = NULL;
-
-    if (!str) { // empty
-        out = (char *)emalloc(sizeof(char) * 3);
-        strcpy(out, "\"\"");
-        return out;
-    }
-
-    int flag_escaped = 0;
-    for (ptr = str; *ptr; ptr++) {
-        if ((*ptr > 0 && *ptr < 32) || (*ptr == '\"') || (*ptr == '\\'))
-            flag_escaped = 1;
-    }
-
-    int len = 0;
-    char *scan = NULL;
-    if (!flag_escaped)  // Without escaped chars
-    {
-        len = ptr - str;
-        out = (char *)emalloc(sizeof(char) * (len + 3));
-        scan = out;
-        *scan++ = '\"';
-        strcpy(scan, str);
-        scan[len] = '\"';
-        scan[len + 1] = 0;
-        return out;
-    }
-
-    // get length with escaped chars
-    ptr = str;
-    unsigned char token;
-    while ((token = *ptr) && ++len)
-    {
-        if (strchr("\"\\\b\f\n\r\t", token))  // length add 1
-            len++;
-        else if (token < 32)
-            len += 5;
-        ptr++;
-    }
-
-    out = (char *)emalloc(sizeof(char) * (len + 3));
-    scan = out;
-    ptr = str;
-    *scan++ = '\"';
-    while (*ptr)
-    {
-        if ((unsigned char)*ptr > 31 && *ptr != '\"' && *ptr != '\\')
-            *scan++ = *ptr++;
-        else
-        {
-            /* escape and print */
-            *scan++ = '\\';
-            switch (token = *ptr++)
-            {
-                case '\\':
-                    *scan++ = '\\';
-                    break;
-                case '\"':
-                    *scan++ = '\"';
-                    break;
-                case '\b':
-                    *scan++ = 'b';
-                    break;
-                case '\f':
-                    *scan++ = 'f';
-                    break;
-                case '\n':
-                    *scan++ = 'n';
-                    break;
-                case '\r':
-                    *scan++ = 'r';
-                    break;
-                case '\t':
-                    *scan++ = 't';
-                    break;
-                default:
-                    sprintf(scan, "u%04x", token);
-                    scan += 5;
-                    break;
-            }
-        }
-    }
-    *scan++ = '\"';
-    *scan++ = 0;
-    return out;
-}
-
-static char *print_string(JNODE_p node) {
-    return print_string_base(node->value.string_val);
-}
-
-
-static char *print_array(JNODE_p node, int depth)
-{
-    /* How many entries in the array? */
-    int num_child = 0;
-    JNODE_p child = node->child;
-    while (child)
-        num_child++, child = child->next;
-    /* Explicitly handle num_child==0 */
-    char *out = 0;
-    if (!num_child) {
-        out = (char *)emalloc(sizeof(char) * 3);
-        if (out)
-            strcpy(out, "[]");
-        return out;
-    }
-
-    /* Allocate an array to hold the values for each */
-    char **entries;
-    entries = (char **)emalloc(num_child * sizeof(char *));
-    memset(entries, 0, num_child * sizeof(char *));
-
-    /* Retrieve all the results: */
-    int len = 5, i = 0, fail = 0;
-    char *ret = NULL;
-    child = node->child;
-    while (child && !fail)
-    {
-        ret = print_value(child, depth + 1);
-        entries[i++] = ret;
-        if (ret)
-            len += strlen(ret) + 3;
-        else
-            fail = 1;
-        child = child->next;
-    }
-
-    /* Handle failure. */
-    if (fail) {
-        for (i = 0; i < num_child; i++)
-            if (entries[i])
-                safe_free(entries[i]);
-        safe_free(entries);
-        return 0;
-    }
-
-    /* Compose the output array. */
-    out = (char *)emalloc(sizeof(char) * len);
-    char *scan = out + 1;
-    *scan = 0;
-    *out = '[';
-    size_t tmplen = 0;
-    for (i = 0; i < num_child; i++) {
-        tmplen = strlen(entries[i]);
-        memcpy(scan, entries[i], tmplen);
-        scan += tmplen;
-        if (i != num_child - 1) {
-            *scan++ = ',';
-            *scan++ = ' ';
-            *scan = 0;
-        }
-        safe_free(entries[i]);
-    }
-    safe_free(entries);
-    *scan++ = ']';
-    *scan++ = 0;
-    return out;
-}
-
-static char *print_object(JNODE_p node, int depth)
-{
-    /* Count the number of entries. */
-    int num_child = 0;
-    JNODE_p child = node->child;
-    while (child)
-        num_child++, child = child->next;
-
-    /* Explicitly handle empty object case */
-    char *scan = NULL;
-    char *out = NULL;
-    if (!num_child) {
-        out = (char *)emalloc(sizeof(char) * (depth + 5));
-        scan = out;
-        *scan++ = '{';
-        *scan++ = '\n';
-        for (int i = 0; i < depth - 1; i++)
-            *scan++ = '\t';
-        *scan++ = '}';
-        *scan++ = 0;
-        return out;
-    }
-
-    /* Allocate space for the names and the objects */
-    char **entries = NULL, **names = NULL;
-    entries = (char **)emalloc(num_child * sizeof(char *));
-    names = (char **)emalloc(num_child * sizeof(char *));
-    memset(entries, 0, sizeof(char *) * num_child);
-    memset(names, 0, sizeof(char *) * num_child);
-
-    /* Collect all the results into our arrays: */
-    char *str = NULL, *ret = NULL;
-    int len = 10, i = 0, fail = 0;
-    child = node->child;
-    depth++;
-    len += depth;
-    while (child && !fail) {
-        names[i] = str = print_string_base(child->name);
-        entries[i++] = ret = print_value(child, depth);
-        if (str && ret)
-            len += strlen(ret) + strlen(str) + 5 + depth;
-        else
-            fail = 1;
-        child = child->next;
-    }
-
-    /* Handle failure */
-    if (fail) {
-        for (i = 0; i < num_child; i++)
-        {
-            if (names[i])
-                safe_free(names[i]);
-            if (entries[i])
-                safe_free(entries[i]);
-        }
-        safe_free(names);
-        safe_free(entries);
-        return 0;
-    }
-
-    /* Compose the output: */
-    size_t tmplen = 0;
-    int j = 0;
-    out = (char *)emalloc(sizeof(char) * len);
-    *out = '{';
-    scan = out + 1;
-    *scan++ = '\n';
-    *scan = 0;
-    for (i = 0; i < num_child; i++)
-    {
-        for (j = 0; j < depth; j++)
-            *scan++ = '\t';
-
-        tmplen = strlen(names[i]);
-        memcpy(scan, names[i], tmplen);
-
-        scan += tmplen;
-        *scan++ = ':';
-        *scan++ = '\t';
-
-        strcpy(scan, entries[i]);
-        scan += strlen(entries[i]);
-        if (i != num_child - 1)
-            *scan++ = ',';
-        *scan++ = '\n';
-        *scan = 0;
-
-        safe_free(names[i]);
-        safe_free(entries[i]);
-    }
-    safe_free(names);
-    safe_free(entries);
-    for (i = 0; i < depth - 1; i++)
-        *scan++ = '\t';
-    *scan++ = '}';
-    *scan++ = 0;
-    return out;
-}
-
-
-
-
-
+/*************************************************************************
+	> File Name: include/cjson.h
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Created Time: Wed 25 Aug 2021 06:25:21 PM CST
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define WRITE_BUF 4096
+#define READ_BUF 65536
+
+/* Where parsed nodes and strings are allocated */
+typedef struct ParseCtx {
+    JARENA_p arena;
+    int insitu;         // strings are unescaped inside the input buffer
+    const char *error;  // where parsing failed
+    int code;           // why, one of JSON_ERR_*
+} PCTX_t, *PCTX_p;
+
+static int strcmp_case(const char *s1, const char *s2);
+static const char *skip_invalid(const char *value);
+
+static JNODE_p new_node(void);
+static JNODE_p ctx_node(PCTX_p ctx);
+static char *ctx_string(PCTX_p ctx, size_t size);
+static JNODE_p json_parse_ctx(PCTX_p ctx, const char *value, JERROR_t *err);
+static const char *parse_fail(PCTX_p ctx, const char *at, int code);
+static JNODE_p find_member(JNODE_p obj, const char *name, JNODE_p *parent);
+static int add_item(JNODE_p array, JNODE_p node);
+static int add_member(JNODE_p object, const char *name, JNODE_p node);
+static void list_unlink(JNODE_p parent, JNODE_p c);
+static int list_swap(JNODE_p parent, JNODE_p c, JNODE_p newitem, size_t pos);
+
+static const char *parse_value(PCTX_p ctx, JNODE_p node, const char *value);
+static const char *parse_string(PCTX_p ctx, JNODE_p node, const char *value);
+static int take_name(PCTX_p ctx, JNODE_p child);
+static const char *parse_number(PCTX_p ctx, JNODE_p node, const char *value);
+static const char *parse_array(PCTX_p ctx, JNODE_p node, const char *value);
+static const char *parse_object(PCTX_p ctx, JNODE_p node, const char *value);
+
+static char *print_const(const char *str);
+static int name_copy(JNODE_p node, const char *name);
+static int print_value(JBUF_p out, JNODE_p node, int depth);
+static int print_number(JBUF_p out, JNODE_p node);
+static void print_string_base(JBUF_p out, const char *str);
+static void print_string(JBUF_p out, JNODE_p node);
+static int print_array(JBUF_p out, JNODE_p node, int depth);
+static int print_object(JBUF_p out, JNODE_p node, int depth);
+static int print_styled(JBUF_p out, JNODE_p node, int depth);
+
+static void show_search_result(JNODE_p node, const char *name);
+
+static int load_stream(int fd, TFILE_t *file);
+static int write_file(void *ctx, const char *data, size_t len);
+static int write_fd(void *ctx, const char *data, size_t len);
+
+/* Functions for input and output */
+JNODE_p text_to_json(char *text) {
+    JERROR_t err;
+    JNODE_p json = json_parse_r(text, NULL, &err);
+    if (!json) {
+        printf("Parsing input failed, %s at line %zu column %zu. Error before: %s \n",
+               json_strerror(err.code), err.line, err.column, text + err.offset);
+        exit(EXIT_FAILURE);
+    }
+    return json;
+}
+
+JNODE_p read_json(char *filename) {
+    TFILE_t file;
+    if (!load_file(filename, &file))
+        error_exit(3, "Failed to read input file. \n");
+
+    JNODE_p json = text_to_json(file.text);
+    unload_file(&file);
+    return json;
+}
+
+void output_json(JNODE_p root, FILE *out) {
+    if (!json_write_file(root, out)) {
+        error_exit(3, "Failed to foramt json object. \n");
+    }
+    fprintf(out, " \n");
+}
+
+/* Stream the formatted text through a WRITE_BUF sized staging buffer,
+ * memory use does not depend on the size of the document. */
+int json_write(JNODE_p root, JWRITE_f write, void *ctx) {
+    char stage[WRITE_BUF];
+    JBUF_t out = {stage, 0, sizeof(stage), 0, write, ctx, 0};
+    if (!print_value(&out, root, 0))
+        return 0;
+    return buf_drain(&out);
+}
+
+int json_write_style(JNODE_p root, int indent, JWRITE_f write, void *ctx) {
+    char stage[WRITE_BUF];
+    JBUF_t out = {stage, 0, sizeof(stage), 0, write, ctx, 0, 1, indent};
+    if (indent < JSON_TABS || !print_value(&out, root, 0))
+        return 0;
+    return buf_drain(&out);
+}
+
+int json_write_file(JNODE_p root, FILE *fp) {
+    return json_write(root, write_file, fp);
+}
+
+int json_write_fd(JNODE_p root, int fd) {
+    return json_write(root, write_fd, &fd);
+}
+
+/* Functions for parsing text to json */
+JNODE_p json_parse(const char *value) {
+    return json_parse_r(value, NULL, NULL);
+}
+
+JNODE_p json_parse_arena(const char *value, JARENA_p arena) {
+    return json_parse_r(value, arena, NULL);
+}
+
+JNODE_p json_parse_insitu(char *buf) {
+    return json_parse_insitu_r(buf, NULL, NULL);
+}
+
+JNODE_p json_parse_insitu_arena(char *buf, JARENA_p arena) {
+    return json_parse_insitu_r(buf, arena, NULL);
+}
+
+/* Reentrant parsing, every bit of state lives on the stack. What the
+   index engine built before giving up is dropped before descending. */
+JNODE_p json_parse_r(const char *value, JARENA_p arena, JERROR_t *err) {
+    PCTX_t ctx = {arena, 0, NULL, JSON_OK};
+    MARK_t mark;
+    if (arena)
+        arena_mark(arena, &mark);
+    JNODE_p root = stage_parse(value, arena);
+    if (root) {
+        if (err) memset(err, 0, sizeof(JERROR_t));
+        return root;
+    }
+    if (arena)
+        arena_rollback(arena, &mark);
+    return json_parse_ctx(&ctx, value, err);
+}
+
+JNODE_p json_parse_insitu_r(char *buf, JARENA_p arena, JERROR_t *err) {
+    PCTX_t ctx = {arena, 1, NULL, JSON_OK};
+    return json_parse_ctx(&ctx, buf, err);
+}
+
+JNODE_p json_read_r(const char *filename, JARENA_p arena, JERROR_t *err) {
+    TFILE_t file;
+    if (!load_file(filename, &file)) {
+        if (err) {
+            memset(err, 0, sizeof(JERROR_t));
+            err->code = JSON_ERR_IO;
+        }
+        return NULL;
+    }
+    JNODE_p root = json_parse_r(file.text, arena, err);
+    unload_file(&file);
+    return root;
+}
+
+const char *json_strerror(int code) {
+    static const char *const messages[] = {
+        "no error",
+        "unexpected end of text",
+        "invalid value",
+        "malformed number",
+        "unterminated string",
+        "member name is not a string",
+        "missing ':' after member name",
+        "missing ',' or ']' in array",
+        "missing ',' or '}' in object",
+        "insufficient memory",
+        "cannot read input"
+    };
+    if (code < 0 || code >= (int)(sizeof(messages) / sizeof(messages[0])))
+        return "unknown error";
+    return messages[code];
+}
+
+static JNODE_p json_parse_ctx(PCTX_p ctx, const char *value, JERROR_t *err) {
+    const char *end = NULL;
+    JNODE_p c = ctx_node(ctx);
+    if (!c)
+        parse_fail(ctx, value, JSON_ERR_NOMEM);
+    else
+        end = parse_value(ctx, c, skip_invalid(value));
+    if (err) {
+        memset(err, 0, sizeof(JERROR_t));
+        err->code = end ? JSON_OK : ctx->code;
+    }
+    if (end)
+        return c;
+
+    json_delete(c);
+    if (err) {
+        /* Positions are only worked out for the error path. In situ the
+           text before the error is already unescaped, so the offset is
+           exact but lines also count unescaped \n escapes. */
+        err->offset = ctx->error - value;
+        err->line = 1;
+        const char *line = value;
+        for (const char *p = value; p < ctx->error; p++)
+            if (*p == '\n')
+                err->line++, line = p + 1;
+        err->column = ctx->error - line + 1;
+    }
+    return NULL;
+}
+
+/* Record the first error, parse_* return what this returns */
+static const char *parse_fail(PCTX_p ctx, const char *at, int code) {
+    ctx->error = at;
+    ctx->code = *at || code == JSON_ERR_NOMEM ? code : JSON_ERR_END;
+    return NULL;
+}
+
+// Arena nodes are skipped, json_arena_destroy owns them
+void json_delete(JNODE_p root) {
+    JNODE_p next;
+    while (root) {
+        next = root->next;
+        if (root->type & ARENA_BIT) {
+            root = next;
+            continue;
+        }
+        if (root->child) json_delete(root->child);
+        if (is_container(root) && root->value.list.index)
+            index_drop(root);
+        if (((root->type & TYPE_MASK) == J_String) && root->value.string_val
+            && !(root->type & (BORROW_BIT | SMALL_BIT)))
+            safe_free(root->value.string_val);
+        if (!(root->type & (CONST_BIT | SMALL_NAME_BIT)) && root->name)
+            safe_free(root->name);
+        safe_free(root);
+        root = next;
+    }
+}
+
+/* Function for formating json struct, return char* to arr print function */
+char *json_format(JNODE_p root) {
+    JBUF_t out = {NULL, 0, 0, 0, NULL, NULL, 0};
+    if (!print_value(&out, root, 0))
+        out.failed = 1;
+    buf_putc(&out, 0);
+    if (out.failed) {
+        safe_free(out.buf);
+        return NULL;
+    }
+    return out.buf;
+}
+
+char *json_format_style(JNODE_p root, int indent) {
+    JBUF_t out = {NULL, 0, 0, 0, NULL, NULL, 0, 1, indent};
+    if (indent < JSON_TABS)
+        return NULL;
+    if (!print_value(&out, root, 0))
+        out.failed = 1;
+    buf_putc(&out, 0);
+    if (out.failed) {
+        safe_free(out.buf);
+        return NULL;
+    }
+    return out.buf;
+}
+
+/* Format into the caller's buffer without allocating. *needed receives
+ * the size of the full text including the terminator; returns 0 when
+ * it did not fit in cap (buf then holds a truncated prefix). A tree that
+ * cannot be formatted (a NULL root or a node of no known type) returns
+ * 0 with *needed 0 and buf empty. */
+int json_format_into(JNODE_p root, char *buf, size_t cap, size_t *needed) {
+    JBUF_t out = {buf, 0, cap, 1, NULL, NULL, 0};
+    if (!print_value(&out, root, 0)) {
+        if (needed) *needed = 0;
+        if (cap) buf[0] = 0;
+        return 0;
+    }
+    buf_putc(&out, 0);
+    if (needed) *needed = out.len;
+    if (out.len > cap) {
+        if (cap) buf[cap - 1] = 0;
+        return 0;
+    }
+    return 1;
+}
+
+/* Functions to create object */
+JNODE_p create_null(void) {
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_NULL;
+    return node;
+}
+
+JNODE_p create_true(void){
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_True;
+    return node;
+}
+
+JNODE_p create_false(void){
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_False;
+    return node;
+}
+
+JNODE_p create_int(int num) {
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_Int;
+    node->value.int_val = num;
+    return node;
+}
+
+JNODE_p create_int64(int64_t num) {
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_Int64;
+    node->value.int64_val = num;
+    return node;
+}
+
+JNODE_p create_double(double num) {
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_Double;
+    node->value.double_val = num;
+    return node;
+}
+
+JNODE_p create_string(const char *str) {
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_String;
+    size_t len = strlen(str);
+    if (len <= SMALL_MAX)
+        memcpy(small_value(node), str, len + 1);
+    else if (!(node->value.string_val = print_const(str))) {
+        json_delete(node);
+        return NULL;
+    }
+    return node;
+}
+
+JNODE_p create_array(void) {
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_Array;
+    return node;
+}
+
+JNODE_p create_object(void) {
+    JNODE_p node = new_node();
+    if (!node) return NULL;
+    node->type = J_Object;
+    return node;
+}
+
+/* Functions to create array with elements */
+JNODE_p json_int_array(const int *nums, int len) {
+    JNODE_p arr = create_array();
+    for (int i = 0; arr && i < len; i++)
+        if (!add_item(arr, create_int(nums[i]))) {
+            json_delete(arr);
+            return NULL;
+        }
+    return arr;
+}
+
+JNODE_p json_double_array(const double *nums, int len) {
+    JNODE_p arr = create_array();
+    for (int i = 0; arr && i < len; i++)
+        if (!add_item(arr, create_double(nums[i]))) {
+            json_delete(arr);
+            return NULL;
+        }
+    return arr;
+}
+
+JNODE_p json_string_array(const char **strs, int len) {
+    JNODE_p arr = create_array();
+    for (int i = 0; arr && i < len; i++)
+        if (!add_item(arr, create_string(strs[i]))) {
+            json_delete(arr);
+            return NULL;
+        }
+    return arr;
+}
+
+/* Functions to add node at object(with arr name) */
+int json_add_null(JNODE_p obj, const char *name) {
+    return add_member(obj, name, create_null());
+}
+
+int json_add_true(JNODE_p obj, const char *name) {
+    return add_member(obj, name, create_true());
+}
+
+int json_add_false(JNODE_p obj, const char *name) {
+    return add_member(obj, name, create_false());
+}
+
+int json_add_int(JNODE_p obj, const char *name, int num) {
+    return add_member(obj, name, create_int(num));
+}
+
+int json_add_int64(JNODE_p obj, const char *name, int64_t num) {
+    return add_member(obj, name, create_int64(num));
+}
+
+int json_add_double(JNODE_p obj, const char *name, double num) {
+    return add_member(obj, name, create_double(num));
+}
+
+int json_add_string(JNODE_p obj, const char *name, char *str) {
+    return add_member(obj, name, create_string(str));
+}
+
+/* A new node linked in, or dropped when it cannot be */
+static int add_item(JNODE_p array, JNODE_p node) {
+    if (json_add_to_array(array, node))
+        return 1;
+    json_delete(node);
+    return 0;
+}
+
+static int add_member(JNODE_p object, const char *name, JNODE_p node) {
+    if (json_add_to_object(object, name, node, 1))
+        return 1;
+    json_delete(node);
+    return 0;
+}
+
+/* Functions to add node at array or object(with arr name) */
+int json_add_to_array(JNODE_p array, JNODE_p node) {
+    JNODE_p tail = array->value.list.tail;
+    if (!node)
+        return 0;
+    if (!(node->type & ARENA_BIT) && !arena_adopt(array))
+        return 0;
+    if (!tail)
+        array->child = node;
+    else {
+        tail->next = node;
+        node->prev = tail;
+    }
+    array->value.list.tail = node;
+    array->size++;
+    if (array->value.list.index)
+        index_insert(array, node);
+    return 1;
+}
+
+int json_add_to_object(JNODE_p object, const char *name, JNODE_p node, int on_heap) {
+    if (!node)
+        return 0;
+    if (on_heap) {
+        if (!name_copy(node, name))
+            return 0;
+    } else {
+        if (node->name && !(node->type & (CONST_BIT | ARENA_BIT | SMALL_NAME_BIT)))
+            safe_free(node->name);
+        node->name = (char *)name;
+        node->type = (node->type & ~SMALL_NAME_BIT) | CONST_BIT;
+    }
+    return json_add_to_array(object, node);
+}
+
+/* Functions to delete node from array or object(with arr name) */
+void json_del_from_array(JNODE_p array, int idx) {
+    json_delete(json_detach_from_array(array, idx, 0));
+}
+
+void json_del_from_object(JNODE_p obj, const char *name) {
+    json_delete(json_detach_from_object(obj, name));
+}
+
+// no_child = 1: when using this function at json_detach_from_object
+JNODE_p json_detach_from_array(JNODE_p array, int idx, int no_child) {
+    JNODE_p c = NULL;
+    if (no_child) {
+        c = array;
+        while (c && idx > 0)
+            c = c->next, idx--;
+    } else if (idx >= 0) {
+        c = child_at(array, idx, 0);
+    }
+    if (!c) error_exit(6, "Failed to detach from json, index error.\n");
+    list_unlink(no_child ? NULL : array, c);
+    return c;
+}
+
+JNODE_p json_detach_from_object(JNODE_p obj, const char *name) {
+    JNODE_p parent = NULL;
+    JNODE_p c = find_member(obj, name, &parent);
+    if (!c) return NULL;
+    list_unlink(parent, c);
+    return c;
+}
+
+/* Functions to replace arr node in array or object(with arr name) */
+// no_child = 1: when using this function at json_replace_object, otherwise 0.
+int json_replace_array(JNODE_p array, int idx, JNODE_p newitem, int no_child) {
+    JNODE_p c = NULL;
+    if (!newitem)
+        return 0;
+    if (no_child) {
+        c = array;
+        while (c && idx > 0)
+            c = c->next, idx--;
+    } else if (idx >= 0) {
+        c = child_at(array, idx, 0);
+    }
+    if (!c) error_exit(6, "Failed to replace from json, index error.\n");
+    if (!list_swap(no_child ? NULL : array, c, newitem, idx))
+        return 0;
+    json_delete(c);
+    return 1;
+}
+
+int json_replace_object(JNODE_p obj, const char *name, JNODE_p newitem) {
+    JNODE_p parent = NULL;
+    JNODE_p c = find_member(obj, name, &parent);
+    if (!c || !newitem || !name_copy(newitem, name)) return 0;
+    if (!list_swap(parent, c, newitem, (size_t)-1))
+        return 0;
+    json_delete(c);
+    return 1;
+}
+
+/* Unlink c from the children of parent, NULL when the container is unknown */
+static void list_unlink(JNODE_p parent, JNODE_p c) {
+    if (parent && is_container(parent)) {
+        if (parent->value.list.index)
+            index_remove(parent, c);
+        if (c == parent->value.list.tail)
+            parent->value.list.tail = c->prev;
+        parent->size--;
+    }
+    if (c->prev)
+        c->prev->next = c->next;
+    if (c->next)
+        c->next->prev = c->prev;
+    if (parent && c == parent->child)  // first child
+        parent->child = c->next;
+    c->prev = c->next = NULL;
+}
+
+/* Put newitem where c is, child pos of parent when known (else -1). 0,
+   with nothing relinked, when an arena parent cannot adopt a heap node. */
+static int list_swap(JNODE_p parent, JNODE_p c, JNODE_p newitem, size_t pos) {
+    if (parent && !(newitem->type & ARENA_BIT) && !arena_adopt(parent))
+        return 0;
+    newitem->next = c->next;
+    newitem->prev = c->prev;
+    if (newitem->next)
+        newitem->next->prev = newitem;
+    if (parent && c == parent->child)  // first child
+        parent->child = newitem;
+    else if (newitem->prev)
+        newitem->prev->next = newitem;
+    if (parent && is_container(parent)) {
+        if (parent->value.list.index)
+            index_replace(parent, c, newitem, pos);
+        if (c == parent->value.list.tail)
+            parent->value.list.tail = newitem;
+    }
+    c->next = c->prev = NULL;
+    return 1;
+}
+
+/* Depth first search for a named node, reporting the container holding it */
+static JNODE_p find_member(JNODE_p obj, const char *name, JNODE_p *parent) {
+    JNODE_p c = obj, out = NULL;
+    while (c) {
+        if (!strcmp_case(c->name, name))
+            return c;
+        if (c->child) {
+            out = find_member(c->child, name, parent);
+            if (out) {
+                if (!*parent) *parent = c;
+                return out;
+            }
+        }
+        c = c->next;
+    }
+    return NULL;
+}
+
+/* Functions to find arr node by name*/
+JNODE_p json_get(JNODE_p root, const char *name) {
+    JNODE_p c = root, out = NULL;
+    while (c && !out) {
+        if (!strcmp_case(c->name, name)) {
+            (void)show_search_result(c, name);
+            out = c;
+            return out;
+        }
+        if (c->child)
+            out = json_get(c->child, name);
+        c = c->next;
+    }
+    if (!out) {
+        printf("Key [%s] not found. \n", name);
+        return NULL;
+    }
+    return out;
+}
+
+/* Functions for positional access to array or object */
+size_t json_array_size(JNODE_p array) {
+    if (!array || !is_container(array))
+        return 0;
+    return array->size;
+}
+
+JNODE_p json_array_get(JNODE_p array, size_t idx) {
+    if (!array || !is_container(array))
+        return NULL;
+    return child_at(array, idx, 1);
+}
+
+/* Functions on the direct members of an object */
+JNODE_p json_object_get(JNODE_p obj, const char *name) {
+    if (!obj || (obj->type & TYPE_MASK) != J_Object || !name)
+        return NULL;
+    return member_find(obj, name);
+}
+
+JNODE_p json_object_detach(JNODE_p obj, const char *name) {
+    JNODE_p c = json_object_get(obj, name);
+    if (c)
+        list_unlink(obj, c);
+    return c;
+}
+
+int json_object_replace(JNODE_p obj, const char *name, JNODE_p newitem) {
+    JNODE_p c = json_object_get(obj, name);
+    if (!c || !newitem) return 0;
+    if (!name_copy(newitem, c->name) || !list_swap(obj, c, newitem, (size_t)-1))
+        return 0;
+    json_delete(c);
+    return 1;
+}
+
+void json_object_case_sensitive(JNODE_p obj, int on) {
+    if (!obj || (obj->type & TYPE_MASK) != J_Object)
+        return;
+    index_drop(obj);  // hashed the other way
+    if (on)
+        obj->type |= CASE_BIT;
+    else
+        obj->type &= ~CASE_BIT;
+}
+
+static void show_search_result(JNODE_p node, const char *name) {
+    switch (node->type & TYPE_MASK) {
+        case J_NULL: {
+            printf("Key: [%s] , value: [%s]. \n", name, "null");
+            break;
+        }
+        case J_False: {
+            printf("Key: [%s] , value: [%s]. \n", name, "false");
+            break;
+        }
+        case J_True: {
+            printf("Key: [%s] , value: [%s]. \n", name, "true");
+            break;
+        }
+        case J_Int: {
+            printf("Key: [%s] , value: [%d]. \n", name, node->value.int_val);
+            break;
+        }
+        case J_Int64: {
+            printf("Key: [%s] , value: [%" PRId64 "]. \n", name, node->value.int64_val);
+            break;
+        }
+        case J_Double: {
+            printf("Key: [%s] , value: [%lf]. \n", name, node->value.double_val);
+            break;
+        }
+        case J_String: {
+            printf("Key: [%s] , value: [%s]. \n", name, node->value.string_val);
+            break;
+        }
+        default: {
+            printf("Key: [%s] , can`t get value of this node. \n", name);
+            break;
+        }
+    }
+}
+
+/**********************************************************************************/
+/* Static functions */
+static JNODE_p new_node(void) {
+    JNODE_p node = (JNODE_p)emalloc(sizeof(JNODE_t));
+    if (node) memset(node, 0, sizeof(JNODE_t));
+    return node;
+}
+
+/* The parser reports running out of memory instead of exiting */
+static JNODE_p ctx_node(PCTX_p ctx) {
+    if (ctx->arena)
+        return arena_node(ctx->arena);
+    JNODE_p node = (JNODE_p)emalloc(sizeof(JNODE_t));
+    if (node) memset(node, 0, sizeof(JNODE_t));
+    return node;
+}
+
+static char *ctx_string(PCTX_p ctx, size_t size) {
+    if (ctx->arena)
+        return (char *)arena_alloc(ctx->arena, size, 1);
+    return (char *)emalloc(sizeof(char) * size);
+}
+
+/* If s1 == s2, return 0 */
+static int strcmp_case(const char *s1, const char *s2)
+{
+    if (s1 == s2 && s1)
+        return 0;  // interned names
+    if (!s1 || !s2)
+        return 1;
+    return strcmp_ascii(s1, s2);
+}
+
+
+static const char *skip_invalid(const char *value) {
+    if (!value || (unsigned char) *value > 32 || !*value)
+        return value;
+    return scan_space(value + 1);
+}
+
+static const char *parse_value(PCTX_p ctx, JNODE_p node, const char *value) {
+    if (!strncmp(value, "null", 4)) {
+        set_type(node, J_NULL);
+        return value + 4;
+    }
+    if (!strncmp(value, "false", 5)) {
+        set_type(node, J_False);
+        node->value.int_val = 0;
+        return value + 5;
+    }
+    if (!strncmp(value, "true", 4)) {
+        set_type(node, J_True);
+        node->value.int_val = 1;
+        return value + 4;
+    }
+    if (*value == '\"') { return parse_string(ctx, node, value); }
+    if (*value == '-' || (*value >= '0' && *value <= '9')) {
+        return parse_number(ctx, node, value);
+    }
+    if (*value == '[') { return parse_array(ctx, node, value); }
+    if (*value == '{') { return parse_object(ctx, node, value); }
+
+    return parse_fail(ctx, value, JSON_ERR_VALUE);
+}
+
+static const char *parse_string(PCTX_p ctx, JNODE_p node, const char *value) {
+    const char *ptr = value + 1;
+    size_t len = 0;
+    char *out = NULL;
+    if (ctx->insitu) {
+        /* Unescaping never lengthens a string, write over the input */
+        out = (char *)ptr;
+    } else {
+        /* Escapes only shrink, the raw span bounds the length */
+        while (*(ptr = scan_string(ptr)) == '\\') {
+            if (*++ptr)
+                ptr++;  /* Skip escaped quotes. \\ means \ in code. \\ in text is escaped quotes*/
+        }
+        if (!*ptr)
+            return parse_fail(ctx, value, JSON_ERR_STRING);
+        len = ptr - (value + 1);
+        out = len <= SMALL_MAX ? small_value(node) : ctx_string(ctx, len + 1);
+        if (!out)
+            return parse_fail(ctx, value, JSON_ERR_NOMEM);
+    }
+
+    ptr = string_unescape(out, value + 1, NULL);
+    if (!ptr)
+        return parse_fail(ctx, value, JSON_ERR_STRING);
+    node->value.string_val = out;
+    set_type(node, J_String);
+    if (ctx->insitu)
+        node->type |= BORROW_BIT;
+    return ptr;
+}
+
+/* Unescape the string body at ptr (just past the opening quote) into out,
+ * which may be ptr itself. Returns the end past the closing quote, or NULL
+ * when the text ends first. */
+const char *string_unescape(char *out, const char *ptr, size_t *len) {
+    char *scan = out;
+    while (*ptr != '\"' && *ptr) {
+        const char *run = scan_string(ptr);
+        if (run != ptr) {
+            if (scan != ptr)
+                memmove(scan, ptr, run - ptr);
+            scan += run - ptr;
+            ptr = run;
+        }
+        if (*ptr == '\\') {
+            ptr++;
+            switch (*ptr) {
+                case 'b':
+                    *scan++ = '\b';
+                    break;
+                case 'f':
+                    *scan++ = '\f';
+                    break;
+                case 'n':
+                    *scan++ = '\n';
+                    break;
+                case 'r':
+                    *scan++ = '\r';
+                    break;
+                case 't':
+                    *scan++ = '\t';
+                    break;
+                default:
+                    *scan++ = *ptr;
+                    break;
+            }
+            if (*ptr) ptr++;
+        }
+    }
+    const char *end = *ptr == '\"' ? ptr + 1 : NULL;
+    *scan = 0; // end, may overwrite the closing quote when in situ
+    if (len) *len = scan - out;
+    return end;
+}
+
+/* Move a just parsed key from the string value to the name */
+static int take_name(PCTX_p ctx, JNODE_p child) {
+    if (ctx->insitu) {
+        child->name = child->value.string_val;
+        child->value.string_val = 0;  // reset
+        child->type = (child->type & ~BORROW_BIT) | CONST_BIT;
+        return 1;
+    }
+    return take_key(child, ctx->arena);
+}
+
+static const char *parse_number(PCTX_p ctx, JNODE_p node, const char *value) {
+    int type = J_Int;
+    int64_t num = 0;
+    double real = 0;
+    const char *end = number_scan(value, &type, &num, &real);
+
+    if (!end)
+        return parse_fail(ctx, value, JSON_ERR_NUMBER);
+    if (type == J_Int)
+        node->value.int_val = (int)num;
+    else if (type == J_Int64)
+        node->value.int64_val = num;
+    else
+        node->value.double_val = real;
+    set_type(node, type);
+    return end;
+}
+
+static const char *parse_array(PCTX_p ctx, JNODE_p node, const char *value) {
+    JNODE_p child = NULL;
+
+    set_type(node, J_Array);
+    value = skip_invalid(value + 1);
+    if (*value == ']')
+        return value + 1; /* empty array. */
+
+    node->child = node->value.list.tail = child = ctx_node(ctx);
+    if (!child) return parse_fail(ctx, value, JSON_ERR_NOMEM);
+    node->size = 1;
+    value = skip_invalid(parse_value(ctx, child, skip_invalid(value)));
+    if (!value) return NULL;
+
+    while (*value == ',') {
+        JNODE_p new_item = ctx_node(ctx);
+        if (!new_item) return parse_fail(ctx, value, JSON_ERR_NOMEM);
+        child->next = new_item;
+        new_item->prev = child;
+        node->value.list.tail = child = new_item;
+        node->size++;
+        value = skip_invalid(parse_value(ctx, child, skip_invalid(value + 1)));
+        if (!value) return NULL;
+    }
+
+    if (*value == ']')
+        return value + 1; /* end of array */
+    return parse_fail(ctx, value, JSON_ERR_ARRAY); // without end correctly
+}
+
+static const char *parse_object(PCTX_p ctx, JNODE_p node, const char *value) {
+    JNODE_p child;
+
+    set_type(node, J_Object);
+    value = skip_invalid(value + 1);
+    if (*value == '}')
+        return value + 1; /* empty array. */
+
+    node->child = node->value.list.tail = child = ctx_node(ctx);
+    if (!child) return parse_fail(ctx, value, JSON_ERR_NOMEM);
+    node->size = 1;
+    // Parse name
+    if (*value != '\"') return parse_fail(ctx, value, JSON_ERR_KEY);
+    value = skip_invalid(parse_string(ctx, child, value));
+    if (!value) return NULL; // Not end yet
+    if (!take_name(ctx, child))
+        return parse_fail(ctx, value, JSON_ERR_NOMEM);
+    if (*value != ':')
+        return parse_fail(ctx, value, JSON_ERR_COLON);
+    // parse value
+    value = skip_invalid(parse_value(ctx, child, skip_invalid(value + 1)));
+    if (!value) return NULL;
+
+    while (*value == ',') {
+        JNODE_p new_item = ctx_node(ctx);
+        if (!new_item) return parse_fail(ctx, value, JSON_ERR_NOMEM);
+        child->next = new_item;
+        new_item->prev = child;
+        // Parse name
+        node->value.list.tail = child = new_item;
+        node->size++;
+        value = skip_invalid(value + 1);
+        if (*value != '\"') return parse_fail(ctx, value, JSON_ERR_KEY);
+        value = skip_invalid(parse_string(ctx, child, value));
+        if (!value) return NULL;
+        if (!take_name(ctx, child))
+            return parse_fail(ctx, value, JSON_ERR_NOMEM);
+        if (*value != ':')
+            return parse_fail(ctx, value, JSON_ERR_COLON);
+        // parse value
+        value = skip_invalid(parse_value(ctx, child, skip_invalid(value + 1)));
+        if (!value) return NULL;
+    }
+
+    if (*value == '}')
+        return value + 1; /* end of object */
+    return parse_fail(ctx, value, JSON_ERR_OBJECT); // without end correctly
+}
+
+
+static char *print_const(const char *str)
+{
+    size_t len;
+    len = strlen(str) + 1;
+    char *copy = (char *)emalloc(sizeof(char) * len);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+/* Copy a member name into the storage owning the node: its arena's pool,
+   the node itself when short, its arena or the heap. The name it had is
+   freed after the copy, as name may be it. 0 when out of memory, the
+   node is then left without a name. */
+static int name_copy(JNODE_p node, const char *name) {
+    size_t len = strlen(name);
+    JARENA_p arena = node->type & ARENA_BIT ? arena_of(node) : NULL;
+    char *old = node->type & (CONST_BIT | ARENA_BIT | SMALL_NAME_BIT) ? NULL : node->name;
+    node->type &= ~(CONST_BIT | SMALL_NAME_BIT);
+    if (arena_pool(arena)) {
+        node->name = (char *)arena_intern(arena, name, len);
+        node->type |= CONST_BIT;
+    } else if (len <= SMALL_MAX) {
+        memmove(small_name(node), name, len + 1);  // name may be the node's own
+    } else if (arena) {
+        node->name = arena_strdup(arena, name, len);
+    } else {
+        node->name = print_const(name);
+    }
+    safe_free(old);
+    return node->name != NULL;
+}
+
+static int print_value(JBUF_p out, JNODE_p node, int depth) {
+    if (!node) return 0;
+    switch ((node->type) & TYPE_MASK) {
+        case J_NULL:
+            buf_put(out, "null", 4);
+            break;
+        case J_False:
+            buf_put(out, "false", 5);
+            break;
+        case J_True:
+            buf_put(out, "true", 4);
+            break;
+        case J_Int:
+        case J_Int64:
+            return print_number(out, node);
+        case J_Double:
+            return print_number(out, node);
+        case J_String:
+            print_string(out, node);
+            break;
+        case J_Array:
+            if (out->styled)
+                return print_styled(out, node, depth);
+            return print_array(out, node, depth);
+        case J_Object:
+            if (out->styled)
+                return print_styled(out, node, depth);
+            return print_object(out, node, depth);
+        default:
+            return 0;
+    }
+    return 1;
+}
+
+
+/* Formats in place when the buffer has room, else through a local copy */
+static int print_number(JBUF_p out, JNODE_p node) {
+    char local[32];
+    char *str = out->len + sizeof(local) <= out->cap ? out->buf + out->len : local;
+    int len = 0;
+
+    switch (node->type & TYPE_MASK) {
+        case J_Int:
+            len = fmt_int64(str, node->value.int_val);
+            break;
+        case J_Int64:
+            len = fmt_int64(str, node->value.int64_val);
+            break;
+        default:
+            len = fmt_double(str, node->value.double_val);
+            break;
+    }
+    if (str == local)
+        buf_put(out, local, len);
+    else
+        out->len += len;
+    return 1;
+}
+
+
+static void print_string_base(JBUF_p out, const char *str) {
+    const char *ptr = str, *run = str;
+    char esc[8];
+
+    buf_putc(out, '\"');
+    if (!str) { // empty
+        buf_putc(out, '\"');
+        return;
+    }
+
+    /* Copy runs of plain characters at once, escape the rest */
+    for (;; ptr++) {
+        unsigned char token = *ptr;
+        if (token > 31 && token != '\"' && token != '\\')
+            continue;
+        if (ptr > run)
+            buf_put(out, run, ptr - run);
+        if (!token)
+            break;
+        run = ptr + 1;
+        esc[0] = '\\';
+        switch (token)
+        {
+            case '\\':
+                esc[1] = '\\';
+                break;
+            case '\"':
+                esc[1] = '\"';
+                break;
+            case '\b':
+                esc[1] = 'b';
+                break;
+            case '\f':
+                esc[1] = 'f';
+                break;
+            case '\n':
+                esc[1] = 'n';
+                break;
+            case '\r':
+                esc[1] = 'r';
+                break;
+            case '\t':
+                esc[1] = 't';
+                break;
+            default:
+                sprintf(esc + 1, "u%04x", token);
+                buf_put(out, esc, 6);
+                continue;
+        }
+        buf_put(out, esc, 2);
+    }
+    buf_putc(out, '\"');
+}
+
+static void print_string(JBUF_p out, JNODE_p node) {
+    print_string_base(out, node->value.string_val);
+}
+
+
+static int print_array(JBUF_p out, JNODE_p node, int depth)
+{
+    JNODE_p child = node->child;
+
+    buf_putc(out, '[');
+    while (child) {
+        if (!print_value(out, child, depth + 1))
+            return 0;
+        child = child->next;
+        if (child)
+            buf_put(out, ", ", 2);
+    }
+    buf_putc(out, ']');
+    return 1;
+}
+
+static int print_object(JBUF_p out, JNODE_p node, int depth)
+{
+    JNODE_p child = node->child;
+
+    buf_put(out, "{\n", 2);
+    /* Explicitly handle empty object case */
+    if (!child) {
+        buf_tabs(out, depth - 1);
+        buf_putc(out, '}');
+        return 1;
+    }
+
+    depth++;
+    while (child) {
+        buf_tabs(out, depth);
+        print_string_base(out, child->name);
+        buf_put(out, ":\t", 2);
+        if (!print_value(out, child, depth))
+            return 0;
+        child = child->next;
+        if (child)
+            buf_putc(out, ',');
+        buf_putc(out, '\n');
+    }
+    buf_tabs(out, depth - 1);
+    buf_putc(out, '}');
+    return 1;
+}
+
+/* Array or object in the layout out->indent asks for, empty ones on
+ * one line */
+static int print_styled(JBUF_p out, JNODE_p node, int depth) {
+    int object = (node->type & TYPE_MASK) == J_Object;
+    JNODE_p child = node->child;
+
+    buf_putc(out, object ? '{' : '[');
+    for (; child; child = child->next) {
+        buf_break(out, depth + 1);
+        if (object) {
+            print_string_base(out, child->name);
+            buf_put(out, ": ", out->indent == JSON_MINIFY ? 1 : 2);
+        }
+        if (!print_value(out, child, depth + 1))
+            return 0;
+        if (child->next)
+            buf_putc(out, ',');
+    }
+    if (node->child)
+        buf_break(out, depth);
+    buf_putc(out, object ? '}' : ']');
+    return 1;
+}
+
+/* Output buffer slow path, shared with the other writers */
+void buf_put_slow(JBUF_p out, const char *str, size_t n) {
+    if (out->fixed) {  // keep what fits, count the rest
+        if (out->len < out->cap)
+            memcpy(out->buf + out->len, str, n < out->cap - out->len ? n : out->cap - out->len);
+        out->len += n;
+        return;
+    }
+    if (out->flush) {
+        if (!buf_drain(out))
+            return;
+        if (n >= out->cap) {  // too big to stage, hand it over as is
+            if (!out->flush(out->ctx, str, n))
+                out->failed = 1;
+            return;
+        }
+    } else {
+        size_t cap = out->cap ? out->cap : 256;
+        while (cap < out->len + n)
+            cap <<= 1;
+        char *grown = out->failed ? NULL : (char *)erealloc(out->buf, cap);
+        if (!grown) {
+            out->failed = 1;  // the caller drops what was written
+            return;
+        }
+        out->buf = grown;
+        out->cap = cap;
+    }
+    memcpy(out->buf + out->len, str, n);
+    out->len += n;
+}
+
+/* Pass everything staged to the flush callback, returns 0 once it failed */
+int buf_drain(JBUF_p out) {
+    if (out->len && !out->failed && !out->flush(out->ctx, out->buf, out->len))
+        out->failed = 1;
+    out->len = 0;
+    return !out->failed;
+}
+
+/* Map regular files read only. The parser needs a NUL after the text:
+ * the zero filled tail of the last page provides it, and when the size
+ * is a multiple of the page size the file is mapped over a zeroed
+ * anonymous reservation one page longer. Pipes and other unmappable
+ * inputs are read into a growing heap buffer. */
+int load_file(const char *filename, TFILE_t *file) {
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    memset(file, 0, sizeof(TFILE_t));
+
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0
+        || (uint64_t)st.st_size >= SIZE_MAX / 2) {
+        int ok = load_stream(fd, file);
+        close(fd);
+        return ok;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t len = (size_t)st.st_size;
+    size_t map_len = (len / page + 1) * page;
+    void *base = MAP_FAILED;
+    if (len % page) {
+        base = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+#ifdef MAP_ANONYMOUS
+    else {
+        base = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED
+            && mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            munmap(base, map_len);
+            base = MAP_FAILED;
+        }
+    }
+#endif
+    if (base == MAP_FAILED) {
+        int ok = load_stream(fd, file);
+        close(fd);
+        return ok;
+    }
+    close(fd);
+    madvise(base, len, MADV_SEQUENTIAL);
+    file->text = (char *)base;
+    file->len = len;
+    file->map_len = map_len;
+    return 1;
+}
+
+static int load_stream(int fd, TFILE_t *file) {
+    size_t cap = READ_BUF, len = 0;
+    char *text = (char *)emalloc(cap);
+    if (!text)
+        return 0;
+    for (;;) {
+        if (cap - len < READ_BUF / 2) {
+            char *grown = (char *)erealloc(text, cap << 1);
+            if (!grown) {
+                safe_free(text);
+                return 0;
+            }
+            text = grown;
+            cap <<= 1;
+        }
+        ssize_t n = read(fd, text + len, cap - len - 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            safe_free(text);
+            return 0;
+        }
+        if (!n) break;
+        len += (size_t)n;
+    }
+    text[len] = 0;
+    file->text = text;
+    file->len = len;
+    file->map_len = 0;
+    return 1;
+}
+
+void unload_file(TFILE_t *file) {
+    if (file->map_len)
+        munmap(file->text, file->map_len);
+    else
+        safe_free(file->text);
+    file->text = NULL;
+}
+
+static int write_file(void *ctx, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)ctx) == len;
+}
+
+static int write_fd(void *ctx, const char *data, size_t len) {
+    int fd = *(int *)ctx;
+    while (len) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n, len -= n;
+    }
+    return 1;
+}
@@ -0,0 +1,357 @@
+/*************************************************************************
+	> File Name: src/dtoa.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Locale independent number to text. Doubles use Grisu2,
+	               which always round trips and is the shortest form for
+	               all but a tiny fraction of inputs; integers use a two
+	               digits per step table.
+ ************************************************************************/
+
+#include "internal.h"
+
+/* 64-bit significand with a binary exponent, value = f * 2^e */
+typedef struct DiyFp {
+    uint64_t f;
+    int e;
+} DIYFP_t;
+
+#define DP_SIGNIFICAND 52
+#define DP_HIDDEN_BIT ((uint64_t)1 << DP_SIGNIFICAND)
+#define DP_SIGNIFICAND_MASK (DP_HIDDEN_BIT - 1)
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND)
+
+/* Normalized 10^k for k = -348, -340, ..., 340 */
+static const struct {
+    uint64_t f;
+    int e;
+} cached_powers[] = {
+    {0xfa8fd5a0081c0288, -1220}, // 1e-348
+    {0xbaaee17fa23ebf76, -1193}, // 1e-340
+    {0x8b16fb203055ac76, -1166}, // 1e-332
+    {0xcf42894a5dce35ea, -1140}, // 1e-324
+    {0x9a6bb0aa55653b2d, -1113}, // 1e-316
+    {0xe61acf033d1a45df, -1087}, // 1e-308
+    {0xab70fe17c79ac6ca, -1060}, // 1e-300
+    {0xff77b1fcbebcdc4f, -1034}, // 1e-292
+    {0xbe5691ef416bd60c, -1007}, // 1e-284
+    {0x8dd01fad907ffc3c, -980}, // 1e-276
+    {0xd3515c2831559a83, -954}, // 1e-268
+    {0x9d71ac8fada6c9b5, -927}, // 1e-260
+    {0xea9c227723ee8bcb, -901}, // 1e-252
+    {0xaecc49914078536d, -874}, // 1e-244
+    {0x823c12795db6ce57, -847}, // 1e-236
+    {0xc21094364dfb5637, -821}, // 1e-228
+    {0x9096ea6f3848984f, -794}, // 1e-220
+    {0xd77485cb25823ac7, -768}, // 1e-212
+    {0xa086cfcd97bf97f4, -741}, // 1e-204
+    {0xef340a98172aace5, -715}, // 1e-196
+    {0xb23867fb2a35b28e, -688}, // 1e-188
+    {0x84c8d4dfd2c63f3b, -661}, // 1e-180
+    {0xc5dd44271ad3cdba, -635}, // 1e-172
+    {0x936b9fcebb25c996, -608}, // 1e-164
+    {0xdbac6c247d62a584, -582}, // 1e-156
+    {0xa3ab66580d5fdaf6, -555}, // 1e-148
+    {0xf3e2f893dec3f126, -529}, // 1e-140
+    {0xb5b5ada8aaff80b8, -502}, // 1e-132
+    {0x87625f056c7c4a8b, -475}, // 1e-124
+    {0xc9bcff6034c13053, -449}, // 1e-116
+    {0x964e858c91ba2655, -422}, // 1e-108
+    {0xdff9772470297ebd, -396}, // 1e-100
+    {0xa6dfbd9fb8e5b88f, -369}, // 1e-92
+    {0xf8a95fcf88747d94, -343}, // 1e-84
+    {0xb94470938fa89bcf, -316}, // 1e-76
+    {0x8a08f0f8bf0f156b, -289}, // 1e-68
+    {0xcdb02555653131b6, -263}, // 1e-60
+    {0x993fe2c6d07b7fac, -236}, // 1e-52
+    {0xe45c10c42a2b3b06, -210}, // 1e-44
+    {0xaa242499697392d3, -183}, // 1e-36
+    {0xfd87b5f28300ca0e, -157}, // 1e-28
+    {0xbce5086492111aeb, -130}, // 1e-20
+    {0x8cbccc096f5088cc, -103}, // 1e-12
+    {0xd1b71758e219652c, -77}, // 1e-4
+    {0x9c40000000000000, -50}, // 1e4
+    {0xe8d4a51000000000, -24}, // 1e12
+    {0xad78ebc5ac620000, 3}, // 1e20
+    {0x813f3978f8940984, 30}, // 1e28
+    {0xc097ce7bc90715b3, 56}, // 1e36
+    {0x8f7e32ce7bea5c70, 83}, // 1e44
+    {0xd5d238a4abe98068, 109}, // 1e52
+    {0x9f4f2726179a2245, 136}, // 1e60
+    {0xed63a231d4c4fb27, 162}, // 1e68
+    {0xb0de65388cc8ada8, 189}, // 1e76
+    {0x83c7088e1aab65db, 216}, // 1e84
+    {0xc45d1df942711d9a, 242}, // 1e92
+    {0x924d692ca61be758, 269}, // 1e100
+    {0xda01ee641a708dea, 295}, // 1e108
+    {0xa26da3999aef774a, 322}, // 1e116
+    {0xf209787bb47d6b85, 348}, // 1e124
+    {0xb454e4a179dd1877, 375}, // 1e132
+    {0x865b86925b9bc5c2, 402}, // 1e140
+    {0xc83553c5c8965d3d, 428}, // 1e148
+    {0x952ab45cfa97a0b3, 455}, // 1e156
+    {0xde469fbd99a05fe3, 481}, // 1e164
+    {0xa59bc234db398c25, 508}, // 1e172
+    {0xf6c69a72a3989f5c, 534}, // 1e180
+    {0xb7dcbf5354e9bece, 561}, // 1e188
+    {0x88fcf317f22241e2, 588}, // 1e196
+    {0xcc20ce9bd35c78a5, 614}, // 1e204
+    {0x98165af37b2153df, 641}, // 1e212
+    {0xe2a0b5dc971f303a, 667}, // 1e220
+    {0xa8d9d1535ce3b396, 694}, // 1e228
+    {0xfb9b7cd9a4a7443c, 720}, // 1e236
+    {0xbb764c4ca7a44410, 747}, // 1e244
+    {0x8bab8eefb6409c1a, 774}, // 1e252
+    {0xd01fef10a657842c, 800}, // 1e260
+    {0x9b10a4e5e9913129, 827}, // 1e268
+    {0xe7109bfba19c0c9d, 853}, // 1e276
+    {0xac2820d9623bf429, 880}, // 1e284
+    {0x80444b5e7aa7cf85, 907}, // 1e292
+    {0xbf21e44003acdd2d, 933}, // 1e300
+    {0x8e679c2f5e44ff8f, 960}, // 1e308
+    {0xd433179d9c8cb841, 986}, // 1e316
+    {0x9e19db92b4e31ba9, 1013}, // 1e324
+    {0xeb96bf6ebadf77d9, 1039}, // 1e332
+    {0xaf87023b9bf0ee6b, 1066}, // 1e340
+};
+
+static const uint32_t pow10_32[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static const uint64_t pow10_64[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline DIYFP_t diy_make(uint64_t f, int e) {
+    DIYFP_t x = {f, e};
+    return x;
+}
+
+static inline DIYFP_t diy_normalize(DIYFP_t x) {
+    int shift = __builtin_clzll(x.f);
+    return diy_make(x.f << shift, x.e - shift);
+}
+
+/* Rounded high half of the 128-bit product */
+static inline DIYFP_t diy_mul(DIYFP_t x, DIYFP_t y) {
+    uint64_t a = x.f >> 32, b = x.f & 0xFFFFFFFF;
+    uint64_t c = y.f >> 32, d = y.f & 0xFFFFFFFF;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF);
+    tmp += (uint64_t)1 << 31;  // round
+    return diy_make(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64);
+}
+
+/* Boundaries m- and m+ halfway to the neighbouring doubles, same exponent */
+static void diy_boundaries(DIYFP_t v, DIYFP_t *minus, DIYFP_t *plus) {
+    DIYFP_t pl = diy_make((v.f << 1) + 1, v.e - 1);
+    while (!(pl.f & (DP_HIDDEN_BIT << 1)))
+        pl.f <<= 1, pl.e--;
+    pl.f <<= 64 - DP_SIGNIFICAND - 2;
+    pl.e -= 64 - DP_SIGNIFICAND - 2;
+
+    /* The gap below a power of two is half the gap above it */
+    DIYFP_t mi = v.f == DP_HIDDEN_BIT ? diy_make((v.f << 2) - 1, v.e - 2)
+                                      : diy_make((v.f << 1) - 1, v.e - 1);
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+/* Cached power bringing a number with binary exponent e into [-60, -32] */
+static DIYFP_t cached_power(int e, int *k) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (dk - ik > 0.0)
+        ik++;
+    unsigned index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    return diy_make(cached_powers[index].f, cached_powers[index].e);
+}
+
+static inline int count_digits(uint32_t n) {
+    int len = 1;
+    while (len < 10 && n >= pow10_32[len])
+        len++;
+    return len;
+}
+
+/* Step the last digit down while that moves closer to the true value */
+static void grisu_round(char *buf, int len, uint64_t delta, uint64_t rest,
+                        uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa
+           && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static void digit_gen(DIYFP_t w, DIYFP_t mp, uint64_t delta, char *buf, int *len, int *k) {
+    const DIYFP_t one = diy_make((uint64_t)1 << -mp.e, mp.e);
+    const uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = count_digits(p1);
+    *len = 0;
+
+    while (kappa > 0) {
+        uint32_t d = p1 / pow10_32[kappa - 1];
+        p1 %= pow10_32[kappa - 1];
+        if (d || *len)
+            buf[(*len)++] = (char)('0' + d);
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            grisu_round(buf, *len, delta, rest, (uint64_t)pow10_32[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || *len)
+            buf[(*len)++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            int index = -kappa;
+            grisu_round(buf, *len, delta, p2, one.f, wp_w * (index < 20 ? pow10_64[index] : 0));
+            return;
+        }
+    }
+}
+
+/* Digits of a positive finite double, value = buf * 10^k */
+static void grisu2(double value, char *buf, int *len, int *k) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased = (int)((bits >> DP_SIGNIFICAND) & 0x7FF);
+    uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+    DIYFP_t v = biased ? diy_make(significand + DP_HIDDEN_BIT, biased - DP_EXPONENT_BIAS)
+                       : diy_make(significand, 1 - DP_EXPONENT_BIAS);
+    DIYFP_t w_m, w_p;
+
+    diy_boundaries(v, &w_m, &w_p);
+    DIYFP_t c_mk = cached_power(w_p.e, k);
+    DIYFP_t w = diy_mul(diy_normalize(v), c_mk);
+    DIYFP_t wp = diy_mul(w_p, c_mk);
+    DIYFP_t wm = diy_mul(w_m, c_mk);
+    wm.f++;
+    wp.f--;
+    digit_gen(w, wp, wp.f - wm.f, buf, len, k);
+}
+
+static char *write_exponent(char *out, int k) {
+    if (k < 0) {
+        *out++ = '-';
+        k = -k;
+    }
+    if (k >= 100) {
+        *out++ = (char)('0' + k / 100);
+        k %= 100;
+        memcpy(out, digit_pairs + k * 2, 2);
+        return out + 2;
+    }
+    if (k >= 10) {
+        memcpy(out, digit_pairs + k * 2, 2);
+        return out + 2;
+    }
+    *out++ = (char)('0' + k);
+    return out;
+}
+
+/* Lay out len digits times 10^k as plain or exponent notation. Whole
+   numbers keep a ".0" so they read back as doubles. */
+static int prettify(char *out, int len, int k) {
+    const int kk = len + k;  // 10^(kk-1) <= value < 10^kk
+
+    if (k >= 0 && kk <= 21) {
+        memset(out + len, '0', k);
+        out[kk] = '.';
+        out[kk + 1] = '0';
+        return kk + 2;
+    }
+    if (kk > 0 && kk <= 21) {
+        memmove(out + kk + 1, out + kk, len - kk);
+        out[kk] = '.';
+        return len + 1;
+    }
+    if (kk > -6 && kk <= 0) {
+        const int offset = 2 - kk;
+        memmove(out + offset, out, len);
+        out[0] = '0';
+        out[1] = '.';
+        memset(out + 2, '0', offset - 2);
+        return len + offset;
+    }
+    if (len == 1) {
+        out[1] = 'e';
+        return (int)(write_exponent(out + 2, kk - 1) - out);
+    }
+    memmove(out + 2, out + 1, len - 1);
+    out[1] = '.';
+    out[len + 1] = 'e';
+    return (int)(write_exponent(out + len + 2, kk - 1) - out);
+}
+
+/* At most 25 bytes, not NUL terminated. Not finite numbers become null,
+   JSON cannot express them. */
+int fmt_double(char *out, double value) {
+    char *start = out;
+    int len = 0, k = 0;
+
+    if (value != value || value - value != 0) {
+        memcpy(out, "null", 4);
+        return 4;
+    }
+    if (signbit(value)) {
+        *out++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        memcpy(out, "0.0", 3);
+        return (int)(out - start) + 3;
+    }
+    grisu2(value, out, &len, &k);
+    return (int)(out - start) + prettify(out, len, k);
+}
+
+/* At most 20 bytes, not NUL terminated */
+int fmt_int64(char *out, int64_t value) {
+    char tmp[20], *p = tmp + sizeof(tmp);
+    uint64_t n = (uint64_t)value;
+    int neg = value < 0;
+
+    if (neg)
+        n = 0 - n;
+    while (n >= 100) {
+        p -= 2;
+        memcpy(p, digit_pairs + (n % 100) * 2, 2);
+        n /= 100;
+    }
+    if (n >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + n * 2, 2);
+    } else {
+        *--p = (char)('0' + n);
+    }
+    if (neg)
+        *--p = '-';
+    int len = (int)(tmp + sizeof(tmp) - p);
+    memcpy(out, p, len);
+    return len;
+}
@@ -0,0 +1,433 @@
+/*************************************************************************
+	> File Name: src/incremental.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Push parser. Text is fed in chunks split at arbitrary
+	               bytes; the grammar of parse_value runs as a state
+	               machine with an explicit container stack, so it can
+	               stop at the end of any chunk and resume on the next,
+	               inside a string, number, escape or literal included.
+ ************************************************************************/
+
+#include "internal.h"
+
+/* What the next byte is expected to be */
+enum {
+    P_VALUE,      // a value
+    P_FIRST,      // a value or ']', just after '['
+    P_KEY_FIRST,  // a key or '}', just after '{'
+    P_KEY,        // a key, after ','
+    P_COLON,
+    P_NEXT,       // ',' or the closing bracket of the container
+    P_DONE,       // whitespace after the document
+    P_STRING,     // inside a string, token holds the raw bytes so far
+    P_NUMBER,     // inside a number, token holds it so far
+    P_LITERAL,    // inside true, false or null
+    P_ERROR
+};
+
+struct JsonParser {
+    JARENA_p arena;
+    MARK_t mark;        // where the arena stood at the document's first byte
+    int marked;
+    int state;
+
+    JNODE_p root;
+    JNODE_p *stack;     // open containers, innermost last
+    size_t depth, stack_cap;
+    char *key;          // name of the member whose value comes next
+    char key_small[SMALL_MAX + 1];  // the key when short
+
+    char *token;        // a string or number split between chunks
+    size_t token_len, token_cap;
+    int is_key;         // the string being read is a key
+    int escape;         // the last raw byte was an unescaped backslash
+    const char *literal;
+    size_t matched;     // bytes of literal seen
+};
+
+static inline int is_space(char c) {
+    return (unsigned char)c <= 32;
+}
+
+static inline int is_number(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static int token_put(JPARSER_p p, const char *data, size_t n) {
+    if (p->token_len + n + 1 > p->token_cap) {
+        size_t cap = p->token_cap;
+        while (p->token_len + n + 1 > cap)
+            cap = cap ? cap * 2 : 256;
+        char *token = (char *)erealloc(p->token, cap);
+        if (!token)
+            return 0;
+        p->token = token;
+        p->token_cap = cap;
+    }
+    memcpy(p->token + p->token_len, data, n);
+    p->token_len += n;
+    p->token[p->token_len] = 0;
+    return 1;
+}
+
+static JNODE_p parser_node(JPARSER_p p) {
+    JNODE_p node = NULL;
+    if (p->arena)
+        return arena_node(p->arena);
+    node = (JNODE_p)emalloc(sizeof(JNODE_t));
+    if (node)
+        memset(node, 0, sizeof(JNODE_t));
+    return node;
+}
+
+static char *parser_string(JPARSER_p p, size_t size) {
+    if (p->arena)
+        return (char *)arena_alloc(p->arena, size, 1);
+    return (char *)emalloc(size);
+}
+
+/* Link a new value into the open container, or make it the root. 0 when
+   the value could not be made. */
+static int attach(JPARSER_p p, JNODE_p node) {
+    if (!node)
+        return 0;
+    if (!p->depth) {
+        p->root = node;
+        return 1;
+    }
+    JNODE_p parent = p->stack[p->depth - 1];
+    if ((parent->type & TYPE_MASK) == J_Object) {
+        if (p->key == p->key_small)
+            memcpy(small_name(node), p->key_small, sizeof(p->key_small));
+        else
+            node->name = p->key;
+        if (arena_pool(p->arena))
+            node->type |= CONST_BIT;  // the pool owns it
+        p->key = NULL;
+    }
+    return json_add_to_array(parent, node);
+}
+
+static void value_done(JPARSER_p p) {
+    p->state = p->depth ? P_NEXT : P_DONE;
+}
+
+static int open_container(JPARSER_p p, int type) {
+    if (p->depth == p->stack_cap) {
+        size_t cap = p->stack_cap ? p->stack_cap * 2 : 16;
+        JNODE_p *stack = (JNODE_p *)erealloc(p->stack, cap * sizeof(JNODE_p));
+        if (!stack)
+            return 0;
+        p->stack = stack;
+        p->stack_cap = cap;
+    }
+    JNODE_p node = parser_node(p);
+    if (!node)
+        return 0;
+    set_type(node, type);
+    if (!attach(p, node))
+        return 0;
+    p->stack[p->depth++] = node;
+    p->state = type == J_Object ? P_KEY_FIRST : P_FIRST;
+    return 1;
+}
+
+static int close_container(JPARSER_p p, int type) {
+    if (!p->depth || (p->stack[p->depth - 1]->type & TYPE_MASK) != type)
+        return 0;
+    p->depth--;
+    value_done(p);
+    return 1;
+}
+
+/* Forget the pending member name, freeing it when the heap owns it */
+static void drop_key(JPARSER_p p) {
+    if (p->key && !p->arena && p->key != p->key_small)
+        safe_free(p->key);
+    p->key = NULL;
+}
+
+/* A complete string from raw (NUL terminated or ending at the quote).
+   Escapes only shrink, short raw text fits in the node. */
+static int string_done(JPARSER_p p, const char *raw, size_t raw_len) {
+    char *out = NULL;
+    if (p->is_key) {
+        drop_key(p);
+        out = raw_len <= SMALL_MAX ? p->key_small : parser_string(p, raw_len + 1);
+        if (!out)
+            return 0;
+        string_unescape(out, raw, NULL);
+        if (arena_pool(p->arena)) {
+            p->key = (char *)arena_intern(p->arena, out, strlen(out));
+            if (out != p->key_small)
+                arena_unalloc(p->arena, out);  // the last allocation
+            if (!p->key)
+                return 0;
+        } else {
+            p->key = out;
+        }
+        p->state = P_COLON;
+        return 1;
+    }
+    JNODE_p node = parser_node(p);
+    if (!node)
+        return 0;
+    out = raw_len <= SMALL_MAX ? small_value(node) : parser_string(p, raw_len + 1);
+    if (!out) {
+        if (!p->arena)
+            json_delete(node);
+        return 0;
+    }
+    string_unescape(out, raw, NULL);
+    set_type(node, J_String);
+    node->value.string_val = out;
+    if (!attach(p, node))
+        return 0;
+    value_done(p);
+    return 1;
+}
+
+static int number_done(JPARSER_p p, const char *text, size_t len) {
+    int type = J_Int;
+    int64_t num = 0;
+    double real = 0;
+    const char *end = number_scan(text, &type, &num, &real);
+    if (!end || (size_t)(end - text) != len)
+        return 0;
+    JNODE_p node = parser_node(p);
+    if (!node)
+        return 0;
+    set_type(node, type);
+    if (type == J_Int)
+        node->value.int_val = (int)num;
+    else if (type == J_Int64)
+        node->value.int64_val = num;
+    else
+        node->value.double_val = real;
+    if (!attach(p, node))
+        return 0;
+    value_done(p);
+    return 1;
+}
+
+/* Start of a value at c */
+static int value_start(JPARSER_p p, char c) {
+    switch (c) {
+        case '{':
+            return open_container(p, J_Object);
+        case '[':
+            return open_container(p, J_Array);
+        case '\"':
+            p->state = P_STRING;
+            p->is_key = 0;
+            return 1;
+        case 't':
+            p->literal = "true";
+            break;
+        case 'f':
+            p->literal = "false";
+            break;
+        case 'n':
+            p->literal = "null";
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                p->state = P_NUMBER;
+                return 1;
+            }
+            return 0;
+    }
+    p->state = P_LITERAL;
+    p->matched = 1;  // c itself
+    return 1;
+}
+
+static int literal_done(JPARSER_p p) {
+    JNODE_p node = parser_node(p);
+    if (!node)
+        return 0;
+    if (p->literal[0] == 't') {
+        set_type(node, J_True);
+        node->value.int_val = 1;
+    } else {
+        set_type(node, p->literal[0] == 'f' ? J_False : J_NULL);
+    }
+    if (!attach(p, node))
+        return 0;
+    value_done(p);
+    return 1;
+}
+
+/* Consume the chunk, returns 0 at the first byte breaking the grammar */
+static int parser_run(JPARSER_p p, const char *s, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        char c = s[i];
+        switch (p->state) {
+            case P_STRING: {
+                size_t start = i;
+                int escape = p->escape;
+                for (; i < len; i++) {
+                    if (escape)
+                        escape = 0;
+                    else if (s[i] == '\\')
+                        escape = 1;
+                    else if (s[i] == '\"')
+                        break;
+                }
+                p->escape = escape;
+                if (i == len)
+                    return token_put(p, s + start, i - start);
+                if (p->token_len) {
+                    if (!token_put(p, s + start, i - start) || !string_done(p, p->token, p->token_len))
+                        return 0;
+                    p->token_len = 0;
+                } else if (!string_done(p, s + start, i - start)) {
+                    return 0;  // whole string in this chunk
+                }
+                i++;
+                continue;
+            }
+            case P_NUMBER: {
+                size_t start = i;
+                while (i < len && is_number(s[i]))
+                    i++;
+                if (i == len)
+                    return token_put(p, s + start, i - start);
+                if (p->token_len) {
+                    if (!token_put(p, s + start, i - start) || !number_done(p, p->token, p->token_len))
+                        return 0;
+                    p->token_len = 0;
+                } else if (!number_done(p, s + start, i - start)) {
+                    return 0;
+                }
+                continue;  // s[i] belongs to the next state
+            }
+            case P_LITERAL:
+                if (c != p->literal[p->matched])
+                    return 0;
+                i++;
+                if (!p->literal[++p->matched] && !literal_done(p))
+                    return 0;
+                continue;
+            default:
+                break;
+        }
+
+        if (is_space(c)) {
+            i++;
+            continue;
+        }
+        switch (p->state) {
+            case P_FIRST:
+                if (c == ']') {
+                    if (!close_container(p, J_Array))
+                        return 0;
+                    break;
+                }
+                /* fall through */
+            case P_VALUE:
+                if (!value_start(p, c))
+                    return 0;
+                if (p->state == P_NUMBER)
+                    continue;  // the sign or first digit is part of it
+                break;
+            case P_KEY_FIRST:
+                if (c == '}') {
+                    if (!close_container(p, J_Object))
+                        return 0;
+                    break;
+                }
+                /* fall through */
+            case P_KEY:
+                if (c != '\"')
+                    return 0;
+                p->state = P_STRING;
+                p->is_key = 1;
+                break;
+            case P_COLON:
+                if (c != ':')
+                    return 0;
+                p->state = P_VALUE;
+                break;
+            case P_NEXT:
+                if (c == ',')
+                    p->state = (p->stack[p->depth - 1]->type & TYPE_MASK) == J_Object ? P_KEY : P_VALUE;
+                else if (!close_container(p, c == ']' ? J_Array : c == '}' ? J_Object : -1))
+                    return 0;
+                break;
+            default:  // P_DONE, P_ERROR
+                return 0;
+        }
+        i++;
+    }
+    return 1;
+}
+
+/* Drop the document in progress and start over. In an arena everything
+   it took is given back, unless its root was handed out. */
+static void parser_reset(JPARSER_p p) {
+    if (p->root && !p->arena)
+        json_delete(p->root);
+    drop_key(p);
+    if (p->marked)
+        arena_rollback(p->arena, &p->mark);
+    p->marked = 0;
+    p->root = NULL;
+    p->depth = 0;
+    p->token_len = 0;
+    p->escape = 0;
+    p->state = P_VALUE;
+}
+
+JPARSER_p json_parser_create(JARENA_p arena) {
+    JPARSER_p p = (JPARSER_p)emalloc(sizeof(JPARSER_t));
+    if (!p)
+        return NULL;
+    memset(p, 0, sizeof(JPARSER_t));
+    p->arena = arena;
+    p->state = P_VALUE;
+    return p;
+}
+
+int json_parser_feed(JPARSER_p p, const char *chunk, size_t len) {
+    if (!p || p->state == P_ERROR)
+        return 0;
+    if (p->arena && !p->marked) {
+        arena_mark(p->arena, &p->mark);
+        p->marked = 1;
+    }
+    if (!parser_run(p, chunk, len)) {
+        p->state = P_ERROR;
+        return 0;
+    }
+    return 1;
+}
+
+JNODE_p json_parser_finish(JPARSER_p p) {
+    JNODE_p root = NULL;
+    if (!p)
+        return NULL;
+    if (p->state == P_NUMBER && !p->depth) {
+        /* A bare number only ends with the input */
+        if (!p->token_len || !number_done(p, p->token, p->token_len))
+            p->state = P_ERROR;
+        p->token_len = 0;
+    }
+    if (p->state == P_DONE) {
+        root = p->root;
+        p->root = NULL;
+        p->marked = 0;  // the document stays in the arena
+    }
+    parser_reset(p);
+    return root;
+}
+
+void json_parser_free(JPARSER_p p) {
+    if (!p) return;
+    parser_reset(p);
+    safe_free(p->stack);
+    safe_free(p->token);
+    safe_free(p);
+}
@@ -0,0 +1,244 @@
+/*************************************************************************
+	> File Name: src/index.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Lookup tables of large containers, built on demand.
+	               Objects get a hash of their member names, kept in step
+	               by every function that links or unlinks members; linear
+	               probing with backward shift deletion keeps duplicate
+	               names in insertion order. Arrays get a view, a vector
+	               of their elements, kept on append and dropped on any
+	               other change.
+ ************************************************************************/
+
+#include "internal.h"
+
+#define INDEX_MIN 16  // children a container needs before it gets a table
+
+typedef struct IndexSlot {
+    size_t hash;
+    JNODE_p node;  // NULL marks a free slot
+} SLOT_t;
+
+struct JsonIndex {
+    size_t cap;    // slots (a power of two) or view entries
+    size_t count;
+    int heap;      // 0 when carved from the container's arena
+    SLOT_t slot[]; // objects; arrays store JNODE_p entries here instead
+};
+
+#define view_of(index) ((JNODE_p *)(index)->slot)
+
+/* NULL when out of memory: tables only speed lookups up, every caller
+   falls back to walking the children */
+static JINDEX_p index_alloc(JNODE_p container, size_t size) {
+    JINDEX_p index = (container->type & ARENA_BIT)
+                         ? (JINDEX_p)arena_alloc(arena_of(container), size, sizeof(void *))
+                         : (JINDEX_p)emalloc(size);
+    if (!index)
+        return NULL;
+    memset(index, 0, sizeof(JINDEX_t));
+    index->heap = !(container->type & ARENA_BIT);
+    return index;
+}
+
+/* FNV-1a, folding ASCII case unless the object compares exactly */
+size_t key_hash(const char *key, int exact) {
+    uint64_t h = 14695981039346656037ULL;
+    if (exact) {
+        for (; *key; key++)
+            h = (h ^ (unsigned char)*key) * 1099511628211ULL;
+    } else {
+        for (; *key; key++)
+            h = (h ^ (unsigned char)ascii_lower(*key)) * 1099511628211ULL;
+    }
+    return (size_t)(h ^ (h >> 32));
+}
+
+static inline int key_equal(const char *a, const char *b, int exact) {
+    return a == b || (exact ? !strcmp(a, b) : !strcmp_ascii(a, b));
+}
+
+static void slot_put(JINDEX_p index, size_t hash, JNODE_p node) {
+    size_t mask = index->cap - 1, i = hash & mask;
+    while (index->slot[i].node)
+        i = (i + 1) & mask;
+    index->slot[i].hash = hash;
+    index->slot[i].node = node;
+    index->count++;
+}
+
+/* (Re)build the hash of obj with room for its members at half load */
+static JINDEX_p hash_build(JNODE_p obj) {
+    int exact = obj->type & CASE_BIT;
+    size_t slots = 32, size;
+    while (slots < (size_t)obj->size * 2)
+        slots <<= 1;
+    size = sizeof(JINDEX_t) + slots * sizeof(SLOT_t);
+
+    index_drop(obj);
+    JINDEX_p index = index_alloc(obj, size);
+    if (!index)
+        return NULL;
+    memset(index->slot, 0, slots * sizeof(SLOT_t));
+    index->cap = slots;
+    for (JNODE_p c = obj->child; c; c = c->next)
+        if (c->name)
+            slot_put(index, key_hash(c->name, exact), c);
+    obj->value.list.index = index;
+    return index;
+}
+
+/* Slot holding node, which must be hashed */
+static size_t slot_of(JINDEX_p index, JNODE_p node, int exact) {
+    size_t mask = index->cap - 1, i = key_hash(node->name, exact) & mask;
+    while (index->slot[i].node != node)
+        i = (i + 1) & mask;
+    return i;
+}
+
+/* Close the gap at i by pulling back entries that probed past it */
+static void slot_clear(JINDEX_p index, size_t i) {
+    size_t mask = index->cap - 1, j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!index->slot[j].node)
+            break;
+        size_t home = index->slot[j].hash & mask;
+        if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+            index->slot[i] = index->slot[j];
+            i = j;
+        }
+    }
+    index->slot[i].node = NULL;
+    index->count--;
+}
+
+static JINDEX_p view_build(JNODE_p array) {
+    size_t cap = array->size, i = 0;
+    JINDEX_p index = index_alloc(array, sizeof(JINDEX_t) + cap * sizeof(JNODE_p));
+    if (!index)
+        return NULL;
+    for (JNODE_p c = array->child; c && i < cap; c = c->next)
+        view_of(index)[i++] = c;
+    index->cap = cap;
+    index->count = i;
+    array->value.list.index = index;
+    return index;
+}
+
+static void view_push(JNODE_p array, JNODE_p node) {
+    JINDEX_p index = array->value.list.index;
+    if (index->count == index->cap) {
+        size_t cap = index->cap * 2, size = sizeof(JINDEX_t) + cap * sizeof(JNODE_p);
+        int heap = index->heap;
+        JINDEX_p grown = heap ? (JINDEX_p)erealloc(index, size) : index_alloc(array, size);
+        if (!grown) {
+            index_drop(array);  // built again on the next lookup
+            return;
+        }
+        if (!heap)  // the old one stays in the arena
+            memcpy(grown, index, sizeof(JINDEX_t) + index->count * sizeof(JNODE_p));
+        index = grown;
+        index->cap = cap;
+        array->value.list.index = index;
+    }
+    view_of(index)[index->count++] = node;
+}
+
+/* First member of obj named key, in insertion order */
+JNODE_p member_find(JNODE_p obj, const char *key) {
+    return member_lookup(obj, key, NULL, 0);
+}
+
+JNODE_p member_lookup(JNODE_p obj, const char *key, const size_t *hashes, int exact) {
+    int mode = obj->type & CASE_BIT;
+    JINDEX_p index = obj->value.list.index;
+    exact |= mode;
+    if (!index && obj->size >= INDEX_MIN)
+        index = hash_build(obj);
+    if (index) {
+        /* Hashed the object's way; an exact lookup just compares stricter */
+        size_t mask = index->cap - 1;
+        size_t hash = hashes ? hashes[mode ? 1 : 0] : key_hash(key, mode);
+        for (size_t i = hash & mask; index->slot[i].node; i = (i + 1) & mask)
+            if (index->slot[i].hash == hash && key_equal(index->slot[i].node->name, key, exact))
+                return index->slot[i].node;
+        return NULL;
+    }
+    for (JNODE_p c = obj->child; c; c = c->next)
+        if (c->name && key_equal(c->name, key, exact))
+            return c;
+    return NULL;
+}
+
+/* Child idx of a container. With view set, large arrays get one first;
+ * otherwise the walk starts from whichever end is closer. */
+JNODE_p child_at(JNODE_p container, size_t idx, int view) {
+    JINDEX_p index = container->value.list.index;
+    JNODE_p c = NULL;
+    if (idx >= container->size)
+        return NULL;
+    if ((container->type & TYPE_MASK) == J_Array) {
+        if (!index && view && container->size >= INDEX_MIN)
+            index = view_build(container);
+        if (index)
+            return view_of(index)[idx];
+    }
+    if (idx < container->size / 2) {
+        for (c = container->child; idx > 0; idx--)
+            c = c->next;
+    } else {
+        for (c = container->value.list.tail, idx = container->size - 1 - idx; idx > 0; idx--)
+            c = c->prev;
+    }
+    return c;
+}
+
+/* node was just appended to container */
+void index_insert(JNODE_p container, JNODE_p node) {
+    JINDEX_p index = container->value.list.index;
+    if ((container->type & TYPE_MASK) == J_Array) {
+        view_push(container, node);
+        return;
+    }
+    if (!node->name)
+        return;
+    if ((index->count + 1) * 2 > index->cap)
+        hash_build(container);  // node is already linked
+    else
+        slot_put(index, key_hash(node->name, container->type & CASE_BIT), node);
+}
+
+/* node is about to be unlinked from container */
+void index_remove(JNODE_p container, JNODE_p node) {
+    JINDEX_p index = container->value.list.index;
+    if ((container->type & TYPE_MASK) == J_Array)
+        index_drop(container);  // every later position moves
+    else if (node->name)
+        slot_clear(index, slot_of(index, node, container->type & CASE_BIT));
+}
+
+/* node took the place of old, child pos of container if known (else -1) */
+void index_replace(JNODE_p container, JNODE_p old, JNODE_p node, size_t pos) {
+    JINDEX_p index = container->value.list.index;
+    int exact = container->type & CASE_BIT;
+    if ((container->type & TYPE_MASK) == J_Array) {
+        if (pos < index->count)
+            view_of(index)[pos] = node;
+        else
+            index_drop(container);
+    } else if (old->name && node->name && key_equal(old->name, node->name, exact)) {
+        index->slot[slot_of(index, old, exact)].node = node;
+    } else {
+        /* The name changes, so does the position among duplicates */
+        index_drop(container);
+    }
+}
+
+void index_drop(JNODE_p container) {
+    JINDEX_p index = container->value.list.index;
+    if (index && index->heap)
+        safe_free(index);
+    container->value.list.index = NULL;
+}
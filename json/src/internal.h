@@ -0,0 +1,317 @@
+/*************************************************************************
+	> File Name: src/internal.h
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Helpers shared between the library translation units.
+	               Not part of the public interface.
+ ************************************************************************/
+
+#ifndef _SRC_INTERNAL_H
+#define _SRC_INTERNAL_H
+
+#include "cjson.h"
+
+#define CONST_BIT 256    // name is not owned by the node
+#define ARENA_BIT 512    // node (and its strings) live in a JARENA_t
+#define FOREIGN_BIT 1024 // arena container holding heap-allocated children
+#define BORROW_BIT 2048  // string value points into the caller's buffer
+#define CASE_BIT 4096    // object compares member names exactly
+#define SMALL_BIT 8192   // string value held in the node itself
+#define SMALL_NAME_BIT 16384 // name held in the node itself
+#define TYPE_MASK 255
+
+/* Change the value type, keeping the flag bits */
+#define set_type(node, t) ((node)->type = ((node)->type & ~TYPE_MASK) | (t))
+
+static inline void error_exit(int status, const char *error_msg) {
+    fputs(error_msg, stderr);
+    exit(status);
+}
+
+/* Allocation hooks (alloc.c): json_set_allocator sets mem_heap, arenas may
+   carry their own. NULL functions stand for malloc, realloc and free. */
+typedef struct JsonAllocator {
+    JALLOC_f alloc;
+    JREALLOC_f realloc;
+    JFREE_f free;
+    void *ctx;
+} JALLOCATOR_t;
+
+extern JALLOCATOR_t mem_heap;
+extern __thread JMEMSTATS_t mem_counts;
+
+void mem_stats_take(JMEMSTATS_t *stats);
+void mem_stats_add(const JMEMSTATS_t *stats);
+
+static inline void *mem_alloc(const JALLOCATOR_t *m, size_t size) {
+    void *ptr = m->alloc ? m->alloc(m->ctx, size) : malloc(size);
+    if (!ptr) {
+        mem_counts.failed++;
+        return NULL;
+    }
+    mem_counts.allocs++;
+    mem_counts.bytes += size;
+    return ptr;
+}
+
+/* NULL on failure, ptr is then still valid */
+static inline void *mem_realloc(const JALLOCATOR_t *m, void *ptr, size_t size) {
+    void *grown = m->realloc ? m->realloc(m->ctx, ptr, size) : realloc(ptr, size);
+    if (!grown) {
+        mem_counts.failed++;
+        return NULL;
+    }
+    mem_counts.allocs++;
+    mem_counts.bytes += size;
+    return grown;
+}
+
+static inline void mem_free(const JALLOCATOR_t *m, void *ptr) {
+    if (!ptr)
+        return;
+    mem_counts.frees++;
+    if (m->free)
+        m->free(m->ctx, ptr);
+    else
+        free(ptr);
+}
+
+/* The global hooks. Running out of memory is reported by the callers,
+   nothing here exits. */
+static inline void *emalloc(size_t size) {
+    return mem_alloc(&mem_heap, size);
+}
+
+static inline void *erealloc(void *ptr, size_t size) {
+    return mem_realloc(&mem_heap, ptr, size);
+}
+
+static inline void safe_free(void *ptr) {
+    mem_free(&mem_heap, ptr);
+}
+
+static inline int ascii_lower(int c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/* strcmp ignoring ASCII case, 0 when equal */
+static inline int strcmp_ascii(const char *s1, const char *s2) {
+    for (; ascii_lower(*s1) == ascii_lower(*s2); ++s1, ++s2)
+        if (*s1 == 0)
+            return 0;
+    return 1;
+}
+
+/* Storage inside the node for a string of up to SMALL_MAX bytes */
+#define SMALL_MAX 7
+
+static inline char *small_value(JNODE_p node) {
+    node->type |= SMALL_BIT;
+    return node->value.string_val = node->value.small.bytes;
+}
+
+static inline char *small_name(JNODE_p node) {
+    node->type |= SMALL_NAME_BIT;
+    return node->name = node->small_name;
+}
+
+static inline int is_container(JNODE_p node) {
+    int type = node->type & TYPE_MASK;
+    return type == J_Array || type == J_Object;
+}
+
+/* Output buffer used by every writer. It either grows, belongs to the
+   caller (fixed: never grown, len keeps counting what would have been
+   written) or is drained through flush whenever it fills up. */
+typedef struct JsonBuffer {
+    char *buf;
+    size_t len, cap;
+    int fixed;
+    JWRITE_f flush;
+    void *ctx;
+    int failed;
+    int styled;  // lay out as indent says, else the json_format look
+    int indent;  // JSON_MINIFY, JSON_TABS or spaces per level
+} JBUF_t, *JBUF_p;
+
+void buf_put_slow(JBUF_p out, const char *str, size_t n);
+int buf_drain(JBUF_p out);
+
+static inline void buf_put(JBUF_p out, const char *str, size_t n) {
+    if (out->len + n > out->cap) {
+        buf_put_slow(out, str, n);
+        return;
+    }
+    memcpy(out->buf + out->len, str, n);
+    out->len += n;
+}
+
+static inline void buf_putc(JBUF_p out, char c) {
+    if (out->len + 1 > out->cap) {
+        buf_put_slow(out, &c, 1);
+        return;
+    }
+    out->buf[out->len++] = c;
+}
+
+static inline void buf_tabs(JBUF_p out, int n) {
+    for (; n > 0; n--)
+        buf_putc(out, '\t');
+}
+
+/* New line indented to depth, nothing when minified */
+static inline void buf_break(JBUF_p out, size_t depth) {
+    static const char spaces[] = "                                ";
+    if (out->indent == JSON_MINIFY)
+        return;
+    buf_putc(out, '\n');
+    if (out->indent == JSON_TABS) {
+        buf_tabs(out, (int)depth);
+        return;
+    }
+    for (size_t n = depth * out->indent; n; ) {
+        size_t step = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+        buf_put(out, spaces, step);
+        n -= step;
+    }
+}
+
+/* Byte scanners picked by json_simd_select (simd.c). They return the
+   first byte ending a whitespace run, or ending plain string characters
+   ('"', '\\' or the terminating NUL). */
+extern const char *(*scan_space)(const char *);
+extern const char *(*scan_string)(const char *);
+
+/* Classes of the 64 bytes at p, bit i for p[i]; space is any byte up to
+   32, op one of {}[]:, */
+typedef struct BlockMasks {
+    uint64_t space, quote, backslash, op;
+} BMASK_t;
+extern void (*scan_block)(const char *p, BMASK_t *m);
+
+/* Tree of text through the structural index (stage.c). NULL when the
+   engine in use is not the index, the text is malformed or memory ran
+   out: the caller then parses it again by recursive descent, which
+   reports why. */
+JNODE_p stage_parse(const char *text, JARENA_p arena);
+
+/* The index itself, for parsers built on it. stage_value parses the value
+   at token at and moves past it, 0 if malformed; the array at token hole
+   is left empty as hole_node and tokens up to hole_end (its ']') are
+   skipped. */
+#define STAGE_MAX ((size_t)UINT32_MAX - 64)
+#define NO_HOLE ((size_t)-1)
+typedef struct Stage {
+    const char *text;
+    uint32_t *pos;   // offsets of the tokens, then the end of the text
+    size_t count, cap;
+    size_t at;       // next token
+    JARENA_p arena;
+    size_t hole, hole_end;
+    JNODE_p hole_node;
+} STAGE_t;
+int stage_index(STAGE_t *st, size_t len);
+JNODE_p stage_node(STAGE_t *st);
+int stage_value(STAGE_t *st, JNODE_p node);
+
+/* Input text of a file, NUL terminated, mapped when possible (cjson.c) */
+typedef struct TextFile {
+    char *text;
+    size_t len;
+    size_t map_len;  // 0 when text is a heap copy
+} TFILE_t;
+
+int load_file(const char *filename, TFILE_t *file);
+void unload_file(TFILE_t *file);
+
+/* String body to text (cjson.c), see parse_string */
+const char *string_unescape(char *out, const char *ptr, size_t *len);
+
+/* Number text to value (number.c). Returns the end of the number, or NULL
+   when it is malformed (or too long to copy once memory ran out); *type
+   is J_Int, J_Int64 or J_Double. */
+const char *number_scan(const char *value, int *type, int64_t *ival, double *dval);
+
+/* Number to text (dtoa.c), at most 25 and 20 bytes, no terminator */
+int fmt_double(char *out, double value);
+int fmt_int64(char *out, int64_t value);
+
+/* Lookup tables of large containers (index.c): a name hash for objects,
+   a view for arrays. The update functions require value.list.index set. */
+typedef struct JsonIndex JINDEX_t, *JINDEX_p;
+size_t key_hash(const char *key, int exact);
+JNODE_p member_find(JNODE_p obj, const char *key);
+/* exact: compare names exactly even in an object that ignores case.
+   hashes: NULL, or key_hash(key, 0) and key_hash(key, 1) precomputed. */
+JNODE_p member_lookup(JNODE_p obj, const char *key, const size_t *hashes, int exact);
+JNODE_p child_at(JNODE_p container, size_t idx, int view);
+void index_insert(JNODE_p container, JNODE_p node);
+void index_remove(JNODE_p container, JNODE_p node);
+void index_replace(JNODE_p container, JNODE_p old, JNODE_p node, size_t pos);
+void index_drop(JNODE_p container);
+
+/* Compiled JSON Pointer (path.c), one allocation: the tokens, then
+   their keys */
+#define NO_INDEX ((size_t)-1)
+typedef struct PathToken {
+    const char *key;  // unescaped, NUL terminated
+    size_t hash[2];   // key_hash(key, 0) and key_hash(key, 1)
+    size_t idx;       // array index, NO_INDEX when the token is not one
+} TOKEN_t;
+struct JsonPath {
+    size_t count;
+    TOKEN_t token[];
+};
+
+/* Worker threads to start for a request of threads, 0 for one per core
+   (ndjson.c) */
+int thread_count(int threads);
+
+/* Arena internals (arena.c) */
+JNODE_p arena_node(JARENA_p arena);
+char *arena_strdup(JARENA_p arena, const char *str, size_t len);
+void *arena_alloc(JARENA_p arena, size_t size, size_t align);
+void arena_unalloc(JARENA_p arena, void *ptr);
+JPOOL_p arena_pool(JARENA_p arena);  // NULL when names are not interned
+const char *arena_intern(JARENA_p arena, const char *name, size_t len);
+JARENA_p arena_of(JNODE_p node);
+int arena_adopt(JNODE_p container);
+void arena_merge(JARENA_p arena, JARENA_p from);
+JARENA_p arena_create_like(JARENA_p arena, size_t text_len);
+
+/* Where an arena stood, to drop everything allocated since: the tree of a
+   parse that failed half way. Nothing kept may point into that memory. */
+typedef struct ArenaMark {
+    void *chunks, *foreign;
+    char *node_cur, *node_end, *next_slab, *byte_cur, *byte_end;
+    size_t slabs_left, group, block, nodes, used, reserved;
+} MARK_t;
+void arena_mark(JARENA_p arena, MARK_t *mark);
+void arena_rollback(JARENA_p arena, const MARK_t *mark);
+
+/* Move a just parsed key from the string value to the name: interned when
+   the arena has a pool, giving back the arena copy (the last allocation),
+   otherwise kept where it is, in the node when short. 0 when the pool
+   is out of memory. */
+static inline int take_key(JNODE_p node, JARENA_p arena) {
+    char *key = node->value.string_val;
+    int small = node->type & SMALL_BIT;
+    node->type &= ~SMALL_BIT;
+    if (arena_pool(arena)) {
+        node->name = (char *)arena_intern(arena, key, strlen(key));
+        node->type |= CONST_BIT;
+        if (!small)
+            arena_unalloc(arena, key);
+    } else if (small) {
+        memcpy(small_name(node), key, sizeof(node->small_name));
+    } else {
+        node->name = key;
+    }
+    memset(&node->value, 0, sizeof(node->value));  // the value parsed next sees a clean node
+    return node->name != NULL;
+}
+
+/* Interned copy of the len bytes at name (pool.c) */
+const char *pool_intern(JPOOL_p pool, const char *name, size_t len);
+
+#endif
@@ -0,0 +1,364 @@
+/*************************************************************************
+	> File Name: src/msgpack.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Trees to and from MessagePack. Every value is a type
+	               byte, big endian payload after it; arrays and maps carry
+	               their element count up front, strings their length, so
+	               the reader never scans for an end.
+ ************************************************************************/
+
+#include <limits.h>
+
+#include "internal.h"
+
+#define PACK_BUF 4096
+
+/* Writer */
+static void put_be(JBUF_p out, int tag, uint64_t v, int bytes) {
+    char b[9];
+    b[0] = (char)tag;
+    for (int i = bytes; i > 0; i--, v >>= 8)
+        b[i] = (char)(v & 0xFF);
+    buf_put(out, b, bytes + 1);
+}
+
+/* Head of a string, array or map: fix form, then 8 (strings only), 16
+   or 32 bit lengths */
+static void put_head(JBUF_p out, int fix, size_t fix_max, int tag8, int tag16, size_t n) {
+    if (n <= fix_max)
+        buf_putc(out, (char)(fix | n));
+    else if (tag8 && n <= 0xFF)
+        put_be(out, tag8, n, 1);
+    else if (n <= 0xFFFF)
+        put_be(out, tag16, n, 2);
+    else
+        put_be(out, tag16 + 1, n, 4);
+}
+
+static void put_string(JBUF_p out, const char *str) {
+    size_t n = str ? strlen(str) : 0;
+    put_head(out, 0xA0, 31, 0xD9, 0xDA, n);
+    buf_put(out, str, n);
+}
+
+static void put_int(JBUF_p out, int64_t v) {
+    if (v >= 0) {
+        if (v < 128)
+            buf_putc(out, (char)v);
+        else if (v <= 0xFF)
+            put_be(out, 0xCC, v, 1);
+        else if (v <= 0xFFFF)
+            put_be(out, 0xCD, v, 2);
+        else if (v <= 0xFFFFFFFFLL)
+            put_be(out, 0xCE, v, 4);
+        else
+            put_be(out, 0xCF, v, 8);
+    } else if (v >= -32) {
+        buf_putc(out, (char)(0xE0 | (v & 0x1F)));
+    } else if (v >= INT8_MIN) {
+        put_be(out, 0xD0, (uint64_t)v, 1);
+    } else if (v >= INT16_MIN) {
+        put_be(out, 0xD1, (uint64_t)v, 2);
+    } else if (v >= INT32_MIN) {
+        put_be(out, 0xD2, (uint64_t)v, 4);
+    } else {
+        put_be(out, 0xD3, (uint64_t)v, 8);
+    }
+}
+
+static void pack_value(JBUF_p out, JNODE_p node) {
+    uint64_t bits = 0;
+    switch (node->type & TYPE_MASK) {
+        case J_True:
+            buf_putc(out, (char)0xC3);
+            break;
+        case J_False:
+            buf_putc(out, (char)0xC2);
+            break;
+        case J_Int:
+            put_int(out, node->value.int_val);
+            break;
+        case J_Int64:
+            put_int(out, node->value.int64_val);
+            break;
+        case J_Double:
+            memcpy(&bits, &node->value.double_val, sizeof(bits));
+            put_be(out, 0xCB, bits, 8);
+            break;
+        case J_String:
+            put_string(out, node->value.string_val);
+            break;
+        case J_Array:
+            put_head(out, 0x90, 15, 0, 0xDC, node->size);
+            for (JNODE_p c = node->child; c; c = c->next)
+                pack_value(out, c);
+            break;
+        case J_Object:
+            put_head(out, 0x80, 15, 0, 0xDE, node->size);
+            for (JNODE_p c = node->child; c; c = c->next) {
+                put_string(out, c->name);
+                pack_value(out, c);
+            }
+            break;
+        default:
+            buf_putc(out, (char)0xC0);
+            break;
+    }
+}
+
+/* Same staging as json_write, memory use does not depend on the document */
+int json_msgpack_write(JNODE_p root, JWRITE_f write, void *ctx) {
+    char stage[PACK_BUF];
+    JBUF_t out = {stage, 0, sizeof(stage), 0, write, ctx, 0};
+    if (!root)
+        return 0;
+    pack_value(&out, root);
+    return buf_drain(&out);
+}
+
+static int pack_file(void *ctx, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)ctx) == len;
+}
+
+int json_msgpack_file(JNODE_p root, FILE *fp) {
+    return json_msgpack_write(root, pack_file, fp);
+}
+
+char *json_msgpack(JNODE_p root, size_t *len) {
+    JBUF_t out = {NULL, 0, 0, 0, NULL, NULL, 0};
+    if (!root)
+        return NULL;
+    pack_value(&out, root);
+    if (out.failed) {
+        safe_free(out.buf);
+        return NULL;
+    }
+    if (len) *len = out.len;
+    return out.buf;
+}
+
+/* Reader */
+typedef struct Unpack {
+    const unsigned char *data, *at, *end;
+    JARENA_p arena;
+    int code;  // first error, JSON_OK while there is none
+} UNPACK_t, *UNPACK_p;
+
+static int unpack_fail(UNPACK_p u, int code) {
+    if (!u->code)
+        u->code = code;
+    return 0;
+}
+
+static int get_be(UNPACK_p u, int bytes, uint64_t *v) {
+    if ((size_t)(u->end - u->at) < (size_t)bytes)
+        return unpack_fail(u, JSON_ERR_END);
+    *v = 0;
+    for (int i = 0; i < bytes; i++)
+        *v = *v << 8 | *u->at++;
+    return 1;
+}
+
+static JNODE_p unpack_node(UNPACK_p u) {
+    JNODE_p node = NULL;
+    if (u->arena) {
+        node = arena_node(u->arena);
+    } else {
+        node = (JNODE_p)emalloc(sizeof(JNODE_t));
+        if (node) memset(node, 0, sizeof(JNODE_t));
+    }
+    if (!node)
+        unpack_fail(u, JSON_ERR_NOMEM);
+    return node;
+}
+
+/* n bytes of string as a NUL terminated copy, in the node when short */
+static char *unpack_text(UNPACK_p u, JNODE_p node, size_t n, int name) {
+    char *out = NULL;
+    if ((size_t)(u->end - u->at) < n) {
+        unpack_fail(u, JSON_ERR_END);
+        return NULL;
+    }
+    if (name && arena_pool(u->arena)) {
+        node->type |= CONST_BIT;
+        out = (char *)arena_intern(u->arena, (const char *)u->at, n);
+    } else {
+        if (n <= SMALL_MAX)
+            out = name ? small_name(node) : small_value(node);
+        else if (u->arena)
+            out = (char *)arena_alloc(u->arena, n + 1, 1);
+        else
+            out = (char *)emalloc(n + 1);
+        if (out) {
+            memcpy(out, u->at, n);
+            out[n] = 0;
+        }
+    }
+    if (!out) {
+        unpack_fail(u, JSON_ERR_NOMEM);
+        return NULL;
+    }
+    u->at += n;
+    return out;
+}
+
+/* Length of the string whose head byte is tag, -1 if it is not one */
+static int string_head(UNPACK_p u, int tag, size_t *n) {
+    uint64_t v = 0;
+    if ((tag & 0xE0) == 0xA0) {
+        *n = tag & 0x1F;
+        return 1;
+    }
+    switch (tag) {
+        case 0xD9: case 0xC4: if (!get_be(u, 1, &v)) return 0; break;  // str and bin alike
+        case 0xDA: case 0xC5: if (!get_be(u, 2, &v)) return 0; break;
+        case 0xDB: case 0xC6: if (!get_be(u, 4, &v)) return 0; break;
+        default: return -1;
+    }
+    *n = (size_t)v;
+    return 1;
+}
+
+static int unpack_value(UNPACK_p u, JNODE_p node);
+
+/* Each element takes a byte at least: a count beyond what is left is
+   rejected before anything is allocated for it */
+static int unpack_list(UNPACK_p u, JNODE_p node, int type, size_t count) {
+    JNODE_p child = NULL;
+    set_type(node, type);
+    if (count > (size_t)(u->end - u->at) / (type == J_Object ? 2 : 1))
+        return unpack_fail(u, JSON_ERR_END);
+    for (size_t i = 0; i < count; i++) {
+        JNODE_p item = unpack_node(u);
+        if (!item)
+            return 0;
+        if (child) {
+            child->next = item;
+            item->prev = child;
+        } else {
+            node->child = item;
+        }
+        node->value.list.tail = child = item;
+        node->size++;
+        if (type == J_Object) {
+            size_t n = 0;
+            int tag = u->at < u->end ? *u->at++ : -1;
+            int head = tag < 0 ? unpack_fail(u, JSON_ERR_END) : string_head(u, tag, &n);
+            if (head < 0)
+                return unpack_fail(u, JSON_ERR_KEY);
+            if (!head || !(child->name = unpack_text(u, child, n, 1)))
+                return 0;
+        }
+        if (!unpack_value(u, child))
+            return 0;
+    }
+    return 1;
+}
+
+static int unpack_value(UNPACK_p u, JNODE_p node) {
+    uint64_t v = 0;
+    size_t n = 0;
+    double real = 0;
+    float single = 0;
+    if (u->at >= u->end)
+        return unpack_fail(u, JSON_ERR_END);
+    int tag = *u->at++;
+
+    if (tag < 0x80 || tag >= 0xE0) {  // fixints
+        set_type(node, J_Int);
+        node->value.int_val = tag < 0x80 ? tag : tag - 0x100;
+        return 1;
+    }
+    if ((tag & 0xF0) == 0x80)
+        return unpack_list(u, node, J_Object, tag & 0x0F);
+    if ((tag & 0xF0) == 0x90)
+        return unpack_list(u, node, J_Array, tag & 0x0F);
+    switch (string_head(u, tag, &n)) {
+        case 0: return 0;
+        case 1:
+            set_type(node, J_String);
+            return (node->value.string_val = unpack_text(u, node, n, 0)) != NULL;
+        default: break;
+    }
+
+    switch (tag) {
+        case 0xC0:
+            set_type(node, J_NULL);
+            return 1;
+        case 0xC2:
+            set_type(node, J_False);
+            return 1;
+        case 0xC3:
+            set_type(node, J_True);
+            node->value.int_val = 1;
+            return 1;
+        case 0xCA:
+            if (!get_be(u, 4, &v)) return 0;
+            {
+                uint32_t bits = (uint32_t)v;
+                memcpy(&single, &bits, sizeof(single));
+            }
+            set_type(node, J_Double);
+            node->value.double_val = single;
+            return 1;
+        case 0xCB:
+            if (!get_be(u, 8, &v)) return 0;
+            memcpy(&real, &v, sizeof(real));
+            set_type(node, J_Double);
+            node->value.double_val = real;
+            return 1;
+        case 0xCC: case 0xCD: case 0xCE: case 0xCF:  // unsigned
+            if (!get_be(u, 1 << (tag - 0xCC), &v)) return 0;
+            if (v > INT64_MAX) {
+                set_type(node, J_Double);
+                node->value.double_val = (double)v;
+            } else if (v > INT_MAX) {
+                set_type(node, J_Int64);
+                node->value.int64_val = (int64_t)v;
+            } else {
+                set_type(node, J_Int);
+                node->value.int_val = (int)v;
+            }
+            return 1;
+        case 0xD0: case 0xD1: case 0xD2: case 0xD3: {  // signed
+            int bytes = 1 << (tag - 0xD0);
+            if (!get_be(u, bytes, &v)) return 0;
+            int64_t s = bytes == 8 ? (int64_t)v : (int64_t)(v ^ (1ULL << (bytes * 8 - 1))) - (1LL << (bytes * 8 - 1));
+            if (s < INT_MIN || s > INT_MAX) {
+                set_type(node, J_Int64);
+                node->value.int64_val = s;
+            } else {
+                set_type(node, J_Int);
+                node->value.int_val = (int)s;
+            }
+            return 1;
+        }
+        case 0xDC: case 0xDD:
+            if (!get_be(u, tag == 0xDC ? 2 : 4, &v)) return 0;
+            return unpack_list(u, node, J_Array, (size_t)v);
+        case 0xDE: case 0xDF:
+            if (!get_be(u, tag == 0xDE ? 2 : 4, &v)) return 0;
+            return unpack_list(u, node, J_Object, (size_t)v);
+        default:  // extension types and the unused byte
+            return unpack_fail(u, JSON_ERR_VALUE);
+    }
+}
+
+JNODE_p json_msgpack_parse(const void *data, size_t len, JARENA_p arena, JERROR_t *err) {
+    UNPACK_t u = {(const unsigned char *)data, (const unsigned char *)data,
+                  (const unsigned char *)data + len, arena, JSON_OK};
+    JNODE_p root = unpack_node(&u);
+    if (root && unpack_value(&u, root) && u.at != u.end)
+        unpack_fail(&u, JSON_ERR_VALUE);  // more than one value
+    if (err) {
+        memset(err, 0, sizeof(JERROR_t));
+        err->code = u.code;
+        if (u.code)
+            err->offset = u.at - u.data;
+    }
+    if (!u.code)
+        return root;
+    json_delete(root);
+    return NULL;
+}
@@ -0,0 +1,311 @@
+/*************************************************************************
+	> File Name: src/ndjson.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Newline delimited JSON on a pool of threads. The input is
+	               cut into blocks at line ends; each worker copies a block
+	               into an arena of its own and parses the lines in situ,
+	               so workers never share an allocator. Results come back
+	               in input order.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define BLOCK_MIN ((size_t)64 << 10)
+#define BLOCK_MAX ((size_t)4 << 20)
+#define BLOCKS_PER_THREAD 8  // keeps threads busy when lines vary in cost
+#define WINDOW_PER_THREAD 4  // blocks in flight per thread when streaming
+
+/* A run of whole lines, parsed by one worker */
+typedef struct NdBlock {
+    const char *text;
+    size_t len;
+    JARENA_p arena;
+    JNODE_p *roots;   // in the arena, NULL for malformed lines
+    size_t count;
+    int done;
+    int failed;       // out of memory, no records kept
+} NDBLOCK_t;
+
+typedef struct NdJob {
+    NDBLOCK_t *blocks;
+    size_t nblocks;
+    size_t next;      // next block to claim
+    size_t limit;     // blocks at or past this wait for the caller
+    int stop;
+    int failed;       // a block ran out of memory
+    JMEMSTATS_t stats;  // allocations the workers made
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} NDJOB_t;
+
+struct JsonBatch {
+    NDBLOCK_t *blocks;
+    size_t nblocks;
+    JNODE_p *roots;   // every record in input order
+    size_t count;
+};
+
+int thread_count(int threads) {
+    if (threads > 0)
+        return threads;
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/* Cut text at line ends into blocks of about len / (threads * BLOCKS_PER_THREAD),
+   NULL when out of memory */
+static NDBLOCK_t *split_blocks(const char *text, size_t len, int threads, size_t *nblocks) {
+    size_t size = len / ((size_t)threads * BLOCKS_PER_THREAD), cap = 16, n = 0;
+    NDBLOCK_t *blocks = (NDBLOCK_t *)emalloc(cap * sizeof(NDBLOCK_t));
+    if (!blocks)
+        return NULL;
+    size = size < BLOCK_MIN ? BLOCK_MIN : size > BLOCK_MAX ? BLOCK_MAX : size;
+
+    for (size_t start = 0; start < len;) {
+        size_t end = start + size;
+        if (end >= len) {
+            end = len;
+        } else {
+            const char *nl = (const char *)memchr(text + end, '\n', len - end);
+            end = nl ? (size_t)(nl - text) + 1 : len;
+        }
+        if (n == cap) {
+            NDBLOCK_t *grown = (NDBLOCK_t *)erealloc(blocks, cap * 2 * sizeof(NDBLOCK_t));
+            if (!grown) {
+                safe_free(blocks);
+                return NULL;
+            }
+            blocks = grown;
+            cap *= 2;
+        }
+        memset(&blocks[n], 0, sizeof(NDBLOCK_t));
+        blocks[n].text = text + start;
+        blocks[n++].len = end - start;
+        start = end;
+    }
+    *nblocks = n;
+    return blocks;
+}
+
+static int blank_line(const char *line) {
+    while (*line && (unsigned char)*line <= 32)
+        line++;
+    return !*line;
+}
+
+/* Out of memory the block is marked failed rather than passing the lines
+   it could not parse off as malformed */
+static void parse_block(NDBLOCK_t *block) {
+    size_t lines = 1;
+    JERROR_t err;
+    for (const char *p = block->text; (p = (const char *)memchr(p, '\n', block->text + block->len - p)); p++)
+        lines++;
+
+    block->arena = json_arena_create(block->len);
+    if (!block->arena) {
+        block->failed = 1;
+        return;
+    }
+    block->roots = (JNODE_p *)arena_alloc(block->arena, lines * sizeof(JNODE_p), sizeof(void *));
+    /* A private NUL terminated copy lets the lines be parsed in situ */
+    char *copy = (char *)arena_alloc(block->arena, block->len + 1, 1);
+    if (!block->roots || !copy) {
+        block->failed = 1;
+        return;
+    }
+    memcpy(copy, block->text, block->len);
+    copy[block->len] = 0;
+
+    for (char *line = copy, *next = NULL; line; line = next) {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = 0;
+        if (blank_line(line))
+            continue;
+        block->roots[block->count++] = json_parse_insitu_r(line, block->arena, &err);
+        if (err.code == JSON_ERR_NOMEM) {
+            block->failed = 1;
+            block->count = 0;
+            return;
+        }
+    }
+}
+
+/* Counts of what a worker allocated go to the job as it leaves, and from
+   there to the caller's thread */
+static void *nd_worker(void *arg) {
+    NDJOB_t *job = (NDJOB_t *)arg;
+    JMEMSTATS_t stats;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        while (!job->stop && job->next < job->nblocks && job->next >= job->limit)
+            pthread_cond_wait(&job->cond, &job->lock);
+        if (job->stop || job->next >= job->nblocks) {
+            mem_stats_take(&stats);
+            job->stats.allocs += stats.allocs;
+            job->stats.frees += stats.frees;
+            job->stats.bytes += stats.bytes;
+            job->stats.failed += stats.failed;
+            pthread_mutex_unlock(&job->lock);
+            return NULL;
+        }
+        NDBLOCK_t *block = &job->blocks[job->next++];
+        pthread_mutex_unlock(&job->lock);
+
+        parse_block(block);
+
+        pthread_mutex_lock(&job->lock);
+        block->done = 1;
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+/* Parse the blocks of job on threads workers. With each set, blocks are
+ * handed to it in order as they complete, and at most a window of them
+ * exists at a time; it returns 0 to stop. Returns 0 when stopped or a
+ * block ran out of memory, job->failed telling which. */
+static int nd_run(NDJOB_t *job, int threads, JRECORD_f each, void *ctx) {
+    pthread_t *pool = (pthread_t *)emalloc(threads * sizeof(pthread_t));
+    int started = 0, go = 1;
+    size_t ordinal = 0;
+
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->cond, NULL);
+    job->limit = each ? (size_t)threads * WINDOW_PER_THREAD : job->nblocks;
+    for (int i = 0; pool && i < threads && (size_t)i < job->nblocks; i++)
+        if (!pthread_create(&pool[started], NULL, nd_worker, job))
+            started++;
+    if (!started)  // no threads to be had, do it here
+        job->limit = job->nblocks;
+
+    for (size_t i = 0; each && i < job->nblocks; i++) {
+        NDBLOCK_t *block = &job->blocks[i];
+        if (started) {
+            pthread_mutex_lock(&job->lock);
+            while (!block->done)
+                pthread_cond_wait(&job->cond, &job->lock);
+            pthread_mutex_unlock(&job->lock);
+        } else {
+            parse_block(block);
+        }
+        if (block->failed)
+            go = 0, job->failed = 1;
+        for (size_t r = 0; go && r < block->count; r++)
+            go = each(ctx, ordinal++, block->roots[r]);
+        json_arena_destroy(block->arena);
+        block->arena = NULL;
+
+        pthread_mutex_lock(&job->lock);
+        job->limit++;
+        job->stop = !go;
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+        if (!go)
+            break;
+    }
+    if (!each && !started)
+        for (size_t i = 0; i < job->nblocks; i++)
+            parse_block(&job->blocks[i]);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(pool[i], NULL);
+    mem_stats_add(&job->stats);
+    for (size_t i = 0; !each && i < job->nblocks; i++)
+        if (job->blocks[i].failed)
+            go = 0, job->failed = 1;
+    if (each) {
+        /* Blocks parsed past the one that stopped the callback */
+        for (size_t i = 0; i < job->nblocks; i++)
+            json_arena_destroy(job->blocks[i].arena);
+    }
+    pthread_cond_destroy(&job->cond);
+    pthread_mutex_destroy(&job->lock);
+    safe_free(pool);
+    return go;
+}
+
+JBATCH_p json_ndjson_parse(const char *text, size_t len, int threads) {
+    NDJOB_t job;
+    JBATCH_p batch = (JBATCH_p)emalloc(sizeof(JBATCH_t));
+    if (!batch)
+        return NULL;
+    memset(&job, 0, sizeof(job));
+    memset(batch, 0, sizeof(JBATCH_t));
+    threads = thread_count(threads);
+    job.blocks = split_blocks(text, len, threads, &job.nblocks);
+    batch->blocks = job.blocks;
+    batch->nblocks = job.nblocks;
+    if (!job.blocks || !nd_run(&job, threads, NULL, NULL)) {
+        json_batch_free(batch);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < job.nblocks; i++)
+        batch->count += job.blocks[i].count;
+    batch->roots = (JNODE_p *)emalloc((batch->count + 1) * sizeof(JNODE_p));
+    if (!batch->roots) {
+        json_batch_free(batch);
+        return NULL;
+    }
+    for (size_t i = 0, at = 0; i < job.nblocks; i++) {
+        memcpy(batch->roots + at, job.blocks[i].roots, job.blocks[i].count * sizeof(JNODE_p));
+        at += job.blocks[i].count;
+    }
+    return batch;
+}
+
+JBATCH_p json_ndjson_parse_file(const char *filename, int threads) {
+    TFILE_t file;
+    if (!load_file(filename, &file))
+        return NULL;
+    JBATCH_p batch = json_ndjson_parse(file.text, file.len, threads);
+    unload_file(&file);  // the blocks were copied into their arenas
+    return batch;
+}
+
+int json_ndjson_each(const char *text, size_t len, int threads, JRECORD_f each, void *ctx) {
+    NDJOB_t job;
+    memset(&job, 0, sizeof(job));
+    threads = thread_count(threads);
+    job.blocks = split_blocks(text, len, threads, &job.nblocks);
+    if (!job.blocks)
+        return 0;
+    int go = nd_run(&job, threads, each, ctx);
+    safe_free(job.blocks);
+    return job.failed ? 0 : go ? 1 : -1;
+}
+
+int json_ndjson_each_file(const char *filename, int threads, JRECORD_f each, void *ctx) {
+    TFILE_t file;
+    if (!load_file(filename, &file))
+        return 0;
+    int ret = json_ndjson_each(file.text, file.len, threads, each, ctx);
+    unload_file(&file);
+    return ret;
+}
+
+size_t json_batch_size(JBATCH_p batch) {
+    return batch ? batch->count : 0;
+}
+
+JNODE_p json_batch_get(JBATCH_p batch, size_t idx) {
+    if (!batch || idx >= batch->count)
+        return NULL;
+    return batch->roots[idx];
+}
+
+void json_batch_free(JBATCH_p batch) {
+    if (!batch) return;
+    for (size_t i = 0; i < batch->nblocks; i++)
+        json_arena_destroy(batch->blocks[i].arena);
+    safe_free(batch->blocks);
+    safe_free(batch->roots);
+    safe_free(batch);
+}
@@ -0,0 +1,213 @@
+/*************************************************************************
+	> File Name: src/number.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Number text to value. Integers are accumulated exactly,
+	               floats take Clinger's fast path, then the Eisel-Lemire
+	               algorithm, and fall back to strtod when neither can
+	               round correctly.
+ ************************************************************************/
+
+#include <limits.h>
+#include <locale.h>
+
+#include "internal.h"
+#include "pow10.h"
+
+#define MAX_DIGITS 19  // significant digits that always fit in uint64_t
+
+static const double exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/* High and low words of a * b */
+static inline uint64_t mul_128(uint64_t a, uint64_t b, uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 u128;
+    u128 r = (u128)a * b;
+    *lo = (uint64_t)r;
+    return (uint64_t)(r >> 64);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi;
+    uint64_t p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+    uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+    *lo = (mid << 32) | (uint32_t)p0;
+    return p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+}
+
+static inline int leading_zeros(uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & ((uint64_t)1 << 63)))
+        x <<= 1, n++;
+    return n;
+#endif
+}
+
+/* Correctly rounded w * 10^q, or 0 in *ok when the 128-bit product is not
+ * precise enough to decide the rounding. w != 0, q in the table range. */
+static double eisel_lemire(uint64_t w, int q, int negative, int *ok) {
+    const uint64_t *factor = pow10_128[q - POW10_MIN];
+    int64_t exponent = ((((int64_t)152170 + 65536) * q) >> 16) + 1024 + 63;
+    int lz = leading_zeros(w);
+    uint64_t lower, upper;
+
+    *ok = 0;
+    w <<= lz;
+    upper = mul_128(w, factor[0], &lower);
+    if ((upper & 0x1FF) == 0x1FF && lower + w < lower) {
+        /* The truncated factor may matter, bring in its next 64 bits */
+        uint64_t low, middle;
+        uint64_t middle2 = mul_128(w, factor[1], &low);
+        middle = lower + middle2;
+        if (middle < lower)
+            upper++;
+        if (middle + 1 == 0 && (upper & 0x1FF) == 0x1FF && low + w < low)
+            return 0;
+        lower = middle;
+    }
+
+    uint64_t upperbit = upper >> 63;
+    uint64_t mantissa = upper >> (upperbit + 9);
+    lz += (int)(1 ^ upperbit);
+    /* Exactly halfway between two doubles, let strtod break the tie */
+    if (lower == 0 && (upper & 0x1FF) == 0 && (mantissa & 3) == 1)
+        return 0;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)1 << 53)) {
+        mantissa = (uint64_t)1 << 52;
+        lz--;
+    }
+    mantissa &= ~((uint64_t)1 << 52);
+    int64_t real_exponent = exponent - lz;
+    if (real_exponent < 1 || real_exponent > 2046)  // subnormal or infinite
+        return 0;
+
+    uint64_t bits = mantissa | ((uint64_t)real_exponent << 52) | ((uint64_t)negative << 63);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    *ok = 1;
+    return d;
+}
+
+/* strtod on a copy, with '.' turned into the locale's decimal point.
+   NULL when a long number cannot be copied. */
+static const char *slow_path(const char *start, const char *end, double *dval) {
+    char local[64];
+    size_t len = end - start;
+    char *copy = len < sizeof(local) ? local : (char *)emalloc(len + 1);
+    char point = *localeconv()->decimal_point;
+
+    if (!copy)
+        return NULL;
+    for (size_t i = 0; i < len; i++)
+        copy[i] = start[i] == '.' ? point : start[i];
+    copy[len] = 0;
+    *dval = strtod(copy, NULL);
+    if (copy != local)
+        safe_free(copy);
+    return end;
+}
+
+const char *number_scan(const char *value, int *type, int64_t *ival, double *dval) {
+    const char *start = value;
+    uint64_t w = 0;
+    int negative = 0, digits = 0, truncated = 0, is_float = 0;
+    int64_t q = 0;
+
+    if (*value == '-')
+        negative = 1, value++;
+    if (!is_digit(*value))
+        return NULL;
+
+    if (*value == '0') {
+        value++;
+    } else {
+        do {
+            if (digits < MAX_DIGITS) {
+                w = w * 10 + (*value - '0');
+                digits++;
+            } else {
+                truncated |= *value != '0';
+                q++;
+            }
+        } while (is_digit(*++value));
+    }
+
+    if (*value == '.' && is_digit(value[1])) {  // value[1] look ahead.
+        is_float = 1;
+        value++;
+        do {
+            if (!w && *value == '0') {
+                q--;  // leading zeros are not significant
+            } else if (digits < MAX_DIGITS) {
+                w = w * 10 + (*value - '0');
+                digits++;
+                q--;
+            } else {
+                truncated |= *value != '0';
+            }
+        } while (is_digit(*++value));
+    }
+
+    if ((*value == 'e' || *value == 'E')
+        && (is_digit(value[1]) || ((value[1] == '+' || value[1] == '-') && is_digit(value[2])))) {
+        int exp_negative = 0;
+        int64_t exp = 0;
+        is_float = 1;
+        value++;
+        if (*value == '-' || *value == '+')
+            exp_negative = *value++ == '-';
+        do {
+            if (exp < 100000)  // far beyond any double, keeps exp from overflowing
+                exp = exp * 10 + (*value - '0');
+        } while (is_digit(*++value));
+        q += exp_negative ? -exp : exp;
+    }
+
+    if (!is_float && !truncated && q == 0 && (w || !negative)) {
+        /* Integer fast path: the smallest node type that holds it exactly.
+           -0 has no integer form, it stays a double to keep its sign. */
+        if (negative ? w <= (uint64_t)INT64_MAX + 1 : w <= (uint64_t)INT64_MAX) {
+            int64_t n = negative ? (int64_t)(0 - w) : (int64_t)w;
+            *ival = n;
+            *type = (n >= INT_MIN && n <= INT_MAX) ? J_Int : J_Int64;
+            return value;
+        }
+    }
+
+    *type = J_Double;
+    if (!w) {
+        *dval = negative ? -0.0 : 0.0;
+        return value;
+    }
+    if (!truncated) {
+        /* Clinger: both operands exact, so one rounding gives the result */
+        if (q >= -22 && q <= 22 && w <= ((uint64_t)1 << 53)) {
+            double d = (double)w;
+            d = q < 0 ? d / exact_pow10[-q] : d * exact_pow10[q];
+            *dval = negative ? -d : d;
+            return value;
+        }
+        if (q >= POW10_MIN && q <= POW10_MAX) {
+            int ok = 0;
+            double d = eisel_lemire(w, (int)q, negative, &ok);
+            if (ok) {
+                *dval = d;
+                return value;
+            }
+        }
+    }
+    return slow_path(start, value, dval);
+}
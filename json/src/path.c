@@ -0,0 +1,91 @@
+/*************************************************************************
+	> File Name: src/path.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: RFC 6901 JSON Pointers. A pointer is compiled once into
+	               unescaped tokens with their hashes and array indexes
+	               worked out, then evaluated by following only the
+	               addressed members.
+ ************************************************************************/
+
+#include "internal.h"
+
+/* "0" or digits without a leading zero, as RFC 6901 requires */
+static size_t token_index(const char *key) {
+    size_t idx = 0;
+    if (!*key || (key[0] == '0' && key[1]))
+        return NO_INDEX;
+    for (; *key; key++) {
+        if (*key < '0' || *key > '9' || idx > (NO_INDEX - 9) / 10)
+            return NO_INDEX;
+        idx = idx * 10 + (*key - '0');
+    }
+    return idx;
+}
+
+JPATH_p json_path_compile(const char *pointer) {
+    size_t count = 0, len = 0;
+    if (!pointer || (*pointer && *pointer != '/'))
+        return NULL;
+    for (const char *p = pointer; *p; p++, len++) {
+        if (*p == '/')
+            count++;
+        else if (*p == '~' && p[1] != '0' && p[1] != '1')
+            return NULL;  // only ~0 and ~1 are escapes
+    }
+
+    JPATH_p path = (JPATH_p)emalloc(sizeof(JPATH_t) + count * sizeof(TOKEN_t) + len + 1);
+    if (!path)
+        return NULL;
+    char *out = (char *)(path->token + count);
+    const char *p = pointer;
+    path->count = count;
+    for (size_t i = 0; i < count; i++) {
+        TOKEN_t *token = &path->token[i];
+        token->key = out;
+        for (p++; *p && *p != '/'; p++) {
+            if (*p == '~')
+                *out++ = *++p == '0' ? '~' : '/';
+            else
+                *out++ = *p;
+        }
+        *out++ = 0;
+        token->hash[0] = key_hash(token->key, 0);
+        token->hash[1] = key_hash(token->key, 1);
+        token->idx = token_index(token->key);
+    }
+    return path;
+}
+
+/* Names compare exactly; tokens index arrays, and "-" (one past the end)
+ * never resolves. Large containers on the way get their lookup tables. */
+JNODE_p json_path_get(JNODE_p root, JPATH_p path) {
+    JNODE_p node = root;
+    if (!path)
+        return NULL;
+    for (size_t i = 0; node && i < path->count; i++) {
+        const TOKEN_t *token = &path->token[i];
+        switch (node->type & TYPE_MASK) {
+            case J_Object:
+                node = member_lookup(node, token->key, token->hash, 1);
+                break;
+            case J_Array:
+                node = token->idx == NO_INDEX ? NULL : child_at(node, token->idx, 1);
+                break;
+            default:
+                return NULL;
+        }
+    }
+    return node;
+}
+
+void json_path_free(JPATH_p path) {
+    safe_free(path);
+}
+
+JNODE_p json_pointer(JNODE_p root, const char *pointer) {
+    JPATH_p path = json_path_compile(pointer);
+    JNODE_p node = json_path_get(root, path);
+    json_path_free(path);
+    return node;
+}
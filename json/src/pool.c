@@ -0,0 +1,136 @@
+/*************************************************************************
+	> File Name: src/pool.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Intern pool for member names. Each distinct name is
+	               stored once, in blocks owned by the pool, and handed out
+	               as the same pointer every time; a hash of the names with
+	               linear probing finds them. A lock makes one pool usable
+	               from every parser thread at once.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "internal.h"
+
+#define POOL_BLOCK ((size_t)64 << 10)
+
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+    size_t used, size;
+    char data[];
+} PBLOCK_t;
+
+typedef struct PoolSlot {
+    size_t hash;
+    const char *name;  // NULL marks a free slot
+} PSLOT_t;
+
+struct JsonPool {
+    pthread_mutex_t lock;
+    PSLOT_t *slot;
+    size_t cap, count;  // cap is a power of two, kept at most half full
+    PBLOCK_t *blocks;
+    size_t bytes;
+};
+
+static char *pool_store(JPOOL_p pool, const char *name, size_t len) {
+    PBLOCK_t *block = pool->blocks;
+    if (!block || block->used + len + 1 > block->size) {
+        size_t size = len + 1 > POOL_BLOCK ? len + 1 : POOL_BLOCK;
+        block = (PBLOCK_t *)emalloc(sizeof(PBLOCK_t) + size);
+        if (!block)
+            return NULL;
+        block->used = 0;
+        block->size = size;
+        block->next = pool->blocks;
+        pool->blocks = block;
+    }
+    char *copy = block->data + block->used;
+    memcpy(copy, name, len);
+    copy[len] = 0;
+    block->used += len + 1;
+    pool->bytes += len + 1;
+    return copy;
+}
+
+static int pool_grow(JPOOL_p pool) {
+    size_t cap = pool->cap ? pool->cap * 2 : 256, mask = cap - 1;
+    PSLOT_t *slot = (PSLOT_t *)emalloc(cap * sizeof(PSLOT_t));
+    if (!slot)
+        return 0;
+    memset(slot, 0, cap * sizeof(PSLOT_t));
+    for (size_t i = 0; i < pool->cap; i++) {
+        if (!pool->slot[i].name)
+            continue;
+        size_t j = pool->slot[i].hash & mask;
+        while (slot[j].name)
+            j = (j + 1) & mask;
+        slot[j] = pool->slot[i];
+    }
+    safe_free(pool->slot);
+    pool->slot = slot;
+    pool->cap = cap;
+    return 1;
+}
+
+const char *pool_intern(JPOOL_p pool, const char *name, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)name[i]) * 1099511628211ULL;
+    size_t hash = (size_t)(h ^ (h >> 32));
+
+    pthread_mutex_lock(&pool->lock);
+    if ((pool->count + 1) * 2 > pool->cap && !pool_grow(pool)) {
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+    size_t mask = pool->cap - 1, i = hash & mask;
+    for (; pool->slot[i].name; i = (i + 1) & mask) {
+        const char *hit = pool->slot[i].name;
+        if (pool->slot[i].hash == hash && !strncmp(hit, name, len) && !hit[len]) {
+            pthread_mutex_unlock(&pool->lock);
+            return hit;
+        }
+    }
+    const char *copy = pool_store(pool, name, len);
+    if (copy) {
+        pool->slot[i].hash = hash;
+        pool->slot[i].name = copy;
+        pool->count++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return copy;
+}
+
+JPOOL_p json_pool_create(void) {
+    JPOOL_p pool = (JPOOL_p)emalloc(sizeof(JPOOL_t));
+    if (!pool)
+        return NULL;
+    memset(pool, 0, sizeof(JPOOL_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+const char *json_pool_intern(JPOOL_p pool, const char *name) {
+    return pool_intern(pool, name, strlen(name));
+}
+
+void json_pool_stats(JPOOL_p pool, size_t *names, size_t *bytes) {
+    if (names) *names = pool->count;
+    if (bytes) *bytes = pool->bytes;
+}
+
+void json_pool_free(JPOOL_p pool) {
+    if (!pool) return;
+    PBLOCK_t *block = pool->blocks, *next = NULL;
+    for (; block; block = next) {
+        next = block->next;
+        safe_free(block);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    safe_free(pool->slot);
+    safe_free(pool);
+}
@@ -0,0 +1,454 @@
+/*************************************************************************
+	> File Name: src/sax.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Event parser. Same grammar as parse_value, but values are
+	               reported to callbacks instead of linked into a tree, and
+	               the input is read through a window that only has to
+	               hold the current token. Selected subtrees can still be
+	               built as trees.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define SAX_BUF 65536
+
+typedef struct SaxReader SREADER_t, *SREADER_p;
+
+struct SaxReader {
+    char *buf;               // window on the input, NUL after the loaded bytes
+    size_t pos, len, cap;    // cursor, loaded bytes, room (without the NUL)
+    int eof;
+    size_t (*read)(SREADER_p r, char *dst, size_t max);
+    const char *text;
+    FILE *fp;
+    int fd;
+
+    const JSAX_t *sax;
+    void *ctx;
+    int failed, stopped;
+
+    char *key;               // name of the member being parsed
+    size_t key_cap;
+    int member;              // the next value is a member of an object
+
+    JNODE_p *stack;          // subtree being built, stack[0] is its root
+    size_t depth, stack_cap;
+    int tree_next;           // build the next value
+};
+
+static int sax_fail(SREADER_p r);
+
+/* Sources */
+static size_t read_text(SREADER_p r, char *dst, size_t max) {
+    const char *end = (const char *)memchr(r->text, 0, max);
+    size_t n = end ? (size_t)(end - r->text) : max;
+    memcpy(dst, r->text, n);
+    r->text += n;
+    return n;
+}
+
+static size_t read_file(SREADER_p r, char *dst, size_t max) {
+    size_t n = fread(dst, 1, max, r->fp);
+    if (!n && ferror(r->fp))
+        r->failed = 1;
+    return n;
+}
+
+static size_t read_fd(SREADER_p r, char *dst, size_t max) {
+    for (;;) {
+        ssize_t n = read(r->fd, dst, max);
+        if (n >= 0)
+            return (size_t)n;
+        if (errno != EINTR) {
+            r->failed = 1;
+            return 0;
+        }
+    }
+}
+
+/* Make n bytes past the cursor readable, fewer only at the end of input */
+static int sax_need(SREADER_p r, size_t n) {
+    if (r->len - r->pos >= n)
+        return 1;
+    memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+    r->len -= r->pos;
+    r->pos = 0;
+    while (r->len < n && !r->eof) {
+        if (r->cap - r->len < SAX_BUF / 2) {
+            char *buf = (char *)erealloc(r->buf, r->cap * 2 + 1);  // a token larger than the window
+            if (!buf)
+                return sax_fail(r);
+            r->buf = buf;
+            r->cap *= 2;
+        }
+        size_t got = r->read(r, r->buf + r->len, r->cap - r->len);
+        r->eof = !got;
+        r->len += got;
+    }
+    r->buf[r->len] = 0;
+    return r->len - r->pos >= n;
+}
+
+/* First byte after whitespace, 0 at the end of input */
+static char sax_peek(SREADER_p r) {
+    for (;;) {
+        const char *p = scan_space(r->buf + r->pos);
+        r->pos = p - r->buf;
+        if (r->pos < r->len)
+            return *p;
+        if (!sax_need(r, 1))
+            return 0;
+    }
+}
+
+static int sax_fail(SREADER_p r) {
+    r->failed = 1;
+    return 0;
+}
+
+/* The string at the cursor, unescaped in the window */
+static char *sax_string(SREADER_p r, size_t *len) {
+    size_t off = 1;  // from the cursor, the window may move
+    for (;;) {
+        const char *p = scan_string(r->buf + r->pos + off);
+        off = p - (r->buf + r->pos);
+        if (r->pos + off == r->len) {
+            if (!sax_need(r, off + 1))
+                return NULL;  // unterminated
+        } else if (*p == '\\') {
+            if (!sax_need(r, off + 2))
+                return NULL;
+            off += 2;
+        } else if (*p == '\"') {
+            break;
+        } else {
+            return NULL;  // NUL byte inside the text
+        }
+    }
+    char *out = r->buf + r->pos + 1;
+    string_unescape(out, out, len);
+    r->pos += off + 1;
+    return out;
+}
+
+/* Subtree building */
+static JNODE_p scalar_node(const JNODE_t *value) {
+    switch (value->type & TYPE_MASK) {
+        case J_True: return create_true();
+        case J_False: return create_false();
+        case J_Int: return create_int(value->value.int_val);
+        case J_Int64: return create_int64(value->value.int64_val);
+        case J_Double: return create_double(value->value.double_val);
+        case J_String: return create_string(value->value.string_val);
+        default: return create_null();
+    }
+}
+
+static int build_done(SREADER_p r, JNODE_p root) {
+    int go = r->sax->tree(r->ctx, root);
+    if (!go)
+        r->stopped = 1;
+    return go;
+}
+
+/* Link node into the subtree, or start one with it. On failure node is
+   deleted and the parse fails. */
+static int build_add(SREADER_p r, JNODE_p node) {
+    int ok = 1;
+    if (!node)
+        return sax_fail(r);
+    if (r->depth) {
+        JNODE_p parent = r->stack[r->depth - 1];
+        if ((parent->type & TYPE_MASK) == J_Object)
+            ok = json_add_to_object(parent, r->key, node, 1);
+        else
+            ok = json_add_to_array(parent, node);
+    } else if (r->member) {
+        size_t size = strlen(r->key) + 1;
+        node->name = size <= SMALL_MAX + 1 ? small_name(node) : (char *)emalloc(size);
+        if ((ok = node->name != NULL))
+            memcpy(node->name, r->key, size);
+    }
+    if (ok)
+        return 1;
+    json_delete(node);
+    return sax_fail(r);
+}
+
+/* Room on the stack for one more container, made before the node is */
+static int build_room(SREADER_p r) {
+    if (r->depth == r->stack_cap) {
+        size_t cap = r->stack_cap ? r->stack_cap * 2 : 16;
+        JNODE_p *stack = (JNODE_p *)erealloc(r->stack, cap * sizeof(JNODE_p));
+        if (!stack)
+            return sax_fail(r);
+        r->stack = stack;
+        r->stack_cap = cap;
+    }
+    return 1;
+}
+
+/* Events, either passed to the handler or turned into nodes */
+static int ev_start(SREADER_p r, int type) {
+    if (!r->depth && !r->tree_next) {
+        int (*cb)(void *) = type == J_Object ? r->sax->start_object : r->sax->start_array;
+        int go = cb ? cb(r->ctx) : SAX_GO;
+        if (go == SAX_STOP) {
+            r->stopped = 1;
+            return 0;
+        }
+        if (go != SAX_TREE || !r->sax->tree)
+            return 1;
+    }
+    r->tree_next = 0;
+    if (!build_room(r))
+        return 0;
+    JNODE_p node = type == J_Object ? create_object() : create_array();
+    if (!build_add(r, node))
+        return 0;
+    r->stack[r->depth++] = node;
+    return 1;
+}
+
+static int ev_end(SREADER_p r, int type) {
+    if (r->depth) {
+        if (--r->depth)
+            return 1;
+        return build_done(r, r->stack[0]);
+    }
+    int (*cb)(void *) = type == J_Object ? r->sax->end_object : r->sax->end_array;
+    if (cb && cb(r->ctx) == SAX_STOP) {
+        r->stopped = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static int ev_key(SREADER_p r, const char *name, size_t len) {
+    if (len + 1 > r->key_cap) {
+        size_t cap = len + 1 > 64 ? len + 1 : 64;
+        char *key = (char *)erealloc(r->key, cap);
+        if (!key)
+            return sax_fail(r);
+        r->key = key;
+        r->key_cap = cap;
+    }
+    memcpy(r->key, name, len + 1);
+    if (r->depth || !r->sax->key)
+        return 1;
+    int go = r->sax->key(r->ctx, name, len);
+    if (go == SAX_STOP) {
+        r->stopped = 1;
+        return 0;
+    }
+    r->tree_next = go == SAX_TREE && r->sax->tree;
+    return 1;
+}
+
+static int ev_scalar(SREADER_p r, const JNODE_t *value) {
+    if (r->depth || r->tree_next) {
+        JNODE_p node = scalar_node(value);
+        if (!build_add(r, node))
+            return 0;
+        if (r->depth)
+            return 1;
+        r->tree_next = 0;
+        return build_done(r, node);
+    }
+    if (r->sax->scalar && r->sax->scalar(r->ctx, value) == SAX_STOP) {
+        r->stopped = 1;
+        return 0;
+    }
+    return 1;
+}
+
+/* Grammar */
+static int sax_value(SREADER_p r);
+
+/* Scalar values live on the stack, named after their member */
+static void scalar_init(SREADER_p r, JNODE_p value, int type) {
+    memset(value, 0, sizeof(JNODE_t));
+    value->type = type;
+    value->name = r->member ? r->key : NULL;
+}
+
+static int sax_number(SREADER_p r) {
+    JNODE_t value;
+    int64_t ival = 0;
+    size_t off = 0;
+    for (;;) {
+        const char *p = r->buf + r->pos + off;
+        while ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.'
+               || *p == 'e' || *p == 'E')
+            p++;
+        off = p - (r->buf + r->pos);
+        if (r->pos + off < r->len || !sax_need(r, off + 1))
+            break;
+    }
+
+    scalar_init(r, &value, J_Int);
+    const char *end = number_scan(r->buf + r->pos, &value.type, &ival, &value.value.double_val);
+    if (!end)
+        return sax_fail(r);
+    if (value.type == J_Int)
+        value.value.int_val = (int)ival;
+    else if (value.type == J_Int64)
+        value.value.int64_val = ival;
+    r->pos = end - r->buf;
+    return ev_scalar(r, &value);
+}
+
+static int sax_literal(SREADER_p r) {
+    JNODE_t value;
+    const char *p = NULL;
+    sax_need(r, 5);
+    p = r->buf + r->pos;
+    if (!strncmp(p, "null", 4)) {
+        scalar_init(r, &value, J_NULL);
+        r->pos += 4;
+    } else if (!strncmp(p, "false", 5)) {
+        scalar_init(r, &value, J_False);
+        r->pos += 5;
+    } else if (!strncmp(p, "true", 4)) {
+        scalar_init(r, &value, J_True);
+        value.value.int_val = 1;
+        r->pos += 4;
+    } else {
+        return sax_fail(r);
+    }
+    return ev_scalar(r, &value);
+}
+
+static int sax_array(SREADER_p r) {
+    r->pos++;
+    if (!ev_start(r, J_Array))
+        return 0;
+    char c = sax_peek(r);
+    if (c == ']') {
+        r->pos++;
+        return ev_end(r, J_Array);
+    }
+    for (;;) {
+        r->member = 0;
+        if (!sax_value(r))
+            return 0;
+        c = sax_peek(r);
+        if (c == ']') {
+            r->pos++;
+            return ev_end(r, J_Array);
+        }
+        if (c != ',')
+            return sax_fail(r);
+        r->pos++;
+    }
+}
+
+static int sax_object(SREADER_p r) {
+    r->pos++;
+    if (!ev_start(r, J_Object))
+        return 0;
+    char c = sax_peek(r);
+    if (c == '}') {
+        r->pos++;
+        return ev_end(r, J_Object);
+    }
+    for (;;) {
+        size_t len = 0;
+        char *name = NULL;
+        if (c != '\"' || !(name = sax_string(r, &len)))
+            return sax_fail(r);
+        if (!ev_key(r, name, len))
+            return 0;
+        if (sax_peek(r) != ':')
+            return sax_fail(r);
+        r->pos++;
+        r->member = 1;
+        if (!sax_value(r))
+            return 0;
+        c = sax_peek(r);
+        if (c == '}') {
+            r->pos++;
+            return ev_end(r, J_Object);
+        }
+        if (c != ',')
+            return sax_fail(r);
+        r->pos++;
+        c = sax_peek(r);
+    }
+}
+
+static int sax_value(SREADER_p r) {
+    char c = sax_peek(r);
+    if (c == '{')
+        return sax_object(r);
+    if (c == '[')
+        return sax_array(r);
+    if (c == '\"') {
+        JNODE_t value;
+        scalar_init(r, &value, J_String);
+        if (!(value.value.string_val = sax_string(r, NULL)))
+            return sax_fail(r);
+        return ev_scalar(r, &value);
+    }
+    if (c == '-' || (c >= '0' && c <= '9'))
+        return sax_number(r);
+    if (c == 'n' || c == 't' || c == 'f')
+        return sax_literal(r);
+    return sax_fail(r);
+}
+
+/* Every value of the input, in order */
+static int sax_run(SREADER_p r, const JSAX_t *sax, void *ctx) {
+    r->sax = sax;
+    r->ctx = ctx;
+    r->cap = SAX_BUF;
+    r->buf = (char *)emalloc(r->cap + 1);
+    if (!r->buf)
+        return 0;
+    r->buf[0] = 0;
+    while (!r->failed && !r->stopped) {
+        if (!sax_peek(r)) {
+            if (r->pos < r->len)
+                r->failed = 1;  // NUL byte between values
+            break;
+        }
+        r->member = 0;
+        sax_value(r);
+    }
+    if (r->depth)
+        json_delete(r->stack[0]);
+    safe_free(r->stack);
+    safe_free(r->key);
+    safe_free(r->buf);
+    return r->failed ? 0 : r->stopped ? -1 : 1;
+}
+
+int json_sax_parse(const char *text, const JSAX_t *sax, void *ctx) {
+    SREADER_t r;
+    memset(&r, 0, sizeof(r));
+    r.read = read_text;
+    r.text = text;
+    return sax_run(&r, sax, ctx);
+}
+
+int json_sax_parse_file(FILE *fp, const JSAX_t *sax, void *ctx) {
+    SREADER_t r;
+    memset(&r, 0, sizeof(r));
+    r.read = read_file;
+    r.fp = fp;
+    return sax_run(&r, sax, ctx);
+}
+
+int json_sax_parse_fd(int fd, const JSAX_t *sax, void *ctx) {
+    SREADER_t r;
+    memset(&r, 0, sizeof(r));
+    r.read = read_fd;
+    r.fd = fd;
+    return sax_run(&r, sax, ctx);
+}
@@ -0,0 +1,237 @@
+/*************************************************************************
+	> File Name: src/simd.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Byte scanners used by the parser, and the classifier of
+	               64 byte blocks behind the structural index. SSE2 and
+	               AVX2 versions are picked at startup from CPUID, the
+	               scalar loops are the fallback everywhere else.
+ ************************************************************************/
+
+#include "internal.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/* Scalar versions, the loops the parser always had */
+static const char *space_scalar(const char *p) {
+    while (*p && (unsigned char)*p <= 32)
+        p++;
+    return p;
+}
+
+static const char *string_scalar(const char *p) {
+    while (*p && *p != '\"' && *p != '\\')
+        p++;
+    return p;
+}
+
+static void block_scalar(const char *p, BMASK_t *m) {
+    memset(m, 0, sizeof(BMASK_t));
+    for (int i = 0; i < 64; i++) {
+        unsigned char c = (unsigned char)p[i];
+        uint64_t bit = (uint64_t)1 << i;
+        if (c <= 32)
+            m->space |= bit;
+        else if (c == '\"')
+            m->quote |= bit;
+        else if (c == '\\')
+            m->backslash |= bit;
+        else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',')
+            m->op |= bit;
+    }
+}
+
+#ifdef SIMD_X86
+/*
+ * The vector scanners load whole aligned blocks, starting with the block
+ * holding p. An aligned block never crosses a page, and scanning stops
+ * at the block holding the terminating NUL, so reading the bytes around
+ * the text is safe even though they are outside the allocation.
+ * AddressSanitizer cannot know that, hence no_sanitize_address.
+ */
+
+/* Bytes ending a whitespace run: 0 or above 32 */
+static inline unsigned space_mask_sse2(__m128i v) {
+    __m128i low = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(32)), v);
+    __m128i nul = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+    return (unsigned)_mm_movemask_epi8(_mm_andnot_si128(nul, low)) ^ 0xFFFFu;
+}
+
+/* Bytes ending a run of plain string characters: '"', '\\' or 0 */
+static inline unsigned string_mask_sse2(__m128i v) {
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')),
+                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return (unsigned)_mm_movemask_epi8(hit);
+}
+
+/* ('{' and '['), ('}' and ']') only differ in bit 0x20 */
+static inline unsigned op_mask_sse2(__m128i v) {
+    __m128i low = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(low, _mm_set1_epi8('{')),
+                               _mm_cmpeq_epi8(low, _mm_set1_epi8('}')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+    return (unsigned)_mm_movemask_epi8(hit);
+}
+
+/* Loads are unaligned and stay within the 64 bytes at p */
+static void block_sse2(const char *p, BMASK_t *m) {
+    memset(m, 0, sizeof(BMASK_t));
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i space = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(32)), v);
+        m->space |= (uint64_t)_mm_movemask_epi8(space) << (16 * i);
+        m->quote |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"'))) << (16 * i);
+        m->backslash |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << (16 * i);
+        m->op |= (uint64_t)op_mask_sse2(v) << (16 * i);
+    }
+}
+
+__attribute__((no_sanitize_address))
+static const char *space_sse2(const char *p) {
+    size_t off = (uintptr_t)p & 15;
+    const char *base = p - off;
+    unsigned mask = space_mask_sse2(_mm_load_si128((const __m128i *)base)) & (0xFFFFu << off);
+    while (!mask) {
+        base += 16;
+        mask = space_mask_sse2(_mm_load_si128((const __m128i *)base));
+    }
+    return base + __builtin_ctz(mask);
+}
+
+__attribute__((no_sanitize_address))
+static const char *string_sse2(const char *p) {
+    size_t off = (uintptr_t)p & 15;
+    const char *base = p - off;
+    unsigned mask = string_mask_sse2(_mm_load_si128((const __m128i *)base)) & (0xFFFFu << off);
+    while (!mask) {
+        base += 16;
+        mask = string_mask_sse2(_mm_load_si128((const __m128i *)base));
+    }
+    return base + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned space_mask_avx2(__m256i v) {
+    __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(32)), v);
+    __m256i nul = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+    return ~(unsigned)_mm256_movemask_epi8(_mm256_andnot_si256(nul, low));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned string_mask_avx2(__m256i v) {
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')),
+                                  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    return (unsigned)_mm256_movemask_epi8(hit);
+}
+
+__attribute__((target("avx2")))
+static inline int op_mask_avx2(__m256i v) {
+    __m256i low = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(low, _mm256_set1_epi8('{')),
+                                  _mm256_cmpeq_epi8(low, _mm256_set1_epi8('}')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')));
+    return _mm256_movemask_epi8(hit);
+}
+
+static inline uint64_t halves(int lo, int hi) {
+    return (uint64_t)(uint32_t)lo | (uint64_t)(uint32_t)hi << 32;
+}
+
+__attribute__((target("avx2")))
+static void block_avx2(const char *p, BMASK_t *m) {
+    __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+    __m256i space = _mm256_set1_epi8(32), quote = _mm256_set1_epi8('\"');
+    __m256i slash = _mm256_set1_epi8('\\');
+    m->space = halves(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(lo, space), lo)),
+                      _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(hi, space), hi)));
+    m->quote = halves(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote)),
+                      _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)));
+    m->backslash = halves(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, slash)),
+                          _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, slash)));
+    m->op = halves(op_mask_avx2(lo), op_mask_avx2(hi));
+}
+
+__attribute__((target("avx2"), no_sanitize_address))
+static const char *space_avx2(const char *p) {
+    size_t off = (uintptr_t)p & 31;
+    const char *base = p - off;
+    unsigned mask = space_mask_avx2(_mm256_load_si256((const __m256i *)base)) & (0xFFFFFFFFu << off);
+    while (!mask) {
+        base += 32;
+        mask = space_mask_avx2(_mm256_load_si256((const __m256i *)base));
+    }
+    return base + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2"), no_sanitize_address))
+static const char *string_avx2(const char *p) {
+    size_t off = (uintptr_t)p & 31;
+    const char *base = p - off;
+    unsigned mask = string_mask_avx2(_mm256_load_si256((const __m256i *)base)) & (0xFFFFFFFFu << off);
+    while (!mask) {
+        base += 32;
+        mask = string_mask_avx2(_mm256_load_si256((const __m256i *)base));
+    }
+    return base + __builtin_ctz(mask);
+}
+#endif
+
+const char *(*scan_space)(const char *) = space_scalar;
+const char *(*scan_string)(const char *) = string_scalar;
+void (*scan_block)(const char *, BMASK_t *) = block_scalar;
+
+static int simd_best = SIMD_SCALAR;
+static int simd_used = SIMD_SCALAR;
+
+/* Runs before main, so the pointers never change under a parser */
+__attribute__((constructor))
+static void simd_init(void) {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        simd_best = SIMD_SSE2;
+    if (__builtin_cpu_supports("avx2"))
+        simd_best = SIMD_AVX2;
+#endif
+    json_simd_select(simd_best);
+}
+
+int json_simd_level(void) {
+    return simd_used;
+}
+
+/* Not thread safe, meant for start up and benchmarks */
+int json_simd_select(int level) {
+    if (level > simd_best || level < SIMD_SCALAR)
+        level = simd_best;
+    switch (level) {
+#ifdef SIMD_X86
+        case SIMD_AVX2:
+            scan_space = space_avx2;
+            scan_string = string_avx2;
+            scan_block = block_avx2;
+            break;
+        case SIMD_SSE2:
+            scan_space = space_sse2;
+            scan_string = string_sse2;
+            scan_block = block_sse2;
+            break;
+#endif
+        default:
+            scan_space = space_scalar;
+            scan_string = string_scalar;
+            scan_block = block_scalar;
+            level = SIMD_SCALAR;
+            break;
+    }
+    simd_used = level;
+    return level;
+}
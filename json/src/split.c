@@ -0,0 +1,261 @@
+/*************************************************************************
+	> File Name: src/split.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: One large array parsed on several threads. The structural
+	               index gives the element boundaries without parsing
+	               anything; the document around the array is built with
+	               the array left empty, runs of elements are parsed at
+	               once, each into an arena of its own, and the runs are
+	               linked back in order.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "internal.h"
+
+#define SPLIT_MIN ((size_t)256 << 10)  // below this one thread is faster
+
+/* A run of elements, parsed by one thread */
+typedef struct Run {
+    STAGE_t st;
+    const size_t *start;  // first token of each element, then one more
+    size_t count;
+    JNODE_p first, last;
+    int ok;
+    JMEMSTATS_t stats;    // allocations made on its thread
+} RUN_t;
+
+/* Token after the value at token at, balanced brackets only */
+static size_t skip_value(const STAGE_t *st, size_t at) {
+    size_t depth = 0;
+    do {
+        char c = st->text[st->pos[at]];
+        if (c == '[' || c == '{')
+            depth++;
+        else if ((c == ']' || c == '}') && depth)
+            depth--;
+        else if (!c)
+            return at;  // ran out, left for the parser to reject
+        at++;
+    } while (depth);
+    return at;
+}
+
+/* Whether the string at token at equals key. Keys are short, the bound
+   from the next token keeps the copy small. */
+static int key_equal(const STAGE_t *st, size_t at, const char *key) {
+    char small[256];
+    size_t size = st->pos[at + 1] - st->pos[at];
+    char *out = size <= sizeof(small) ? small : (char *)emalloc(size);
+    if (!out)
+        return 0;
+    const char *end = string_unescape(out, st->text + st->pos[at] + 1, NULL);
+    int equal = end && !strcmp(out, key);
+    if (out != small)
+        safe_free(out);
+    return equal;
+}
+
+/* Token of the value pointer names, NO_HOLE when it does not resolve */
+static size_t find_target(const STAGE_t *st, JPATH_p path) {
+    size_t at = 0;
+    for (size_t i = 0; path && i < path->count; i++) {
+        const TOKEN_t *token = &path->token[i];
+        char open = st->text[st->pos[at]];
+        if (open != '{' && open != '[')
+            return NO_HOLE;
+        if (open == '[' && token->idx == NO_INDEX)
+            return NO_HOLE;
+        size_t n = 0;
+        for (at++;; n++) {
+            char c = st->text[st->pos[at]];
+            if (c == ']' || c == '}' || !c)
+                return NO_HOLE;
+            if (open == '{') {
+                if (c != '\"' || st->text[st->pos[at + 1]] != ':')
+                    return NO_HOLE;
+                int match = key_equal(st, at, token->key);
+                at += 2;
+                if (match)
+                    break;
+            } else if (n == token->idx) {
+                break;
+            }
+            at = skip_value(st, at);
+            if (st->text[st->pos[at]] != ',')
+                return NO_HOLE;
+            at++;
+        }
+    }
+    return at;
+}
+
+/* Each element must end right before the ',' or ']' found for it */
+static void *run_parse(void *arg) {
+    RUN_t *run = (RUN_t *)arg;
+    for (size_t i = 0; i < run->count; i++) {
+        JNODE_p node = stage_node(&run->st);
+        if (!node)
+            return NULL;
+        if (run->last) {
+            run->last->next = node;
+            node->prev = run->last;
+        } else {
+            run->first = node;
+        }
+        run->last = node;
+        run->st.at = run->start[i];
+        if (!stage_value(&run->st, node) || run->st.at != run->start[i + 1] - 1)
+            return NULL;
+    }
+    run->ok = 1;
+    return NULL;
+}
+
+/* run_parse on a thread of its own, whose counts go back with the run */
+static void *run_thread(void *arg) {
+    RUN_t *run = (RUN_t *)arg;
+    run_parse(run);
+    mem_stats_take(&run->stats);
+    return NULL;
+}
+
+/* Where the elements of the array at token hole start, with the token
+   past its ']' last. NULL if the commas are not where they belong. */
+static size_t *element_starts(const STAGE_t *st, size_t hole, size_t *count) {
+    size_t cap = 1024, n = 0, at = hole + 1;
+    size_t *start = (size_t *)emalloc(cap * sizeof(size_t));
+    while (start && st->text[st->pos[at]] != ']') {
+        if (n + 1 == cap) {
+            size_t *grown = (size_t *)erealloc(start, (cap *= 2) * sizeof(size_t));
+            if (!grown)
+                break;
+            start = grown;
+        }
+        start[n++] = at;
+        at = skip_value(st, at);
+        if (st->text[st->pos[at]] == ',' && st->text[st->pos[at + 1]] != ']')
+            at++;
+        else if (st->text[st->pos[at]] != ']')
+            break;
+    }
+    if (!start || st->text[st->pos[at]] != ']' || at != st->hole_end) {
+        safe_free(start);
+        return NULL;
+    }
+    start[n] = at + 1;
+    *count = n;
+    return start;
+}
+
+/* The elements of the hole array parsed in runs of about the same number
+   of bytes, the first on the calling thread */
+static int split_array(STAGE_t *st, JARENA_p arena, int threads) {
+    size_t count = 0, next = 0;
+    size_t *start = element_starts(st, st->hole, &count);
+    RUN_t *runs = (RUN_t *)emalloc(threads * sizeof(RUN_t));
+    pthread_t *pool = (pthread_t *)emalloc(threads * sizeof(pthread_t));
+    int *started = (int *)emalloc(threads * sizeof(int));
+    int ok = st->hole_node && start && runs && pool && started;
+    if (runs) memset(runs, 0, threads * sizeof(RUN_t));
+    if (started) memset(started, 0, threads * sizeof(int));
+
+    size_t from = st->pos[st->hole], bytes = st->pos[st->hole_end] - from;
+    for (int t = 0; ok && t < threads; t++) {
+        RUN_t *run = &runs[t];
+        size_t limit = from + bytes / threads * (t + 1);
+        run->start = start + next;
+        while (next < count && (t == threads - 1 || st->pos[start[next]] < limit))
+            next++;
+        run->count = start + next - run->start;
+        run->st = *st;
+        run->st.hole = NO_HOLE;
+        if (arena) {  // with the caller's allocator
+            run->st.arena = arena_create_like(arena, st->pos[start[next]] - st->pos[run->start[0]]);
+            if (!run->st.arena) {
+                ok = 0;
+                break;
+            }
+            if (arena_pool(arena))  // names go to the caller's pool
+                json_arena_intern(run->st.arena, arena_pool(arena));
+        }
+        if (t > 0)
+            started[t] = !pthread_create(&pool[t], NULL, run_thread, run);
+    }
+    for (int t = 0; started && t < threads; t++) {
+        if (started[t]) {
+            pthread_join(pool[t], NULL);
+            mem_stats_add(&runs[t].stats);
+        } else if (ok) {
+            run_parse(&runs[t]);  // the first run, or no thread to be had
+        }
+    }
+
+    /* Link the runs in order, their arenas go to the caller's */
+    JNODE_p array = st->hole_node, tail = NULL;
+    for (int t = 0; array && runs && t < threads; t++) {
+        RUN_t *run = &runs[t];
+        ok = ok && run->ok;
+        if (run->first) {
+            if (tail) {
+                tail->next = run->first;
+                run->first->prev = tail;
+            } else {
+                array->child = run->first;
+            }
+            tail = run->last;
+        }
+        if (run->st.arena)
+            arena_merge(arena, run->st.arena);
+    }
+    if (array) {
+        array->value.list.tail = tail;
+        array->size = count;
+    }
+
+    safe_free(started);
+    safe_free(pool);
+    safe_free(runs);
+    safe_free(start);
+    return ok;
+}
+
+JNODE_p json_parse_parallel(const char *text, const char *pointer, JARENA_p arena, int threads, JERROR_t *err) {
+    size_t len = strlen(text);
+    threads = thread_count(threads);
+    if (threads < 2 || len < SPLIT_MIN || len > STAGE_MAX)
+        return json_parse_r(text, arena, err);
+
+    STAGE_t st = {text, NULL, 0, 0, 0, arena, NO_HOLE, NO_HOLE, NULL};
+    MARK_t mark;
+    if (arena)
+        arena_mark(arena, &mark);
+    JPATH_p path = json_path_compile(pointer ? pointer : "");
+    JNODE_p root = NULL;
+    if (path && stage_index(&st, len) && st.count) {
+        size_t hole = find_target(&st, path);
+        if (hole != NO_HOLE && text[st.pos[hole]] == '[') {
+            st.hole = hole;
+            st.hole_end = skip_value(&st, hole) - 1;
+        }
+    }
+    json_path_free(path);
+
+    /* The document around the array, then the array */
+    if (st.hole != NO_HOLE && (root = stage_node(&st))
+        && (!stage_value(&st, root) || !split_array(&st, arena, threads))) {
+        json_delete(root);
+        root = NULL;
+    }
+    safe_free(st.pos);
+    if (!root) {  // not an array there, or malformed: parse as usual
+        if (arena)
+            arena_rollback(arena, &mark);
+        return json_parse_r(text, arena, err);
+    }
+    if (err) memset(err, 0, sizeof(JERROR_t));
+    return root;
+}
@@ -0,0 +1,265 @@
+/*************************************************************************
+	> File Name: src/stage.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Two stage parser. Stage 1 classifies the text 64 bytes
+	               at a time (scan_block) and turns the masks into the
+	               offsets of every structural character, string start and
+	               scalar start, with quotes and escapes resolved by bit
+	               arithmetic instead of a branch per byte. Stage 2 walks
+	               the offsets and builds the same tree parse_value does.
+ ************************************************************************/
+
+#include "internal.h"
+
+/* JSON_ENGINE_AUTO: smaller texts descend, and so does everything at the
+   scalar level, where the index runs at about 0.8x descent. With SSE2 or
+   AVX2 it ran 1.0-1.16x from 64KB up to 1MB, 0.94-1.01x past that. */
+#define STAGE_MIN ((size_t)64 << 10)
+
+static int engine = JSON_ENGINE_DESCENT;  // read and set atomically
+
+/* Bit i set when an odd run of backslashes ends at i - 1. *carry holds
+   the escape of the first byte of the next block. */
+static inline uint64_t find_escaped(uint64_t backslash, uint64_t *carry) {
+    uint64_t escaped = *carry;
+    *carry = 0;
+    backslash &= ~escaped;
+    while (backslash) {
+        int i = __builtin_ctzll(backslash);
+        backslash &= backslash - 1;
+        if (i == 63)
+            *carry = 1;
+        else
+            escaped |= (uint64_t)1 << (i + 1);
+        backslash &= ~escaped;  // an escaped backslash escapes nothing
+    }
+    return escaped;
+}
+
+/* Bit i is the xor of bits 0..i: set from an opening quote up to, not
+   including, the closing one */
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* Stage 1. Offsets of: {}[]:, outside strings, opening quotes, and the
+   first byte of every other run outside strings (numbers, literals and
+   garbage alike). */
+int stage_index(STAGE_t *st, size_t len) {
+    uint64_t escape_carry = 0, string_carry = 0, scalar_carry = 0;
+    char tail[64];
+
+    st->cap = len / 8 + 64;
+    st->pos = (uint32_t *)emalloc(st->cap * sizeof(uint32_t));
+    if (!st->pos)
+        return 0;
+    for (size_t base = 0; base < len; base += 64) {
+        const char *block = st->text + base;
+        BMASK_t m;
+        if (len - base < 64) {
+            /* Pad the last block with spaces, nothing is read past the text */
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, len - base);
+            block = tail;
+        }
+        scan_block(block, &m);
+
+        uint64_t quote = m.quote & ~find_escaped(m.backslash, &escape_carry);
+        uint64_t in_string = prefix_xor(quote) ^ string_carry;
+        string_carry = (uint64_t)((int64_t)in_string >> 63);
+        uint64_t scalar = ~(m.space | m.op | quote | in_string);
+        uint64_t starts = scalar & ~(scalar << 1 | scalar_carry);
+        scalar_carry = scalar >> 63;
+        uint64_t bits = (m.op & ~in_string) | (quote & in_string) | starts;
+
+        if (st->cap - st->count <= 64) {  // room for the end as well
+            size_t cap = st->cap * 2;
+            uint32_t *pos = (uint32_t *)erealloc(st->pos, cap * sizeof(uint32_t));
+            if (!pos)
+                return 0;
+            st->pos = pos;
+            st->cap = cap;
+        }
+        uint32_t *out = st->pos + st->count;
+        st->count += __builtin_popcountll(bits);
+        while (bits) {
+            *out++ = (uint32_t)(base + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+    st->pos[st->count] = (uint32_t)len;  // the NUL, ends every walk
+    return 1;
+}
+
+JNODE_p stage_node(STAGE_t *st) {
+    if (st->arena)
+        return arena_node(st->arena);
+    JNODE_p node = (JNODE_p)emalloc(sizeof(JNODE_t));
+    if (node) memset(node, 0, sizeof(JNODE_t));
+    return node;
+}
+
+static inline const char *token(STAGE_t *st) {
+    return st->text + st->pos[st->at];
+}
+
+/* The string starting at the token. The next token bounds its length. */
+static int stage_string(STAGE_t *st, JNODE_p node) {
+    const char *value = token(st);
+    size_t size = st->pos[st->at + 1] - st->pos[st->at];  // quotes included
+    char *out = NULL;
+    if (size <= SMALL_MAX + 2)
+        out = small_value(node);
+    else
+        out = st->arena ? (char *)arena_alloc(st->arena, size, 1) : (char *)emalloc(size);
+    if (!out)
+        return 0;
+    node->value.string_val = out;
+    set_type(node, J_String);
+    st->at++;
+    const char *end = string_unescape(out, value + 1, NULL);
+    return end && end <= token(st);
+}
+
+/* A literal or a number, followed by nothing but whitespace */
+static int stage_scalar(STAGE_t *st, JNODE_p node) {
+    const char *value = token(st), *end = NULL;
+    st->at++;
+    if (!strncmp(value, "null", 4)) {
+        set_type(node, J_NULL);
+        end = value + 4;
+    } else if (!strncmp(value, "false", 5)) {
+        set_type(node, J_False);
+        node->value.int_val = 0;
+        end = value + 5;
+    } else if (!strncmp(value, "true", 4)) {
+        set_type(node, J_True);
+        node->value.int_val = 1;
+        end = value + 4;
+    } else if (*value == '-' || (*value >= '0' && *value <= '9')) {
+        int type = J_Int;
+        int64_t num = 0;
+        double real = 0;
+        end = number_scan(value, &type, &num, &real);
+        if (!end)
+            return 0;
+        if (type == J_Int)
+            node->value.int_val = (int)num;
+        else if (type == J_Int64)
+            node->value.int64_val = num;
+        else
+            node->value.double_val = real;
+        set_type(node, type);
+    } else {
+        return 0;
+    }
+    const char *next = token(st);
+    while (end < next && *end && (unsigned char)*end <= 32)
+        end++;
+    return end == next;
+}
+
+/* Array or object, children linked as parse_array and parse_object do */
+static int stage_list(STAGE_t *st, JNODE_p node, int type) {
+    char close = type == J_Object ? '}' : ']';
+    JNODE_p child = NULL;
+
+    set_type(node, type);
+    st->at++;
+    if (*token(st) == close) {
+        st->at++;
+        return 1;
+    }
+    for (;;) {
+        JNODE_p item = stage_node(st);
+        if (!item)
+            return 0;
+        if (child) {
+            child->next = item;
+            item->prev = child;
+        } else {
+            node->child = item;
+        }
+        node->value.list.tail = child = item;
+        node->size++;
+        if (type == J_Object) {
+            if (*token(st) != '\"' || !stage_string(st, child))
+                return 0;
+            if (!take_key(child, st->arena) || *token(st) != ':')
+                return 0;
+            st->at++;
+        }
+        if (!stage_value(st, child))
+            return 0;
+        if (*token(st) == close) {
+            st->at++;
+            return 1;
+        }
+        if (*token(st) != ',')
+            return 0;
+        st->at++;
+    }
+}
+
+int stage_value(STAGE_t *st, JNODE_p node) {
+    if (st->at == st->hole) {
+        /* Left empty for the caller, see split.c */
+        set_type(node, J_Array);
+        st->hole_node = node;
+        st->at = st->hole_end + 1;
+        return 1;
+    }
+    switch (*token(st)) {
+        case '{':
+            return stage_list(st, node, J_Object);
+        case '[':
+            return stage_list(st, node, J_Array);
+        case '\"':
+            return stage_string(st, node);
+        case ',':
+        case ':':
+        case ']':
+        case '}':
+        case 0:
+            return 0;
+        default:
+            return stage_scalar(st, node);
+    }
+}
+
+JNODE_p stage_parse(const char *text, JARENA_p arena) {
+    int which = json_engine();  // once, so a concurrent select changes only later calls
+    if (which == JSON_ENGINE_DESCENT)
+        return NULL;
+    size_t len = strlen(text);
+    if (len > STAGE_MAX || (which == JSON_ENGINE_AUTO && (len < STAGE_MIN || json_simd_level() == SIMD_SCALAR)))
+        return NULL;
+
+    STAGE_t st = {text, NULL, 0, 0, 0, arena, NO_HOLE, NO_HOLE, NULL};
+    JNODE_p root = NULL;
+    if (stage_index(&st, len) && (root = stage_node(&st)) && !stage_value(&st, root)) {
+        json_delete(root);  // the caller descends to report the error
+        root = NULL;
+    }
+    safe_free(st.pos);
+    return root;
+}
+
+int json_engine(void) {
+    return __atomic_load_n(&engine, __ATOMIC_RELAXED);
+}
+
+/* Safe while other threads parse: a call already running keeps the
+   engine it started with */
+int json_engine_select(int which) {
+    if (which >= JSON_ENGINE_DESCENT && which <= JSON_ENGINE_AUTO)
+        __atomic_store_n(&engine, which, __ATOMIC_RELAXED);
+    return json_engine();
+}
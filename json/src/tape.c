@@ -0,0 +1,529 @@
+/*************************************************************************
+	> File Name: src/tape.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Read only documents as a tape: one 64 bit word per value
+	               in document order, the tag in the top byte and the
+	               payload below it, with strings in a side buffer. A
+	               container's first word holds the position past its end,
+	               so a subtree is skipped in one step. Saved as an image,
+	               a tape is mapped back in as it is.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+/* Tags, the top byte of a word */
+#define T_NULL 'n'
+#define T_TRUE 't'
+#define T_FALSE 'f'
+#define T_INT 'i'     // payload: the int
+#define T_INT64 'l'   // the value in the next word
+#define T_DOUBLE 'd'  // the bits in the next word
+#define T_STRING 's'  // payload: offset of the string in strings
+#define T_KEY 'k'     // member name, the value follows
+#define T_ARRAY '['   // payload: count << 32 | position past the ']' word
+#define T_OBJECT '{'
+#define T_ARRAY_END ']'  // payload: position of the '[' word
+#define T_OBJECT_END '}'
+
+#define PAYLOAD ((((uint64_t)1) << 56) - 1)
+#define COUNT_MAX 0xFFFFFFu   // counts this large are walked instead
+
+/* Strings are stored as a 4 byte length, the bytes and a NUL */
+struct JsonTape {
+    uint64_t *word;
+    size_t count, cap;
+    char *strings;
+    size_t len, size;
+    void *map;  // the image word and strings point into, NULL if none
+    size_t map_len;
+    int failed;  // out of memory or positions, while building
+};
+
+/* Image file: this header, the words, then the strings. Offsets only, so
+   it is valid wherever it is mapped. */
+#define IMAGE_MAGIC "CJSONTAP"
+#define IMAGE_VERSION 1
+#define IMAGE_ORDER 0x01020304u  // tells a file written on a machine of
+                                 // the other byte order
+typedef struct ImageHead {
+    char magic[8];
+    uint32_t version, order;
+    uint64_t words, string_bytes;
+} IMAGE_t;
+
+static inline int tag_of(JTAPE_p tape, size_t at) {
+    return (int)(tape->word[at] >> 56);
+}
+
+static inline uint64_t payload_of(JTAPE_p tape, size_t at) {
+    return tape->word[at] & PAYLOAD;
+}
+
+/* Nothing is added once building has failed */
+static void tape_word(JTAPE_p tape, uint64_t word) {
+    if (tape->failed)
+        return;
+    if (tape->count == 0xFFFFFFFFu) {  // positions must fit in 32 bits
+        tape->failed = 1;
+        return;
+    }
+    if (tape->count == tape->cap) {
+        size_t cap = tape->cap ? tape->cap * 2 : 64;
+        uint64_t *word = (uint64_t *)erealloc(tape->word, cap * sizeof(uint64_t));
+        if (!word) {
+            tape->failed = 1;
+            return;
+        }
+        tape->word = word;
+        tape->cap = cap;
+    }
+    tape->word[tape->count++] = word;
+}
+
+static void tape_put(JTAPE_p tape, int tag, uint64_t payload) {
+    tape_word(tape, (uint64_t)tag << 56 | (payload & PAYLOAD));
+}
+
+static void tape_string(JTAPE_p tape, int tag, const char *str) {
+    uint32_t n = (uint32_t)strlen(str);
+    if (tape->failed)
+        return;
+    if (tape->len + n + 5 > tape->size) {
+        size_t size = tape->size;
+        while (tape->len + n + 5 > size)
+            size = size ? size * 2 : 256;
+        char *strings = (char *)erealloc(tape->strings, size);
+        if (!strings) {
+            tape->failed = 1;
+            return;
+        }
+        tape->strings = strings;
+        tape->size = size;
+    }
+    tape_put(tape, tag, tape->len);
+    if (tape->failed)
+        return;
+    memcpy(tape->strings + tape->len, &n, 4);
+    memcpy(tape->strings + tape->len + 4, str, n + 1);
+    tape->len += n + 5;
+}
+
+static void tape_value(JTAPE_p tape, JNODE_p node) {
+    uint64_t bits = 0;
+    switch (node->type & TYPE_MASK) {
+        case J_NULL:
+            tape_put(tape, T_NULL, 0);
+            break;
+        case J_True:
+            tape_put(tape, T_TRUE, 0);
+            break;
+        case J_False:
+            tape_put(tape, T_FALSE, 0);
+            break;
+        case J_Int:
+            tape_put(tape, T_INT, (uint32_t)node->value.int_val);
+            break;
+        case J_Int64:
+            tape_put(tape, T_INT64, 0);
+            tape_word(tape, (uint64_t)node->value.int64_val);
+            break;
+        case J_Double:
+            memcpy(&bits, &node->value.double_val, sizeof(bits));
+            tape_put(tape, T_DOUBLE, 0);
+            tape_word(tape, bits);
+            break;
+        case J_String:
+            tape_string(tape, T_STRING, node->value.string_val ? node->value.string_val : "");
+            break;
+        case J_Array:
+        case J_Object: {
+            int object = (node->type & TYPE_MASK) == J_Object;
+            size_t start = tape->count, count = 0;
+            tape_put(tape, object ? T_OBJECT : T_ARRAY, 0);
+            for (JNODE_p c = node->child; c && !tape->failed; c = c->next, count++) {
+                if (object)
+                    tape_string(tape, T_KEY, c->name ? c->name : "");
+                tape_value(tape, c);
+            }
+            tape_put(tape, object ? T_OBJECT_END : T_ARRAY_END, start);
+            if (tape->failed)
+                break;
+            if (count > COUNT_MAX)
+                count = COUNT_MAX;
+            tape->word[start] |= (uint64_t)count << 32 | (uint64_t)tape->count;
+            break;
+        }
+        default:
+            tape_put(tape, T_NULL, 0);
+            break;
+    }
+}
+
+JTAPE_p json_tape_from_tree(JNODE_p root) {
+    JTAPE_p tape = (JTAPE_p)emalloc(sizeof(JTAPE_t));
+    void *trim = NULL;
+    if (!tape)
+        return NULL;
+    memset(tape, 0, sizeof(JTAPE_t));
+    if (root)
+        tape_value(tape, root);
+    if (tape->failed) {
+        json_tape_free(tape);
+        return NULL;
+    }
+    /* Trim to size, the tape is read only from here on. Kept as it is
+       when the smaller block cannot be had. */
+    if (tape->count && (trim = erealloc(tape->word, tape->count * sizeof(uint64_t))))
+        tape->word = (uint64_t *)trim, tape->cap = tape->count;
+    if (tape->len && (trim = erealloc(tape->strings, tape->len)))
+        tape->strings = (char *)trim, tape->size = tape->len;
+    return tape;
+}
+
+/* The tree is only a step on the way, it lives in a scratch arena */
+JTAPE_p json_tape_parse(const char *text, JERROR_t *err) {
+    JARENA_p arena = json_arena_create(strlen(text));
+    JNODE_p root = arena ? json_parse_r(text, arena, err) : NULL;
+    JTAPE_p tape = root ? json_tape_from_tree(root) : NULL;
+    if (!tape && (root || !arena) && err) {
+        memset(err, 0, sizeof(*err));
+        err->code = JSON_ERR_NOMEM;
+    }
+    json_arena_destroy(arena);
+    return tape;
+}
+
+void json_tape_free(JTAPE_p tape) {
+    if (!tape) return;
+    if (tape->map) {
+        munmap(tape->map, tape->map_len);
+    } else {
+        safe_free(tape->word);
+        safe_free(tape->strings);
+    }
+    safe_free(tape);
+}
+
+int json_tape_save(JTAPE_p tape, const char *path) {
+    IMAGE_t head = {IMAGE_MAGIC, IMAGE_VERSION, IMAGE_ORDER, tape->count, tape->len};
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return 0;
+    int ok = fwrite(&head, sizeof(head), 1, fp) == 1
+             && fwrite(tape->word, sizeof(uint64_t), tape->count, fp) == tape->count
+             && (!tape->len || fwrite(tape->strings, 1, tape->len, fp) == tape->len);
+    return fclose(fp) == 0 && ok;
+}
+
+int json_save_image(JNODE_p root, const char *path) {
+    JTAPE_p tape = json_tape_from_tree(root);
+    int ok = tape && tape->count && json_tape_save(tape, path);
+    json_tape_free(tape);
+    return ok;
+}
+
+/* Mapped read only and shared: nothing is read until it is visited, and
+   every process opening the same image uses the same page cache. Only
+   the header is checked here; the accessors bound every offset and jump
+   they read, so a corrupt image yields wrong values, never a read
+   outside the mapping. */
+JTAPE_p json_open_image(const char *path) {
+    struct stat st;
+    IMAGE_t head;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(IMAGE_t)) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    memcpy(&head, map, sizeof(head));
+    uint64_t size = (uint64_t)st.st_size - sizeof(IMAGE_t);
+    if (memcmp(head.magic, IMAGE_MAGIC, sizeof(head.magic)) || head.version != IMAGE_VERSION
+        || head.order != IMAGE_ORDER || !head.words || head.words > size / sizeof(uint64_t)
+        || head.string_bytes != size - head.words * sizeof(uint64_t)) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    JTAPE_p tape = (JTAPE_p)emalloc(sizeof(JTAPE_t));
+    if (!tape) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    memset(tape, 0, sizeof(JTAPE_t));
+    tape->word = (uint64_t *)((char *)map + sizeof(IMAGE_t));
+    tape->count = tape->cap = (size_t)head.words;
+    tape->strings = (char *)(tape->word + tape->count);
+    tape->len = tape->size = (size_t)head.string_bytes;
+    tape->map = map;
+    tape->map_len = (size_t)st.st_size;
+    return tape;
+}
+
+void json_tape_stats(JTAPE_p tape, size_t *words, size_t *string_bytes) {
+    if (words) *words = tape->count;
+    if (string_bytes) *string_bytes = tape->len;
+}
+
+int json_tape_type(JTAPE_p tape, size_t at) {
+    if (!tape || at >= tape->count)
+        return -1;
+    switch (tag_of(tape, at)) {
+        case T_NULL: return J_NULL;
+        case T_TRUE: return J_True;
+        case T_FALSE: return J_False;
+        case T_INT: return J_Int;
+        case T_INT64: return J_Int64;
+        case T_DOUBLE: return J_Double;
+        case T_STRING: return J_String;
+        case T_ARRAY: return J_Array;
+        case T_OBJECT: return J_Object;
+        default: return -1;
+    }
+}
+
+int64_t json_tape_int64(JTAPE_p tape, size_t at) {
+    switch (json_tape_type(tape, at)) {
+        case J_Int: return (int32_t)(uint32_t)payload_of(tape, at);
+        case J_Int64: return at + 1 < tape->count ? (int64_t)tape->word[at + 1] : 0;
+        case J_Double: return (int64_t)json_tape_double(tape, at);
+        case J_True: return 1;
+        default: return 0;
+    }
+}
+
+double json_tape_double(JTAPE_p tape, size_t at) {
+    double value = 0;
+    switch (json_tape_type(tape, at)) {
+        case J_Double:
+            if (at + 1 < tape->count)
+                memcpy(&value, &tape->word[at + 1], sizeof(value));
+            return value;
+        case J_Int:
+        case J_Int64:
+        case J_True:
+            return (double)json_tape_int64(tape, at);
+        default:
+            return 0;
+    }
+}
+
+/* NULL when the length and NUL do not fit the strings, as only a
+   corrupt image has it */
+static const char *string_at(JTAPE_p tape, size_t at, size_t *len) {
+    uint64_t off = payload_of(tape, at);
+    uint32_t n;
+    if (off + 5 > tape->len)
+        return NULL;
+    memcpy(&n, tape->strings + off, 4);
+    if (n > tape->len - off - 5 || tape->strings[off + 4 + n])
+        return NULL;
+    if (len) *len = n;
+    return tape->strings + off + 4;
+}
+
+const char *json_tape_string(JTAPE_p tape, size_t at, size_t *len) {
+    if (json_tape_type(tape, at) != J_String)
+        return NULL;
+    return string_at(tape, at, len);
+}
+
+/* Position after the value at at, O(1) for containers as well. Always
+   forward and at most count, so walks end even on a corrupt image. */
+size_t json_tape_skip(JTAPE_p tape, size_t at) {
+    size_t end = at + 1;
+    if (!tape || at >= tape->count)
+        return JTAPE_END;
+    switch (tag_of(tape, at)) {
+        case T_ARRAY:
+        case T_OBJECT:
+            end = (size_t)(payload_of(tape, at) & 0xFFFFFFFFu);
+            break;
+        case T_INT64:
+        case T_DOUBLE:
+            end = at + 2;
+            break;
+        default:
+            break;
+    }
+    return end > at && end <= tape->count ? end : tape->count;
+}
+
+/* A value at or after at in a container, member names stepped over */
+static size_t value_at(JTAPE_p tape, size_t at) {
+    if (at + 1 >= tape->count)  // not even room for the closing word
+        return JTAPE_END;
+    int tag = tag_of(tape, at);
+    if (tag == T_ARRAY_END || tag == T_OBJECT_END)
+        return JTAPE_END;
+    return tag == T_KEY ? at + 1 : at;
+}
+
+size_t json_tape_first(JTAPE_p tape, size_t at) {
+    int type = json_tape_type(tape, at);
+    if (type != J_Array && type != J_Object)
+        return JTAPE_END;
+    return value_at(tape, at + 1);
+}
+
+size_t json_tape_next(JTAPE_p tape, size_t at) {
+    if (!tape || at >= tape->count)
+        return JTAPE_END;
+    return value_at(tape, json_tape_skip(tape, at));
+}
+
+const char *json_tape_name(JTAPE_p tape, size_t at) {
+    if (!tape || !at || at >= tape->count || tag_of(tape, at - 1) != T_KEY)
+        return NULL;
+    return string_at(tape, at - 1, NULL);
+}
+
+size_t json_tape_size(JTAPE_p tape, size_t at) {
+    int type = json_tape_type(tape, at);
+    if (type != J_Array && type != J_Object)
+        return 0;
+    size_t count = (size_t)(payload_of(tape, at) >> 32);
+    if (count < COUNT_MAX)
+        return count;
+    count = 0;
+    for (size_t c = json_tape_first(tape, at); c != JTAPE_END; c = json_tape_next(tape, c))
+        count++;
+    return count;
+}
+
+size_t json_tape_get(JTAPE_p tape, size_t at, const char *name) {
+    if (json_tape_type(tape, at) != J_Object || !name)
+        return JTAPE_END;
+    size_t len = strlen(name), n = 0;
+    for (size_t c = at + 1; c < tape->count && tag_of(tape, c) == T_KEY; c = json_tape_skip(tape, c + 1)) {
+        const char *key = string_at(tape, c, &n);
+        if (key && n == len && !memcmp(key, name, len))
+            return c + 1;
+    }
+    return JTAPE_END;
+}
+
+size_t json_tape_index(JTAPE_p tape, size_t at, size_t idx) {
+    size_t c = json_tape_first(tape, at);
+    for (; c != JTAPE_END && idx; idx--)
+        c = json_tape_next(tape, c);
+    return c;
+}
+
+static JNODE_p tape_node(JARENA_p arena) {
+    JNODE_p node = NULL;
+    if (arena)
+        return arena_node(arena);
+    node = (JNODE_p)emalloc(sizeof(JNODE_t));
+    if (node)
+        memset(node, 0, sizeof(JNODE_t));
+    return node;
+}
+
+static char *tape_strdup(JARENA_p arena, const char *str, size_t len) {
+    if (arena)
+        return arena_strdup(arena, str, len);
+    char *copy = (char *)emalloc(len + 1);
+    if (copy)
+        memcpy(copy, str, len + 1);
+    return copy;
+}
+
+/* Short strings go in the node */
+static int tape_name(JNODE_p node, JARENA_p arena, const char *str, size_t len) {
+    if (arena_pool(arena)) {
+        node->name = (char *)arena_intern(arena, str, len);
+        node->type |= CONST_BIT;
+    } else if (len <= SMALL_MAX) {
+        memcpy(small_name(node), str, len + 1);
+        return 1;
+    } else {
+        node->name = tape_strdup(arena, str, len);
+    }
+    return node->name != NULL;
+}
+
+/* Out of memory: heap nodes made so far are deleted, arena ones stay
+   until the arena goes */
+static JNODE_p tree_fail(JNODE_p node, JARENA_p arena) {
+    if (!arena)
+        json_delete(node);
+    return NULL;
+}
+
+static JNODE_p tree_value(JTAPE_p tape, size_t at, JARENA_p arena) {
+    JNODE_p node = tape_node(arena);
+    int type = json_tape_type(tape, at);
+    size_t len = 0;
+    const char *str = NULL;
+    if (!node)
+        return NULL;
+    set_type(node, type < 0 ? J_NULL : type);
+    switch (type) {
+        case J_True:
+            node->value.int_val = 1;
+            break;
+        case J_Int:
+            node->value.int_val = (int)json_tape_int64(tape, at);
+            break;
+        case J_Int64:
+            node->value.int64_val = json_tape_int64(tape, at);
+            break;
+        case J_Double:
+            node->value.double_val = json_tape_double(tape, at);
+            break;
+        case J_String:
+            if (!(str = json_tape_string(tape, at, &len)))
+                return tree_fail(node, arena);
+            if (len <= SMALL_MAX)
+                memcpy(small_value(node), str, len + 1);
+            else if (!(node->value.string_val = tape_strdup(arena, str, len)))
+                return tree_fail(node, arena);
+            break;
+        case J_Array:
+        case J_Object: {
+            JNODE_p last = NULL;
+            for (size_t c = json_tape_first(tape, at); c != JTAPE_END; c = json_tape_next(tape, c)) {
+                JNODE_p child = tree_value(tape, c, arena);
+                if (!child)
+                    return tree_fail(node, arena);
+                if (last) {
+                    last->next = child;
+                    child->prev = last;
+                } else {
+                    node->child = child;
+                }
+                node->value.list.tail = last = child;
+                node->size++;
+                if (type == J_Object) {
+                    str = string_at(tape, c - 1, &len);
+                    if (!str || !tape_name(child, arena, str, len))
+                        return tree_fail(node, arena);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return node;
+}
+
+JNODE_p json_tape_to_tree(JTAPE_p tape, size_t at, JARENA_p arena) {
+    if (json_tape_type(tape, at) < 0)
+        return NULL;
+    return tree_value(tape, at, arena);
+}
@@ -0,0 +1,325 @@
+/*************************************************************************
+	> File Name: src/transcode.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Text to text reformatting. The grammar runs as the push
+	               parser's state machine does, but tokens are copied to
+	               the output as they are read instead of becoming nodes;
+	               only the whitespace between them is decided here. All
+	               that is kept is the kind of each open container.
+ ************************************************************************/
+
+#include "internal.h"
+
+#define XCODE_BUF 4096
+#define XCODE_READ 65536
+
+/* What the next byte is expected to be */
+enum {
+    X_VALUE,      // a value
+    X_FIRST,      // a value or ']', just after '['
+    X_KEY_FIRST,  // a key or '}', just after '{'
+    X_KEY,        // a key, after ','
+    X_COLON,
+    X_NEXT,       // ',' or the closing bracket of the container
+    X_DONE,       // whitespace, or the next document
+    X_STRING,
+    X_NUMBER,
+    X_LITERAL,
+    X_ERROR
+};
+
+/* Number grammar, the states after each byte */
+enum { N_SIGN, N_ZERO, N_INT, N_DOT, N_FRAC, N_E, N_E_SIGN, N_EXP };
+
+struct JsonTranscoder {
+    JBUF_t out;
+    char stage[XCODE_BUF];
+    int state;
+    char *stack;        // '{' or '[' for each open container
+    size_t depth, cap;
+    int is_key;         // the string being copied is a key
+    int escape;         // the last byte was an unescaped backslash
+    int number;         // N_* so far
+    const char *literal;
+    size_t matched;     // bytes of literal seen
+};
+
+static inline int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static void value_done(JXCODE_p x) {
+    x->state = x->depth ? X_NEXT : X_DONE;
+}
+
+/* Next state of the number after c, -1 if c cannot come next */
+static int number_step(int state, char c) {
+    int digit = c >= '0' && c <= '9';
+    switch (state) {
+        case N_SIGN: return c == '0' ? N_ZERO : digit ? N_INT : -1;
+        case N_ZERO: return c == '.' ? N_DOT : (c == 'e' || c == 'E') ? N_E : -1;
+        case N_INT: return digit ? N_INT : c == '.' ? N_DOT : (c == 'e' || c == 'E') ? N_E : -1;
+        case N_DOT: return digit ? N_FRAC : -1;
+        case N_FRAC: return digit ? N_FRAC : (c == 'e' || c == 'E') ? N_E : -1;
+        case N_E: return (c == '+' || c == '-') ? N_E_SIGN : digit ? N_EXP : -1;
+        case N_E_SIGN:
+        case N_EXP: return digit ? N_EXP : -1;
+        default: return -1;
+    }
+}
+
+static inline int number_complete(int state) {
+    return state == N_ZERO || state == N_INT || state == N_FRAC || state == N_EXP;
+}
+
+static int push(JXCODE_p x, char open) {
+    if (x->depth == x->cap) {
+        size_t cap = x->cap ? x->cap * 2 : 64;
+        char *stack = (char *)erealloc(x->stack, cap);
+        if (!stack)
+            return 0;
+        x->stack = stack;
+        x->cap = cap;
+    }
+    x->stack[x->depth++] = open;
+    buf_putc(&x->out, open);
+    x->state = open == '{' ? X_KEY_FIRST : X_FIRST;
+    return 1;
+}
+
+/* Empty containers stay on one line, others close on a line of their own */
+static int close_container(JXCODE_p x, char close, int empty) {
+    if (!x->depth || x->stack[x->depth - 1] != (close == '}' ? '{' : '['))
+        return 0;
+    x->depth--;
+    if (!empty)
+        buf_break(&x->out, x->depth);
+    buf_putc(&x->out, close);
+    value_done(x);
+    return 1;
+}
+
+/* Start of a value at c, the line broken before it if it is the first of
+   its container */
+static int value_start(JXCODE_p x, char c) {
+    if (x->state == X_FIRST)
+        buf_break(&x->out, x->depth);
+    switch (c) {
+        case '{':
+        case '[':
+            return push(x, c);
+        case '\"':
+            buf_putc(&x->out, c);
+            x->state = X_STRING;
+            x->is_key = 0;
+            return 1;
+        case 't':
+            x->literal = "true";
+            break;
+        case 'f':
+            x->literal = "false";
+            break;
+        case 'n':
+            x->literal = "null";
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                buf_putc(&x->out, c);
+                x->number = c == '-' ? N_SIGN : c == '0' ? N_ZERO : N_INT;
+                x->state = X_NUMBER;
+                return 1;
+            }
+            return 0;
+    }
+    buf_putc(&x->out, c);
+    x->state = X_LITERAL;
+    x->matched = 1;  // c itself
+    return 1;
+}
+
+/* Consume the chunk, returns 0 at the first byte breaking the grammar */
+static int xcode_run(JXCODE_p x, const char *s, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        char c = s[i];
+        switch (x->state) {
+            case X_STRING: {
+                size_t start = i;
+                int escape = x->escape;
+                for (; i < len; i++) {
+                    if (escape)
+                        escape = 0;
+                    else if (s[i] == '\\')
+                        escape = 1;
+                    else if (s[i] == '\"')
+                        break;
+                }
+                x->escape = escape;
+                if (i == len) {
+                    buf_put(&x->out, s + start, i - start);
+                    return 1;
+                }
+                buf_put(&x->out, s + start, i + 1 - start);  // with the quote
+                if (x->is_key)
+                    x->state = X_COLON;
+                else
+                    value_done(x);
+                i++;
+                continue;
+            }
+            case X_NUMBER: {
+                size_t start = i;
+                int state = x->number, next = 0;
+                for (; i < len && (next = number_step(state, s[i])) >= 0; i++)
+                    state = next;
+                buf_put(&x->out, s + start, i - start);
+                x->number = state;
+                if (i == len)
+                    return 1;
+                if (!number_complete(state) || (!x->depth && !is_space(s[i])))
+                    return 0;  // a document may not run on into the next
+                value_done(x);
+                continue;  // s[i] belongs to the next state
+            }
+            case X_LITERAL:
+                if (c != x->literal[x->matched])
+                    return 0;
+                buf_putc(&x->out, c);
+                i++;
+                if (!x->literal[++x->matched])
+                    value_done(x);
+                continue;
+            default:
+                break;
+        }
+
+        if (is_space(c)) {
+            i++;
+            continue;
+        }
+        switch (x->state) {
+            case X_DONE:  // one document per line
+                buf_putc(&x->out, '\n');
+                /* fall through */
+            case X_VALUE:
+                x->state = X_VALUE;
+                if (!value_start(x, c))
+                    return 0;
+                break;
+            case X_FIRST:
+                if (c == ']') {
+                    if (!close_container(x, c, 1))
+                        return 0;
+                    break;
+                }
+                if (!value_start(x, c))
+                    return 0;
+                break;
+            case X_KEY_FIRST:
+                if (c == '}') {
+                    if (!close_container(x, c, 1))
+                        return 0;
+                    break;
+                }
+                /* fall through */
+            case X_KEY:
+                if (c != '\"')
+                    return 0;
+                buf_break(&x->out, x->depth);
+                buf_putc(&x->out, c);
+                x->state = X_STRING;
+                x->is_key = 1;
+                break;
+            case X_COLON:
+                if (c != ':')
+                    return 0;
+                buf_put(&x->out, ": ", x->out.indent == JSON_MINIFY ? 1 : 2);
+                x->state = X_VALUE;
+                break;
+            case X_NEXT:
+                if (c == ',') {
+                    buf_putc(&x->out, c);
+                    if (x->stack[x->depth - 1] == '{') {
+                        x->state = X_KEY;
+                    } else {
+                        buf_break(&x->out, x->depth);
+                        x->state = X_VALUE;
+                    }
+                } else if (!close_container(x, c, 0)) {
+                    return 0;
+                }
+                break;
+            default:  // X_ERROR
+                return 0;
+        }
+        i++;
+    }
+    return 1;
+}
+
+JXCODE_p json_transcoder_create(int indent, JWRITE_f write, void *ctx) {
+    JXCODE_p x = NULL;
+    if (indent < JSON_TABS || !(x = (JXCODE_p)emalloc(sizeof(JXCODE_t))))
+        return NULL;
+    memset(x, 0, sizeof(JXCODE_t));
+    JBUF_t out = {x->stage, 0, sizeof(x->stage), 0, write, ctx, 0, 1, indent};
+    x->out = out;
+    x->state = X_VALUE;
+    return x;
+}
+
+int json_transcoder_feed(JXCODE_p x, const char *chunk, size_t len) {
+    if (!x || x->state == X_ERROR)
+        return 0;
+    if (!xcode_run(x, chunk, len) || x->out.failed) {
+        x->state = X_ERROR;
+        return 0;
+    }
+    return 1;
+}
+
+int json_transcoder_finish(JXCODE_p x) {
+    if (!x)
+        return 0;
+    if (x->state == X_NUMBER && !x->depth && number_complete(x->number))
+        x->state = X_DONE;  // a number at the very end of the text
+    int ok = x->state == X_DONE && buf_drain(&x->out);
+    x->out.len = 0;
+    x->out.failed = 0;
+    x->state = X_VALUE;
+    x->depth = 0;
+    x->escape = 0;
+    return ok;
+}
+
+void json_transcoder_free(JXCODE_p x) {
+    if (!x) return;
+    safe_free(x->stack);
+    safe_free(x);
+}
+
+int json_transcode(const char *text, size_t len, int indent, JWRITE_f write, void *ctx) {
+    JXCODE_p x = json_transcoder_create(indent, write, ctx);
+    int ok = json_transcoder_feed(x, text, len);
+    ok = json_transcoder_finish(x) && ok;
+    json_transcoder_free(x);
+    return ok;
+}
+
+static int xcode_file(void *ctx, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)ctx) == len;
+}
+
+int json_transcode_file(FILE *in, FILE *out, int indent) {
+    char *chunk = (char *)emalloc(XCODE_READ);
+    JXCODE_p x = json_transcoder_create(indent, xcode_file, out);
+    int ok = chunk && x;
+    size_t n = 0;
+    while (ok && (n = fread(chunk, 1, XCODE_READ, in)) > 0)
+        ok = json_transcoder_feed(x, chunk, n);
+    ok = json_transcoder_finish(x) && ok && !ferror(in);
+    json_transcoder_free(x);
+    safe_free(chunk);
+    return ok;
+}
@@ -0,0 +1,62 @@
+/*************************************************************************
+	> File Name: test/check.h
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Assertions for the test programs: a failed CHECK prints
+	               its message and is counted, the program goes on and
+	               exits non zero through CHECK_DONE. Also the helpers
+	               the tests share.
+ ************************************************************************/
+
+#ifndef _TEST_CHECK_H
+#define _TEST_CHECK_H
+
+#include "cjson.h"
+
+static int failures;
+
+#define CHECK(cond, ...)                    \
+    do {                                    \
+        if (!(cond)) {                      \
+            printf("  FAIL: " __VA_ARGS__); \
+            printf("\n");                   \
+            failures++;                     \
+        }                                   \
+    } while (0)
+
+#define CHECK_DONE(name)                                        \
+    do {                                                        \
+        printf("%s: %s\n", name, failures ? "FAILED" : "ok");   \
+        return failures != 0;                                   \
+    } while (0)
+
+/* Whether two trees format to the same text */
+static inline int same_tree(JNODE_p a, JNODE_p b) {
+    char *x = a ? json_format(a) : NULL, *y = b ? json_format(b) : NULL;
+    int same = x && y && !strcmp(x, y);
+    json_free(x);
+    json_free(y);
+    return same;
+}
+
+/* {"version": 3, "records": [...], "tail": -0.0} with one record per
+   line, each holding escapes, a surrogate pair, an exponent, a 64-bit
+   integer, literals, empty containers, names on both sides of the 7
+   byte inline limit and a nested object. Freed with free. */
+static inline char *corpus(int records) {
+    size_t cap = (size_t)records * 400 + 64, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "{\"version\": 3, \"records\": [");
+    for (int i = 0; i < records; i++)
+        n += snprintf(text + n, cap - n,
+                      "%s\n  {\"id\": %d, \"name\": \"user \\\"%d\\\"\\n\", \"s\": \"\\u00e9\\ud83d\\ude00\","
+                      " \"a long member name\": \"a string past seven bytes\", \"x\": %d.%03de%d,"
+                      " \"big\": %lld, \"ok\": %s, \"nil\": null, \"e\": [], \"o\": {},"
+                      " \"tags\": [\"a\", \"\", -%d], \"geo\": {\"lat\": %d.5, \"lon\": -%d.25}}",
+                      i ? "," : "", i, i, i, i % 1000, i % 40 - 20, 9000000000000000000LL + i,
+                      i % 2 ? "true" : "false", i * 7919, i % 90, i % 180);
+    snprintf(text + n, cap - n, "\n], \"tail\": -0.0}");
+    return text;
+}
+
+#endif
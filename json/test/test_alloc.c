@@ -0,0 +1,301 @@
+/*************************************************************************
+	> File Name: test/test_alloc.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Running out of memory: with hooks that refuse the Nth
+	               allocation, for N from 0 until the call succeeds, every
+	               entry point fails cleanly (JSON_ERR_NOMEM from the
+	               parsers, NULL or 0 from the rest), gives back all it
+	               took, and json_mem_stats counts what the hooks saw.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "check.h"
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;  // the parallel parsers call from workers
+static long budget = -1;  // allocations still granted, -1 for no limit
+static long live, allocs, frees, refused;
+
+static int grant(void) {
+    pthread_mutex_lock(&lock);
+    int ok = budget != 0;
+    if (budget > 0)
+        budget--;
+    refused += !ok;
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+static void *hook_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    void *ptr = grant() ? malloc(size) : NULL;
+    pthread_mutex_lock(&lock);
+    live += ptr != NULL;
+    allocs += ptr != NULL;
+    pthread_mutex_unlock(&lock);
+    return ptr;
+}
+
+static void *hook_realloc(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    void *grown = grant() ? realloc(ptr, size) : NULL;
+    pthread_mutex_lock(&lock);
+    live += grown && !ptr;
+    allocs += grown != NULL;
+    pthread_mutex_unlock(&lock);
+    return grown;
+}
+
+static void hook_free(void *ctx, void *ptr) {
+    (void)ctx;
+    if (!ptr)
+        return;
+    pthread_mutex_lock(&lock);
+    live--;
+    frees++;
+    pthread_mutex_unlock(&lock);
+    free(ptr);
+}
+
+static char *small, *large, *lines;
+static JNODE_p tree;
+
+/* 1 when a parser call worked, 0 when it ran out of memory and said so */
+static int parsed(JNODE_p root, const JERROR_t *err, const char *what) {
+    CHECK(root || err->code == JSON_ERR_NOMEM, "%s: error %d instead of running out", what, err->code);
+    return root != NULL;
+}
+
+static int sink(void *ctx, const char *data, size_t len) {
+    (void)ctx;
+    (void)data;
+    (void)len;
+    return 1;
+}
+
+static int each(void *ctx, size_t idx, JNODE_p root) {
+    (void)ctx;
+    (void)idx;
+    return root != NULL;
+}
+
+static int take_tree(void *ctx, const char *name, size_t len) {
+    (void)ctx;
+    (void)name;
+    (void)len;
+    return SAX_TREE;
+}
+
+static int drop_tree(void *ctx, JNODE_p node) {
+    (void)ctx;
+    json_delete(node);
+    return SAX_GO;
+}
+
+static int op_parse(void) {
+    JERROR_t err;
+    JNODE_p root = json_parse_r(small, NULL, &err);
+    json_delete(root);
+    return parsed(root, &err, "parse");
+}
+
+static int op_arena(void) {
+    JERROR_t err;
+    JARENA_p arena = json_arena_create(0);
+    if (!arena)
+        return 0;
+    json_arena_intern(arena, NULL);
+    JNODE_p root = json_parse_r(small, arena, &err);
+    json_arena_destroy(arena);
+    return parsed(root, &err, "arena");
+}
+
+static int op_index(void) {
+    JERROR_t err;
+    json_engine_select(JSON_ENGINE_INDEX);
+    JNODE_p root = json_parse_r(large, NULL, &err);
+    json_engine_select(JSON_ENGINE_DESCENT);
+    json_delete(root);
+    return parsed(root, &err, "index engine");
+}
+
+static int op_parallel(void) {
+    JERROR_t err;
+    JARENA_p arena = json_arena_create(0);
+    if (!arena)
+        return 0;
+    JNODE_p heap = json_parse_parallel(large, "/records", NULL, 4, &err);
+    int ok = parsed(heap, &err, "parallel");
+    json_delete(heap);
+    ok = ok && parsed(json_parse_parallel(large, "/records", arena, 4, &err), &err, "parallel, arena");
+    json_arena_destroy(arena);
+    return ok;
+}
+
+static int op_push(void) {
+    JPARSER_p p = json_parser_create(NULL);
+    size_t len = strlen(small);
+    int ok = p != NULL;
+    for (size_t at = 0; ok && at < len; at += 7)
+        ok = json_parser_feed(p, small + at, len - at < 7 ? len - at : 7);
+    JNODE_p root = json_parser_finish(p);
+    json_delete(root);
+    json_parser_free(p);
+    return ok && root;
+}
+
+static int op_sax(void) {
+    JSAX_t sax;
+    memset(&sax, 0, sizeof(sax));
+    sax.key = take_tree;
+    sax.tree = drop_tree;
+    return json_sax_parse(small, &sax, NULL) == 1;
+}
+
+static int op_ndjson(void) {
+    JBATCH_p batch = json_ndjson_parse(lines, strlen(lines), 4);
+    int ok = batch && json_batch_size(batch) == 2000;
+    json_batch_free(batch);
+    return ok && json_ndjson_each(lines, strlen(lines), 4, each, NULL) == 1;
+}
+
+static int op_format(void) {
+    char *text = json_format(tree), *styled = json_format_style(tree, 2);
+    int ok = text && styled;
+    json_free(text);
+    json_free(styled);
+    return ok;
+}
+
+static int op_transcode(void) {
+    return json_transcode(small, strlen(small), 2, sink, NULL);
+}
+
+static int op_msgpack(void) {
+    JERROR_t err;
+    size_t len = 0;
+    char *packed = json_msgpack(tree, &len);
+    if (!packed)
+        return 0;
+    JNODE_p root = json_msgpack_parse(packed, len, NULL, &err);
+    json_free(packed);
+    json_delete(root);
+    return parsed(root, &err, "msgpack");
+}
+
+static int op_tape(void) {
+    JERROR_t err;
+    JTAPE_p parsed_tape = json_tape_parse(small, &err);
+    int ok = parsed_tape != NULL;
+    CHECK(ok || err.code == JSON_ERR_NOMEM, "tape: error %d instead of running out", err.code);
+    json_tape_free(parsed_tape);
+    JTAPE_p tape = ok ? json_tape_from_tree(tree) : NULL;
+    JNODE_p root = tape ? json_tape_to_tree(tape, 0, NULL) : NULL;
+    json_tape_free(tape);
+    json_delete(root);
+    return root != NULL;
+}
+
+static int op_build(void) {
+    static const int ints[] = {1, 2, 3};
+    JNODE_p obj = create_object(), list = NULL;
+    int ok = obj && json_add_string(obj, "a name past the inline size", "and a value past it too")
+             && json_add_int(obj, "i", 3) && json_add_int64(obj, "a large one", 1LL << 40);
+    if (ok && !json_add_to_array(obj, list = json_int_array(ints, 3)))
+        json_delete(list), ok = 0;
+    if (ok && !json_object_replace(obj, "i", list = create_string("replaced by a long string")))
+        json_delete(list), ok = 0;
+    json_delete(obj);
+    return ok && json_pointer(tree, "/records/3/name");
+}
+
+typedef struct Op {
+    const char *name;
+    int (*run)(void);
+    long step;  // budgets tried grow by about 1 / step of themselves
+} OP_t;
+
+static const OP_t ops[] = {
+    {"parse", op_parse, 16},        {"arena", op_arena, 16},        {"index engine", op_index, 4},
+    {"parallel", op_parallel, 4},   {"push parser", op_push, 16},   {"sax", op_sax, 16},
+    {"ndjson", op_ndjson, 4},       {"format", op_format, 16},      {"transcode", op_transcode, 16},
+    {"msgpack", op_msgpack, 16},    {"tape", op_tape, 16},          {"builders", op_build, 16},
+};
+
+/* Each call with every budget until it succeeds */
+static void starve(const OP_t *op) {
+    JMEMSTATS_t stats;
+    long tries = 0;
+    int ok = 0;
+    for (long n = 0; !ok && tries < 100000; n += n / op->step + 1, tries++) {
+        long before = live;
+        allocs = frees = refused = 0;
+        json_mem_stats(NULL, 1);
+        budget = n;
+        ok = op->run();
+        budget = -1;
+        json_mem_stats(&stats, 1);
+        CHECK(live == before, "%s, failing at %ld: %ld blocks kept", op->name, n, live - before);
+        CHECK(stats.allocs == (size_t)allocs && stats.frees == (size_t)frees && stats.failed == (size_t)refused,
+              "%s, failing at %ld: counted %zu, %zu, %zu for %ld, %ld, %ld", op->name, n, stats.allocs, stats.frees,
+              stats.failed, allocs, frees, refused);
+        if (live != before)
+            break;
+    }
+    CHECK(ok, "%s: never succeeded", op->name);
+}
+
+/* An arena on hooks of its own, the global ones untouched */
+static void arena_budget(void) {
+    int ok = 0;
+    for (long n = 0; !ok && n < 100000; n++) {
+        budget = n;
+        JARENA_p arena = json_arena_create_with(0, hook_alloc, hook_free, NULL);
+        JERROR_t err;
+        JNODE_p root = arena ? json_parse_r(large, arena, &err) : NULL;
+        ok = arena && parsed(root, &err, "arena with hooks");
+        json_arena_destroy(arena);
+        budget = -1;
+        CHECK(!live, "arena with hooks, failing at %ld: %ld blocks kept", n, live);
+        if (live)
+            break;
+    }
+    CHECK(ok, "arena with hooks: never succeeded");
+}
+
+static char *records(int count) {
+    size_t cap = (size_t)count * 160 + 64, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "{\"v\": 1, \"records\": [");
+    for (int i = 0; i < count; i++)
+        n += snprintf(text + n, cap - n, "%s{\"id\": %d, \"name\": \"a fairly long user name %d\","
+                      " \"s\": \"x\\n\\u00e9\", \"d\": %d.25, \"big\": 12345678901234, \"t\": [true, false, null]}",
+                      i ? ", " : "", i, i, i);
+    snprintf(text + n, cap - n, "]}");
+    return text;
+}
+
+int main(void) {
+    small = records(40);
+    large = records(3000);  // past the sizes the index and the split start at
+    lines = (char *)malloc(2000 * 80);
+    for (int i = 0, n = 0; i < 2000; i++)
+        n += snprintf(lines + n, 80, "{\"id\": %d, \"name\": \"some long name value %d\", \"x\": [1, 2, 3]}\n", i, i);
+
+    json_set_allocator(hook_alloc, hook_realloc, hook_free, NULL);
+    tree = json_parse(small);
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+        starve(&ops[i]);
+    json_delete(tree);
+    CHECK(!live, "%ld blocks kept", live);
+    json_set_allocator(NULL, NULL, NULL, NULL);
+
+    arena_budget();
+    free(small);
+    free(large);
+    free(lines);
+    CHECK_DONE("test_alloc");
+}
@@ -0,0 +1,110 @@
+/*************************************************************************
+	> File Name: test/test_arena.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Arena documents edited like heap ones: heap nodes added,
+	               replaced and detached under arena containers are owned
+	               as documented (the leak checker sees the rest), a
+	               replacement the arena cannot record fails cleanly, and
+	               reservations stay within their caps.
+ ************************************************************************/
+
+#include "check.h"
+
+typedef struct Budget {
+    int left;  // allocations still granted, -1 for no limit
+} BUDGET_t;
+
+static void *budget_alloc(void *ctx, size_t size) {
+    BUDGET_t *b = (BUDGET_t *)ctx;
+    if (!b->left)
+        return NULL;
+    if (b->left > 0)
+        b->left--;
+    return malloc(size);
+}
+
+static void budget_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+/* Heap nodes linked under arena containers go with the arena */
+static void mutate(void) {
+    JARENA_p arena = json_arena_create(0);
+    const char *text = "{\"first\": 1, \"list\": [1, 2, 3], \"obj\": {\"k\": \"v\"}, \"last\": null}";
+    JNODE_p root = json_parse_arena(text, arena);
+    CHECK(root, "not parsed");
+    if (!root)
+        return;
+    JNODE_p list = json_object_get(root, "list");
+    CHECK(json_add_to_array(list, create_string("a heap string past the inline size")), "add to array");
+    CHECK(json_add_int(json_object_get(root, "obj"), "added", 7), "add to object");
+    CHECK(json_replace_array(list, 0, create_int(10), 0), "replace in array");
+    CHECK(json_replace_object(root, "last", create_string("replaced with a long heap string")), "replace member");
+    CHECK(json_object_replace(root, "obj", create_true()), "object replace");
+
+    JNODE_p first = json_detach_from_object(root, "first");  // the first member, an arena node
+    CHECK(first && first->value.int_val == 1 && root->child && !strcmp(root->child->name, "list"),
+          "detach first member");
+    json_delete(first);  // a no-op for arena nodes
+    JNODE_p heap = json_detach_from_array(list, 3, 0);  // a heap node, the caller's again
+    CHECK(heap && !strcmp(heap->value.string_val, "a heap string past the inline size"), "detach heap node");
+    json_delete(heap);
+
+    char *out = json_format_style(root, JSON_MINIFY);
+    CHECK(out && !strcmp(out, "{\"list\":[10,2,3],\"obj\":true,\"last\":\"replaced with a long heap string\"}"),
+          "edited: %s", out);
+    json_free(out);
+    size_t nodes = 0;
+    json_arena_stats(arena, &nodes, NULL, NULL);
+    CHECK(nodes == 9, "%zu arena nodes", nodes);  // as parsed, nothing added there
+    json_arena_destroy(arena);  // frees the heap nodes still linked in
+}
+
+/* An arena out of memory cannot record a heap child: linking fails and
+   the node stays the caller's */
+static void adopt_fails(void) {
+    BUDGET_t budget = {-1};
+    JARENA_p arena = json_arena_create_with(0, budget_alloc, budget_free, &budget);
+    JNODE_p root = json_parse_arena("{\"a\": [1], \"b\": 2}", arena);
+    CHECK(root, "not parsed");
+    if (!root)
+        return;
+    budget.left = 0;
+    JNODE_p node = create_string("a string the arena will not own");
+    JNODE_p a = json_object_get(root, "a");
+    CHECK(!json_add_to_array(a, node), "added without memory");
+    CHECK(!json_replace_array(a, 0, node, 0), "replaced in array without memory");
+    CHECK(!json_replace_object(root, "b", node), "replaced member without memory");
+    CHECK(!json_object_replace(root, "b", node), "object replaced without memory");
+    char *text = json_format_style(root, JSON_MINIFY);
+    CHECK(text && !strcmp(text, "{\"a\":[1],\"b\":2}"), "changed: %s", text);
+    json_free(text);
+    json_delete(node);
+    json_arena_destroy(arena);
+}
+
+/* Hints far beyond any text reserve at most one group and one block */
+static void reserve(void) {
+    size_t reserved = 0;
+    JARENA_p arena = json_arena_create((size_t)1 << 40);
+    json_arena_stats(arena, NULL, NULL, &reserved);
+    CHECK(reserved && reserved <= ((size_t)16 << 20), "1TB hint reserved %zu bytes", reserved);
+    json_arena_reserve(arena, (size_t)1 << 36, (size_t)1 << 40);
+    json_arena_stats(arena, NULL, NULL, &reserved);
+    CHECK(reserved <= ((size_t)32 << 20), "reserve took %zu bytes", reserved);
+    char *text = corpus(500);
+    JNODE_p root = json_parse_arena(text, arena), want = json_parse(text);
+    CHECK(same_tree(root, want), "parsed into a reserved arena");
+    json_delete(want);
+    free(text);
+    json_arena_destroy(arena);
+}
+
+int main(void) {
+    mutate();
+    adopt_fails();
+    reserve();
+    CHECK_DONE("test_arena");
+}
@@ -0,0 +1,107 @@
+/*************************************************************************
+	> File Name: test/test_array.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Arrays against a shadow vector through random appends,
+	               positional gets, replacements and detaches: size, tail,
+	               both link directions and the index view must agree.
+ ************************************************************************/
+
+#include "check.h"
+
+#define ELEMENTS 3000
+#define STEPS 20000
+
+static int shadow[ELEMENTS];
+static int count, next_id;
+static unsigned seed = 11;
+
+static unsigned rnd(void) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+/* Links, tail and size as the shadow has them */
+static void check_links(JNODE_p array, const char *what) {
+    JNODE_p c = array->child, prev = NULL;
+    int i = 0;
+    for (; c && i < count; prev = c, c = c->next, i++)
+        if (c->value.int_val != shadow[i] || c->prev != prev)
+            break;
+    CHECK(i == count && !c, "%s: list differs at %d", what, i);
+    CHECK(array->value.list.tail == prev, "%s: tail", what);
+    CHECK(json_array_size(array) == (size_t)count, "%s: size %zu, want %d", what, json_array_size(array), count);
+}
+
+static void run(JNODE_p array, const char *what) {
+    count = next_id = 0;
+    for (; count < ELEMENTS / 2; count++, next_id++) {  // well past the size that gets a view
+        CHECK(json_add_to_array(array, create_int(next_id)), "%s: append", what);
+        shadow[count] = next_id;
+    }
+    for (int step = 0; step < STEPS; step++) {
+        int at = count ? (int)(rnd() % count) : 0;
+        switch (rnd() % 8) {
+            case 0:
+            case 1:
+                if (count < ELEMENTS) {
+                    CHECK(json_add_to_array(array, create_int(next_id)), "%s: append", what);
+                    shadow[count++] = next_id++;
+                }
+                break;
+            case 2:
+                if (count) {
+                    JNODE_p node = create_int(next_id);
+                    CHECK(json_replace_array(array, at, node, 0), "%s: replace at %d", what, at);
+                    shadow[at] = next_id++;
+                }
+                break;
+            case 3:
+                if (count) {
+                    JNODE_p c = json_detach_from_array(array, at, 0);
+                    CHECK(c && c->value.int_val == shadow[at] && !c->next && !c->prev, "%s: detach at %d", what,
+                          at);
+                    json_delete(c);
+                    memmove(shadow + at, shadow + at + 1, (count - at - 1) * sizeof(int));
+                    count--;
+                }
+                break;
+            case 4:
+                if (count) {
+                    json_del_from_array(array, at);
+                    memmove(shadow + at, shadow + at + 1, (count - at - 1) * sizeof(int));
+                    count--;
+                }
+                break;
+            default: {
+                JNODE_p c = json_array_get(array, at);
+                CHECK(count ? c && c->value.int_val == shadow[at] : !c, "%s: get %d", what, at);
+                break;
+            }
+        }
+        if (step % 1000 == 0)
+            check_links(array, what);
+    }
+    check_links(array, what);
+    CHECK(!json_array_get(array, count) && !json_array_get(array, (size_t)-1), "%s: get out of range", what);
+}
+
+int main(void) {
+    JNODE_p array = create_array();
+    run(array, "heap");
+    json_delete(array);
+    JARENA_p arena = json_arena_create(0);
+    array = json_parse_arena("[]", arena);
+    run(array, "arena");
+    json_arena_destroy(arena);
+
+    int ints[100];  // builders append in order
+    for (int i = 0; i < 100; i++)
+        ints[i] = i * i;
+    array = json_int_array(ints, 100);
+    CHECK(json_array_size(array) == 100 && json_array_get(array, 99)->value.int_val == 99 * 99 &&
+              array->value.list.tail == json_array_get(array, 99),
+          "json_int_array");
+    json_delete(array);
+    CHECK_DONE("test_array");
+}
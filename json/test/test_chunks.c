@@ -0,0 +1,119 @@
+/*************************************************************************
+	> File Name: test/test_chunks.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: The push parser against json_parse: every document fed
+	               in chunks of every size from one byte to its length,
+	               into the heap and into an arena, must give the same
+	               tree, and malformed text must fail at every split
+	               without keeping anything in the arena.
+ ************************************************************************/
+
+#include "check.h"
+
+static const char *const good[] = {
+    "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"e\"}}",
+    "[1,-2,3.25,-0.5e-3,1E+10,9223372036854775807,-9223372036854775808,4294967296]",
+    "\"esc \\\" \\\\ \\/ \\b \\f \\n \\r \\t \\u00e9 \\u4e2d \\ud83d\\ude00\"",
+    "{\"short\":\"abc\",\"a name longer than seven bytes\":\"and a value as long\"}",
+    "  [ [ ], { }, [ [ [ 1 ] ] ], { \"k\" : { \"k\" : [ ] } } ]  ",
+    "{\"\":\"\",\"x\":\"\"}",
+    "-12.5e-7",
+    "0",
+    "true",
+    "null",
+};
+
+static const char *const bad[] = {
+    "{\"a\":1,}", "[1 2]", "[01]", "{\"a\" 1}", "tru", "[1.]", "{\"a\":[}", "\"open", "[1,2]x", "[-]",
+};
+
+/* The text fed in chunks of size, NULL on failure */
+static JNODE_p feed(const char *text, size_t size, JARENA_p arena) {
+    JPARSER_p p = json_parser_create(arena);
+    size_t len = strlen(text);
+    int ok = 1;
+    for (size_t at = 0; ok && at < len; at += size)
+        ok = json_parser_feed(p, text + at, len - at < size ? len - at : size);
+    JNODE_p root = json_parser_finish(p);
+    json_parser_free(p);
+    return ok ? root : NULL;
+}
+
+/* The same tree in the heap and in an arena */
+static void same_fed(const char *text, size_t size, JNODE_p want, const char *what) {
+    for (int in_arena = 0; in_arena < 2; in_arena++) {
+        JARENA_p arena = in_arena ? json_arena_create(0) : NULL;
+        JNODE_p root = feed(text, size, arena);
+        CHECK(same_tree(root, want), "%s, chunks of %zu%s", what, size, in_arena ? ", arena" : "");
+        if (arena)
+            json_arena_destroy(arena);
+        else
+            json_delete(root);
+    }
+}
+
+/* Failed and abandoned documents leave the arena as they found it, and
+   the documents around them are kept */
+static void arena_kept(void) {
+    static const char *const incomplete = "[\"a string past the inline limit\", {\"key\": ";
+    JARENA_p arena = json_arena_create(0);
+    JPARSER_p p = json_parser_create(arena);
+    size_t nodes, used, reserved, n, u, r;
+    json_parser_feed(p, good[0], strlen(good[0]));
+    JNODE_p first = json_parser_finish(p);
+    json_arena_stats(arena, &nodes, &used, &reserved);
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        json_parser_feed(p, bad[i], strlen(bad[i]));
+        CHECK(!json_parser_finish(p), "bad %zu accepted", i);
+    }
+    for (int i = 0; i < 2000; i++) {  // enough to take slabs past the first
+        json_parser_feed(p, incomplete, strlen(incomplete));
+        json_parser_finish(p);
+    }
+    json_arena_stats(arena, &n, &u, &r);
+    CHECK(n == nodes && u == used && r == reserved, "failures kept %zu nodes and %zu bytes", n - nodes, u - used);
+
+    json_parser_feed(p, good[3], strlen(good[3]));
+    JNODE_p second = json_parser_finish(p);
+    json_arena_stats(arena, &nodes, &used, &reserved);
+    json_parser_feed(p, incomplete, strlen(incomplete));
+    json_parser_free(p);  // abandoned
+    json_arena_stats(arena, &n, &u, &r);
+    CHECK(n == nodes && u == used && r == reserved, "abandoned document kept %zu nodes", n - nodes);
+
+    JNODE_p want = json_parse(good[0]);
+    CHECK(same_tree(first, want), "first document lost");
+    json_delete(want);
+    want = json_parse(good[3]);
+    CHECK(same_tree(second, want), "second document lost");
+    json_delete(want);
+    json_arena_destroy(arena);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+        JNODE_p want = json_parse(good[i]);
+        char what[32];
+        snprintf(what, sizeof(what), "good %zu", i);
+        for (size_t size = 1; size <= strlen(good[i]); size++)
+            same_fed(good[i], size, want, what);
+        json_delete(want);
+    }
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        for (size_t size = 1; size <= strlen(bad[i]); size++) {
+            JNODE_p root = feed(bad[i], size, NULL);
+            CHECK(!root, "bad %zu accepted in chunks of %zu", i, size);
+            json_delete(root);
+        }
+    }
+    arena_kept();
+    static const size_t sizes[] = {1, 7, 100, 4096, 65536};
+    char *text = corpus(200);
+    JNODE_p want = json_parse(text);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+        same_fed(text, sizes[s], want, "corpus");
+    json_delete(want);
+    free(text);
+    CHECK_DONE("test_chunks");
+}
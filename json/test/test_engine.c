@@ -0,0 +1,78 @@
+/*************************************************************************
+	> File Name: test/test_engine.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: The structural index engine against recursive descent:
+	               same trees for valid text and same errors for broken
+	               text, at every SIMD level.
+ ************************************************************************/
+
+#include "check.h"
+
+#define RECORDS 2000  // well past the 64KB the index starts at
+
+static JNODE_p parse_with(int engine, const char *text, JARENA_p arena, JERROR_t *err) {
+    json_engine_select(engine);
+    return json_parse_r(text, arena, err);
+}
+
+static void compare(const char *text, const char *what, int valid) {
+    JERROR_t e1, e2;
+    JNODE_p a = parse_with(JSON_ENGINE_DESCENT, text, NULL, &e1);
+    JNODE_p b = parse_with(JSON_ENGINE_INDEX, text, NULL, &e2);
+    CHECK((a != NULL) == valid, "%s: %s", what, valid ? "rejected" : "accepted");
+    if (a || b)
+        CHECK(same_tree(a, b), "%s: trees differ", what);
+    CHECK(e1.code == e2.code && e1.offset == e2.offset && e1.line == e2.line && e1.column == e2.column,
+          "%s: errors differ, %d at %zu against %d at %zu", what, e1.code, e1.offset, e2.code, e2.offset);
+    json_delete(a);
+    json_delete(b);
+
+    JARENA_p arena = json_arena_create(0);  // the same in an arena
+    b = parse_with(JSON_ENGINE_INDEX, text, arena, &e2);
+    CHECK((b != NULL) == valid && e1.code == e2.code && e1.offset == e2.offset, "%s: arena differs", what);
+    json_arena_destroy(arena);
+}
+
+/* Breakages placed well inside the text, where only the index has been */
+static void broken(const char *text) {
+    static const char *const cuts[][2] = {
+        {"\"ok\": true", "\"ok\": tru"}, {"\"nil\": null", "\"nil\" null"}, {"\"e\": []", "\"e\": [,]"},
+        {"\"o\": {}", "\"o\": {1}"}, {"\"big\": ", "\"big\": +"}, {"}}", "}]"},
+    };
+    size_t len = strlen(text);
+    for (size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); c++) {
+        const char *at = strstr(text + len / 2, cuts[c][0]);
+        CHECK(at, "%s: not in the corpus", cuts[c][0]);
+        if (!at)
+            continue;
+        size_t head = at - text, from = strlen(cuts[c][0]), to = strlen(cuts[c][1]);
+        char *bad = (char *)malloc(len + to + 1);
+        memcpy(bad, text, head);
+        memcpy(bad + head, cuts[c][1], to);
+        strcpy(bad + head + to, at + from);
+        compare(bad, cuts[c][1], 0);
+        free(bad);
+    }
+    char *cut = (char *)malloc(len + 1);  // ends inside a value
+    memcpy(cut, text, len * 2 / 3);
+    cut[len * 2 / 3] = 0;
+    compare(cut, "truncated", 0);
+    free(cut);
+}
+
+int main(void) {
+    char *text = corpus(RECORDS);
+    int level = json_simd_level();
+    const int levels[] = {SIMD_SCALAR, SIMD_SSE2, SIMD_AVX2};
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        if (json_simd_select(levels[l]) != levels[l])
+            continue;  // not on this machine
+        compare(text, "valid", 1);
+        broken(text);
+    }
+    json_simd_select(level);
+    json_engine_select(JSON_ENGINE_DESCENT);
+    free(text);
+    CHECK_DONE("test_engine");
+}
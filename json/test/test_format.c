@@ -0,0 +1,32 @@
+/*************************************************************************
+	> File Name: test/test_format.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: json_format_into at every capacity: the text when it
+	               fits, else its prefix, and always the size needed.
+ ************************************************************************/
+
+#include "check.h"
+
+int main(void) {
+    char *text = corpus(3);
+    JNODE_p root = json_parse(text);
+    char *want = json_format(root);
+    size_t len = strlen(want), needed = 0;
+    char *buf = (char *)malloc(len + 2);
+    for (size_t cap = 0; cap <= len + 1; cap++) {
+        memset(buf, '#', len + 2);
+        int ok = json_format_into(root, buf, cap, &needed);
+        CHECK(needed == len + 1, "cap %zu: needed %zu of %zu", cap, needed, len + 1);
+        CHECK(ok == (cap == len + 1), "cap %zu: returned %d", cap, ok);
+        if (cap)
+            CHECK(!memcmp(buf, want, cap - 1) && !buf[cap - 1], "cap %zu: not the prefix", cap);
+        CHECK(buf[cap] == '#', "cap %zu: written past the end", cap);
+    }
+    CHECK(!json_format_into(NULL, buf, len, &needed) && needed == 0 && !buf[0], "NULL root formatted");
+    free(buf);
+    json_free(want);
+    json_delete(root);
+    free(text);
+    CHECK_DONE("test_format");
+}
@@ -0,0 +1,155 @@
+/*************************************************************************
+	> File Name: test/test_inline.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Strings and names of up to 7 bytes held in the node: on
+	               both sides of the limit, from the builders and from
+	               every parser that makes them, they read back right,
+	               sit where documented, and survive renames, replaces
+	               and deletes (the leak checker sees the frees).
+ ************************************************************************/
+
+#include "check.h"
+
+#define LONGEST 20
+#define INLINE 7  // bytes held in the node
+
+static int inside(const JNODE_t *node, const char *s) {
+    return s >= (const char *)node && s < (const char *)(node + 1);
+}
+
+/* Every member of obj is named and valued by the text of its length; 0
+   when one reads back wrong or, in_node, is not stored as documented */
+static int strings_ok(JNODE_p obj, int in_node, const char *what) {
+    int ok = 1;
+    size_t len = 0;
+    for (JNODE_p c = obj ? obj->child : NULL; c; c = c->next, len++) {
+        size_t n = strlen(c->name);
+        int right = n == len && strlen(c->value.string_val) == len && (!len || (c->name[0] == 'n' &&
+                    c->value.string_val[0] == 'v'));
+        if (right && in_node)
+            right = inside(c, c->name) == (len <= INLINE) && inside(c, c->value.string_val) == (len <= INLINE);
+        CHECK(right, "%s: length %zu, \"%s\": \"%s\"", what, len, c->name, c->value.string_val);
+        ok &= right;
+    }
+    CHECK(len == LONGEST + 1, "%s: %zu members", what, len);
+    return ok;
+}
+
+/* Names and values of every length from 0 to LONGEST */
+static JNODE_p build(void) {
+    JNODE_p obj = create_object();
+    char name[LONGEST + 1], value[LONGEST + 1];
+    for (int len = 0; len <= LONGEST; len++) {
+        memset(name, 'n', len);
+        memset(value, 'v', len);
+        name[len] = value[len] = 0;
+        json_add_string(obj, name, value);
+    }
+    return obj;
+}
+
+static int tree_cb(void *ctx, JNODE_p node) {
+    *(JNODE_p *)ctx = node;
+    return SAX_GO;
+}
+
+static int take_tree(void *ctx) {
+    (void)ctx;
+    return SAX_TREE;
+}
+
+static void parsers(void) {
+    JNODE_p built = build();
+    strings_ok(built, 1, "built");
+    char *text = json_format(built);
+
+    JNODE_p heap = json_parse(text);
+    strings_ok(heap, 1, "parsed");
+    json_delete(heap);
+    for (int engine = JSON_ENGINE_DESCENT; engine <= JSON_ENGINE_INDEX; engine++) {
+        json_engine_select(engine);
+        JARENA_p arena = json_arena_create(0);
+        strings_ok(json_parse_arena(text, arena), 1, engine ? "index engine, arena" : "arena");
+        json_arena_destroy(arena);
+        heap = json_parse_r(text, NULL, NULL);
+        strings_ok(heap, 1, engine ? "index engine" : "descent");
+        json_delete(heap);
+    }
+    json_engine_select(JSON_ENGINE_DESCENT);
+
+    char *copy = (char *)malloc(strlen(text) + 1);  // in situ strings stay in the buffer
+    strcpy(copy, text);
+    heap = json_parse_insitu(copy);
+    strings_ok(heap, 0, "in situ");
+    json_delete(heap);
+    free(copy);
+
+    for (size_t size = 1; size <= 16; size *= 4) {  // keys and values split across chunks
+        JPARSER_p p = json_parser_create(NULL);
+        for (size_t at = 0, len = strlen(text); at < len; at += size)
+            json_parser_feed(p, text + at, len - at < size ? len - at : size);
+        heap = json_parser_finish(p);
+        json_parser_free(p);
+        strings_ok(heap, 1, "push parser");
+        json_delete(heap);
+    }
+
+    JTAPE_p tape = json_tape_parse(text, NULL);
+    heap = json_tape_to_tree(tape, 0, NULL);
+    json_tape_free(tape);
+    strings_ok(heap, 1, "tape");
+    json_delete(heap);
+
+    JSAX_t sax;
+    memset(&sax, 0, sizeof(sax));
+    sax.start_object = take_tree;
+    sax.tree = tree_cb;
+    heap = NULL;
+    json_sax_parse(text, &sax, &heap);
+    strings_ok(heap, 1, "sax subtree");
+    json_delete(heap);
+
+    json_free(text);
+    json_delete(built);
+}
+
+/* Names and values changed in place, from either side of the limit to the other */
+static void edits(void) {
+    JNODE_p obj = build(), other = create_object();
+    JNODE_p node = json_detach_from_object(obj, "nnn");
+    CHECK(json_add_to_object(other, "a long name for it", node, 1), "short to long");
+    node = json_detach_from_object(obj, "nnnnnnnnnnnn");
+    CHECK(json_add_to_object(other, "s", node, 1), "long to short");
+    node = json_detach_from_object(obj, "nnnnnnn");
+    CHECK(json_add_to_object(other, node->name, node, 1), "its own short name");
+    node = json_detach_from_object(obj, "nnnnnnnn");
+    CHECK(json_add_to_object(other, node->name, node, 1), "its own long name");
+    node = json_detach_from_object(other, "s");
+    CHECK(json_add_to_object(other, "static", node, 0), "long to borrowed");
+    char *out = json_format_style(other, JSON_MINIFY);
+    CHECK(out && !strcmp(out, "{\"a long name for it\":\"vvv\",\"nnnnnnn\":\"vvvvvvv\",\"nnnnnnnn\":\"vvvvvvvv\","
+                         "\"static\":\"vvvvvvvvvvvv\"}"), "renamed: %s", out);
+    json_free(out);
+
+    /* Replacements take the old member's name, inline or not */
+    CHECK(json_object_replace(obj, "n", create_string("a replacing string")), "replace short name");
+    CHECK(json_object_replace(obj, "nnnnnnnnnnnnnnnnnnnn", create_string("r")), "replace long name");
+    node = create_string("x");
+    json_add_to_object(other, "a name that goes away", node, 1);
+    node = json_detach_from_object(other, "a name that goes away");
+    CHECK(json_replace_object(obj, "nn", node), "replace named node");
+    CHECK(json_replace_object(obj, "nnnnnnnnnnnnnnnnnnn", create_string("")), "replace with empty");
+    out = json_format_style(obj, JSON_MINIFY);
+    CHECK(out && strstr(out, "{\"\":\"\",\"n\":\"a replacing string\",\"nn\":\"x\",")
+              && strstr(out, "\"nnnnnnnnnnnnnnnnnnn\":\"\",\"nnnnnnnnnnnnnnnnnnnn\":\"r\"}"), "replaced: %s", out);
+    json_free(out);
+    json_delete(other);
+    json_delete(obj);
+}
+
+int main(void) {
+    parsers();
+    edits();
+    CHECK_DONE("test_inline");
+}
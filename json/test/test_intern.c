@@ -0,0 +1,163 @@
+/*************************************************************************
+	> File Name: test/test_intern.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Interned names: one pointer per distinct name, from any
+	               thread, and every parser that fills a pooled arena
+	               handing out those pointers, shared across documents
+	               and arenas, without the trees changing.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "check.h"
+
+#define NAMES 50000  // several blocks and table growths
+#define THREADS 4
+
+static char names[NAMES][24];
+
+typedef struct Interner {
+    JPOOL_p pool;
+    int first;               // names are interned from here on, wrapping
+    const char *got[NAMES];
+} INTERNER_t;
+
+static void *intern_all(void *arg) {
+    INTERNER_t *in = (INTERNER_t *)arg;
+    for (int i = 0; i < NAMES; i++) {
+        int at = (in->first + i) % NAMES;
+        in->got[at] = json_pool_intern(in->pool, names[at]);
+    }
+    return NULL;
+}
+
+static void pool_basics(void) {
+    JPOOL_p pool = json_pool_create();
+    size_t count = 0, bytes = 0, want_bytes = 0;
+    char copy[] = "a long member name";
+    const char *a = json_pool_intern(pool, "a long member name"), *b = json_pool_intern(pool, copy);
+    CHECK(a && a == b && a != copy && !strcmp(a, copy), "same name, one pointer");
+    CHECK(json_pool_intern(pool, "") && json_pool_intern(pool, "") == json_pool_intern(pool, ""), "empty name");
+    CHECK(json_pool_intern(pool, "id") != json_pool_intern(pool, "ID"), "names differing in case");
+
+    char *huge = (char *)malloc(100000);  // larger than a block
+    memset(huge, 'h', 99999);
+    huge[99999] = 0;
+    const char *h = json_pool_intern(pool, huge);
+    CHECK(h && !strcmp(h, huge) && json_pool_intern(pool, huge) == h, "name larger than a block");
+    free(huge);
+    json_pool_stats(pool, &count, &bytes);
+    CHECK(count == 5 && bytes == sizeof(copy) + 1 + 3 + 3 + 100000, "stats: %zu names, %zu bytes", count, bytes);
+    json_pool_free(pool);
+
+    /* The same names from several threads at once */
+    pool = json_pool_create();
+    static INTERNER_t in[THREADS];
+    pthread_t threads[THREADS];
+    for (int i = 0; i < NAMES; i++) {
+        snprintf(names[i], sizeof(names[i]), i % 3 ? "name %d" : "n%d", i);
+        want_bytes += strlen(names[i]) + 1;
+    }
+    for (int t = 0; t < THREADS; t++) {
+        in[t].pool = pool;
+        in[t].first = t * NAMES / THREADS;
+        pthread_create(&threads[t], NULL, intern_all, &in[t]);
+    }
+    int wrong = 0;
+    for (int t = 0; t < THREADS; t++)
+        pthread_join(threads[t], NULL);
+    for (int i = 0; i < NAMES; i++)
+        for (int t = 0; t < THREADS; t++)
+            wrong += !in[t].got[i] || in[t].got[i] != in[0].got[i] || strcmp(in[t].got[i], names[i]);
+    json_pool_stats(pool, &count, &bytes);
+    CHECK(!wrong && count == NAMES && bytes == want_bytes, "threads: %d wrong, %zu names", wrong, count);
+    json_pool_free(pool);
+}
+
+/* Named nodes under node whose name is not the pool's pointer for it */
+static int unpooled(JNODE_p node, JPOOL_p pool) {
+    int n = 0;
+    for (JNODE_p c = node ? node->child : NULL; c; c = c->next) {
+        if (c->name && c->name != json_pool_intern(pool, c->name))
+            n++;
+        n += unpooled(c, pool);
+    }
+    return n;
+}
+
+/* Every parser filling arenas that share one pool */
+static void parsers(void) {
+    JPOOL_p pool = json_pool_create();
+    JARENA_p arena[5];
+    JNODE_p root[5];
+    char *text = corpus(1000);  // large enough to be split
+    JNODE_p want = json_parse(text);
+    for (int i = 0; i < 5; i++) {
+        arena[i] = json_arena_create(0);
+        json_arena_intern(arena[i], pool);
+    }
+    root[0] = json_parse_arena(text, arena[0]);
+
+    JPARSER_p p = json_parser_create(arena[1]);
+    json_parser_feed(p, text, strlen(text));
+    root[1] = json_parser_finish(p);
+    json_parser_free(p);
+
+    size_t len = 0;
+    char *packed = json_msgpack(want, &len);
+    root[2] = json_msgpack_parse(packed, len, arena[2], NULL);
+    json_free(packed);
+
+    JTAPE_p tape = json_tape_parse(text, NULL);
+    root[3] = json_tape_to_tree(tape, 0, arena[3]);
+    json_tape_free(tape);
+
+    root[4] = json_parse_parallel(text, "/records", arena[4], 4, NULL);
+
+    size_t count = 0, after = 0;
+    json_pool_stats(pool, &count, NULL);
+    for (int i = 0; i < 5; i++) {
+        CHECK(same_tree(root[i], want), "parser %d: tree differs", i);
+        CHECK(!unpooled(root[i], pool), "parser %d: %d names not pooled", i, unpooled(root[i], pool));
+    }
+    json_pool_stats(pool, &after, NULL);
+    CHECK(count == after && count == 17, "pool: %zu names, then %zu", count, after);
+
+    /* Edits keep the trees editable, the names stay the pool's */
+    JNODE_p geo = json_detach_from_object(json_array_get(json_object_get(root[0], "records"), 3), "geo");
+    CHECK(geo && geo->name == json_pool_intern(pool, "geo"), "detached member");
+    json_delete(geo);
+    for (int i = 0; i < 5; i++)
+        json_arena_destroy(arena[i]);
+    json_pool_free(pool);
+
+    /* An arena's own pool, shared by its documents */
+    JARENA_p own = json_arena_create(0);
+    json_arena_intern(own, NULL);
+    JNODE_p x = json_parse_arena(text, own), y = json_parse_arena("{\"a long member name\": 1}", own);
+    JNODE_p first = json_array_get(json_object_get(x, "records"), 0);
+    CHECK(x && y && y->child->name == json_object_get(first, "a long member name")->name, "own pool");
+    json_arena_destroy(own);
+
+    /* Heap trees borrow pooled names */
+    pool = json_pool_create();
+    const char *name = json_pool_intern(pool, "a long member name");
+    JNODE_p obj = create_object();
+    json_add_to_object(obj, name, create_int(1), 0);
+    json_add_to_object(obj, json_pool_intern(pool, "short"), create_int(2), 0);
+    CHECK(obj->child->name == name && json_object_get(obj, "short")->value.int_val == 2, "heap tree");
+    json_delete(obj);
+    json_pool_free(pool);
+
+    json_delete(want);
+    free(text);
+}
+
+int main(void) {
+    pool_basics();
+    parsers();
+    CHECK_DONE("test_intern");
+}
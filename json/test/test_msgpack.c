@@ -0,0 +1,60 @@
+/*************************************************************************
+	> File Name: test/test_msgpack.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: MessagePack: the buffer and the sink encode the same
+	               bytes, which decode to the same tree on the heap and in
+	               an arena, and every truncated stream is refused.
+ ************************************************************************/
+
+#include "check.h"
+
+#define RECORDS 300
+
+typedef struct Sink {
+    char *buf;
+    size_t len;
+} SINK_t;
+
+static int collect(void *ctx, const char *data, size_t len) {
+    SINK_t *s = (SINK_t *)ctx;
+    char *grown = (char *)realloc(s->buf, s->len + len + 1);
+    if (!grown)
+        return 0;
+    s->buf = grown;
+    memcpy(s->buf + s->len, data, len);
+    s->len += len;
+    s->buf[s->len] = 0;
+    return 1;
+}
+
+int main(void) {
+    char *text = corpus(RECORDS);
+    JNODE_p root = json_parse(text);
+    size_t len = 0;
+    SINK_t out = {NULL, 0};
+    char *packed = json_msgpack(root, &len);
+    CHECK(packed && json_msgpack_write(root, collect, &out), "not packed");
+    CHECK(out.len == len && !memcmp(out.buf, packed, len), "buffer and sink differ");
+    for (int in_arena = 0; in_arena < 2; in_arena++) {
+        JARENA_p arena = in_arena ? json_arena_create(0) : NULL;
+        JERROR_t err;
+        JNODE_p back = json_msgpack_parse(packed, len, arena, &err);
+        CHECK(err.code == JSON_OK && same_tree(root, back), "round trip%s", in_arena ? ", arena" : "");
+        if (arena)
+            json_arena_destroy(arena);
+        else
+            json_delete(back);
+    }
+    JERROR_t err;  // every cut short stream fails, none crashes
+    for (size_t cut = 0; cut < len; cut += 1 + cut / 8) {
+        JNODE_p back = json_msgpack_parse(packed, cut, NULL, &err);
+        CHECK(!back && err.code != JSON_OK, "%zu of %zu bytes accepted", cut, len);
+        json_delete(back);
+    }
+    json_free(packed);
+    free(out.buf);
+    json_delete(root);
+    free(text);
+    CHECK_DONE("test_msgpack");
+}
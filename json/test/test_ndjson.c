@@ -0,0 +1,125 @@
+/*************************************************************************
+	> File Name: test/test_ndjson.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: NDJSON over many blocks and thread counts: records in
+	               input order, blank lines skipped, NULL for malformed
+	               lines, and the streaming form seeing each record once,
+	               in order, until the callback stops it.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+
+#include "check.h"
+
+#define LINES 40000  // a few dozen blocks
+
+/* What line i holds: 0 a record, 1 blank, 2 malformed */
+static int kind(int i) {
+    return i % 7 == 3 ? 1 : i % 13 == 5 ? 2 : 0;
+}
+
+static char *lines(size_t *len) {
+    static const char *const blank[] = {"", "   ", "\t \r"};
+    size_t cap = (size_t)LINES * 80, n = 0;
+    char *text = (char *)malloc(cap);
+    for (int i = 0; i < LINES; i++) {
+        if (kind(i) == 1)
+            n += snprintf(text + n, cap - n, "%s\n", blank[i % 3]);
+        else if (kind(i) == 2)
+            n += snprintf(text + n, cap - n, "{\"line\": %d, \"broken\": [1, 2,]}\n", i);
+        else
+            n += snprintf(text + n, cap - n, "{\"line\": %d, \"tags\": [\"x\", %d], \"s\": \"a\\nb\"}%s", i, i % 5,
+                          i % 2 ? "\r\n" : "\n");
+    }
+    if (n && text[n - 1] == '\n')
+        text[--n] = 0;  // no newline after the last record
+    *len = n;
+    return text;
+}
+
+/* Record number r is line lines_of[r] */
+static int lines_of[LINES];
+static int records;
+
+static int line_of(JNODE_p root) {
+    JNODE_p line = json_object_get(root, "line");
+    return line ? line->value.int_val : -1;
+}
+
+typedef struct Seen {
+    size_t count;
+    size_t stop_at;  // stop after this record, 0: never
+    int ordered;
+} SEEN_t;
+
+static int each(void *ctx, size_t idx, JNODE_p root) {
+    SEEN_t *seen = (SEEN_t *)ctx;
+    int line = lines_of[idx];
+    if (idx != seen->count || (kind(line) == 0 ? line_of(root) != line : root != NULL))
+        seen->ordered = 0;
+    seen->count++;
+    return !seen->stop_at || seen->count < seen->stop_at;
+}
+
+static void batch(const char *text, size_t len, int threads) {
+    JBATCH_p batch = json_ndjson_parse(text, len, threads);
+    CHECK(batch && json_batch_size(batch) == (size_t)records, "%d threads: %zu records", threads,
+          json_batch_size(batch));
+    int wrong = 0;
+    for (int r = 0; batch && r < records; r++) {
+        JNODE_p root = json_batch_get(batch, r);
+        int line = lines_of[r];
+        if (kind(line) == 0 ? line_of(root) != line : root != NULL)
+            wrong++;
+    }
+    CHECK(!wrong && !json_batch_get(batch, records), "%d threads: %d records out of place", threads, wrong);
+    json_batch_free(batch);
+}
+
+static void stream(const char *text, size_t len, const char *file, int threads) {
+    static const size_t stops[] = {0, 1, 777, 20000};
+    for (size_t s = 0; s < sizeof(stops) / sizeof(stops[0]); s++) {
+        SEEN_t seen = {0, stops[s], 1};
+        int ret = file ? json_ndjson_each_file(file, threads, each, &seen)
+                       : json_ndjson_each(text, len, threads, each, &seen);
+        size_t want = stops[s] ? stops[s] : (size_t)records;
+        CHECK(ret == (stops[s] ? -1 : 1) && seen.count == want && seen.ordered, "%d threads%s, stop at %zu: %d, "
+              "%zu records", threads, file ? ", file" : "", stops[s], ret, seen.count);
+    }
+}
+
+int main(void) {
+    size_t len = 0;
+    char *text = lines(&len);
+    for (int i = 0; i < LINES; i++)
+        if (kind(i) != 1)
+            lines_of[records++] = i;
+
+    char file[] = "/tmp/test_ndjson_XXXXXX";
+    int fd = mkstemp(file);
+    CHECK(fd >= 0 && write(fd, text, len) == (ssize_t)len, "temporary file");
+    close(fd);
+
+    static const int threads[] = {1, 2, 4, 8, 0};
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        batch(text, len, threads[t]);
+        stream(text, len, NULL, threads[t]);
+        stream(NULL, 0, file, threads[t]);
+    }
+    JBATCH_p from_file = json_ndjson_parse_file(file, 3);
+    CHECK(from_file && json_batch_size(from_file) == (size_t)records, "batch from the file");
+    json_batch_free(from_file);
+    unlink(file);
+    CHECK(!json_ndjson_parse_file(file, 0) && !json_ndjson_each_file(file, 0, each, NULL), "missing file");
+
+    JBATCH_p empty = json_ndjson_parse("\n \n\n", 4, 2);
+    SEEN_t seen = {0, 0, 1};
+    CHECK(empty && !json_batch_size(empty) && json_ndjson_each("", 0, 2, each, &seen) == 1 && !seen.count,
+          "blank input");
+    json_batch_free(empty);
+    free(text);
+    CHECK_DONE("test_ndjson");
+}
@@ -0,0 +1,100 @@
+/*************************************************************************
+	> File Name: test/test_number.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Numbers parse as strtod reads them, integers take the
+	               narrowest type that holds them, and doubles survive
+	               json_format.
+ ************************************************************************/
+
+#include <limits.h>
+#include "check.h"
+
+#define GENERATED 100000
+
+static const char *const texts[] = {
+    "0", "-0", "1", "0.1", "0.3", "2.2250738585072014e-308", "4.9e-324", "1.7976931348623157e308",
+    "9007199254740993", "123456789012345678901234567890", "1e23", "8.41e21", "5e-324", "3.14159265358979",
+    "0.000001", "1E+2", "-1.5e-10", "2.5e+300", "1e-400", "0.1e1", "-0.0", "100000000000000000000000e-4",
+    "2147483647", "2147483648", "-2147483648", "-2147483649", "9223372036854775807", "-9223372036854775808",
+    "9223372036854775808", "-9223372036854775809", "18446744073709551616",
+};
+
+/* In an array, since trailing text after a root value is not an error */
+static const char *const malformed[] = {
+    "[01]", "[1.]", "[.5]", "[-]", "[1e]", "[1e+]", "[+1]", "[0x10]", "[1.e5]", "[--1]",
+};
+
+/* Generated mantissas of up to 19 digits, so both the fast paths and the
+   strtod fallback are taken */
+static const char *generate(char *text, size_t size, unsigned *seed) {
+    unsigned a, b, e;
+    *seed = *seed * 1103515245 + 12345;
+    a = *seed >> 4;
+    *seed = *seed * 1103515245 + 12345;
+    b = *seed >> 4;
+    *seed = *seed * 1103515245 + 12345;
+    e = *seed >> 8;
+    switch (e % 4) {
+        case 0:
+            snprintf(text, size, "%u.%05ue%d", a % 100000, b % 100000, (int)(e >> 4) % 600 - 300);
+            break;
+        case 1:
+            snprintf(text, size, "%s%u%09u.%u", e & 16 ? "-" : "", a % 1000000000, b % 1000000000, e % 1000);
+            break;
+        case 2:
+            snprintf(text, size, "0.%09u%09u%u", a % 1000000000, b % 1000000000, e % 10);
+            break;
+        default:
+            snprintf(text, size, "%u%09ue%d", a % 1000000000, b % 1000000000, (int)(e >> 4) % 40 - 20);
+            break;
+    }
+    return text;
+}
+
+static void check_number(const char *num) {
+    JNODE_p node = json_parse(num);
+    CHECK(node, "%s: not parsed", num);
+    if (!node)
+        return;
+    int type = node->type & 255;
+    double want = strtod(num, NULL);
+    if (type == J_Double) {
+        double got = node->value.double_val;
+        CHECK(got == want && signbit(got) == signbit(want), "%s: %.17g, strtod %.17g", num, got, want);
+        char *out = json_format(node);
+        JNODE_p back = json_parse(out);
+        CHECK(back && (back->type & 255) == J_Double && back->value.double_val == got &&
+                  signbit(back->value.double_val) == signbit(got),
+              "%s: formatted as %s", num, out);
+        json_delete(back);
+        json_free(out);
+    } else {
+        int64_t v = type == J_Int ? node->value.int_val : node->value.int64_val;
+        CHECK(type == J_Int || type == J_Int64, "%s: type %d", num, type);
+        CHECK((type == J_Int) == (v >= INT_MIN && v <= INT_MAX), "%s: %" PRId64 " as type %d", num, v, type);
+        CHECK((double)v == want && strtoll(num, NULL, 10) == v, "%s: %" PRId64, num, v);
+    }
+    json_delete(node);
+}
+
+int main(void) {
+    char text[64];
+    unsigned seed = 12345;
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+        check_number(texts[i]);
+    for (int i = 0; i < GENERATED; i++)
+        check_number(generate(text, sizeof(text), &seed));
+    JNODE_p zero = json_parse("[-0, 0, -0.0, -0e5]");  // the sign of zero survives
+    char *out = json_format_style(zero, JSON_MINIFY);
+    CHECK(out && !strcmp(out, "[-0.0,0,-0.0,-0.0]"), "signed zeros: %s", out);
+    json_free(out);
+    json_delete(zero);
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        JERROR_t err;
+        JNODE_p node = json_parse_r(malformed[i], NULL, &err);
+        CHECK(!node && err.code != JSON_OK, "%s: accepted", malformed[i]);
+        json_delete(node);
+    }
+    CHECK_DONE("test_number");
+}
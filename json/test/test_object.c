@@ -0,0 +1,136 @@
+/*************************************************************************
+	> File Name: test/test_object.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: Member lookups through the hash index against a linear
+	               search of a shadow list, through random gets, adds,
+	               detaches and replacements with duplicate names, so
+	               backward-shift deletion has to keep the first match in
+	               insertion order.
+ ************************************************************************/
+
+#include "check.h"
+
+#define MEMBERS 4000
+#define NAMES 150
+#define STEPS 20000
+
+typedef struct Shadow {
+    char name[MEMBERS][16];
+    int id[MEMBERS];
+    int alive[MEMBERS];
+    int count, next_id, exact;
+} SHADOW_t;
+
+static SHADOW_t shadow;
+static unsigned seed = 7;
+
+static unsigned rnd(void) {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static int same_name(const char *a, const char *b) {
+    if (shadow.exact)
+        return !strcmp(a, b);
+    for (; *a && *b; a++, b++)
+        if ((*a | 32) != (*b | 32))
+            return 0;
+    return *a == *b;
+}
+
+/* First live member named so, in insertion order, -1 if none */
+static int shadow_find(const char *name) {
+    for (int i = 0; i < shadow.count; i++)
+        if (shadow.alive[i] && same_name(shadow.name[i], name))
+            return i;
+    return -1;
+}
+
+/* Few distinct names in two cases, so most are duplicates */
+static void random_name(char *name) {
+    unsigned n = rnd();
+    snprintf(name, 16, "%s%u", n & 1 ? "Key" : "key", (n >> 1) % NAMES);
+}
+
+static void add(JNODE_p obj, const char *name) {
+    int i = shadow.count++;
+    snprintf(shadow.name[i], 16, "%s", name);
+    shadow.id[i] = shadow.next_id++;
+    shadow.alive[i] = 1;
+    CHECK(json_add_int(obj, name, shadow.id[i]), "add %s", name);
+}
+
+static void check_get(JNODE_p obj, const char *name, const char *what) {
+    int i = shadow_find(name);
+    JNODE_p got = json_object_get(obj, name);
+    CHECK(i < 0 ? !got : got && got->value.int_val == shadow.id[i], "%s %s: id %d, want %d", what, name,
+          got ? got->value.int_val : -1, i < 0 ? -1 : shadow.id[i]);
+}
+
+static void run(JNODE_p obj, int exact, const char *what) {
+    char name[16];
+    memset(&shadow, 0, sizeof(shadow));
+    shadow.exact = exact;
+    json_object_case_sensitive(obj, exact);
+    for (int i = 0; i < MEMBERS / 2; i++) {
+        random_name(name);
+        add(obj, name);
+    }
+    for (int step = 0; step < STEPS; step++) {
+        random_name(name);
+        int i = shadow_find(name);
+        switch (rnd() % 5) {
+            case 0:
+                if (shadow.count < MEMBERS)
+                    add(obj, name);
+                break;
+            case 1: {
+                JNODE_p c = json_object_detach(obj, name);
+                CHECK(i < 0 ? !c : c && c->value.int_val == shadow.id[i], "%s: detach %s", what, name);
+                json_delete(c);
+                if (i >= 0)
+                    shadow.alive[i] = 0;
+                break;
+            }
+            case 2: {
+                JNODE_p node = create_int(shadow.next_id);
+                int ok = json_object_replace(obj, name, node);
+                CHECK(ok == (i >= 0), "%s: replace %s", what, name);
+                if (ok)
+                    shadow.id[i] = shadow.next_id++;
+                else
+                    json_delete(node);
+                break;
+            }
+            default:
+                check_get(obj, name, what);
+                break;
+        }
+    }
+    size_t live = 0;  // the list itself is still in insertion order
+    JNODE_p c = obj->child;
+    for (int i = 0; i < shadow.count; i++) {
+        if (!shadow.alive[i])
+            continue;
+        live++;
+        CHECK(c && c->value.int_val == shadow.id[i] && !strcmp(c->name, shadow.name[i]), "%s: order at %d", what, i);
+        c = c ? c->next : NULL;
+    }
+    CHECK(!c && json_array_size(obj) == live, "%s: %zu members, want %zu", what, json_array_size(obj), live);
+    check_get(obj, "missing", what);
+}
+
+int main(void) {
+    JNODE_p obj = create_object();
+    run(obj, 0, "heap");
+    json_delete(obj);
+    obj = create_object();
+    run(obj, 1, "heap, exact");
+    json_delete(obj);
+    JARENA_p arena = json_arena_create(0);
+    obj = json_parse_arena("{}", arena);
+    run(obj, 0, "arena");
+    json_arena_destroy(arena);
+    CHECK_DONE("test_object");
+}
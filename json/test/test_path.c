@@ -0,0 +1,73 @@
+/*************************************************************************
+	> File Name: test/test_path.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: JSON Pointers: the examples of RFC 6901 section 5, the
+	               ~0 and ~1 escapes, exact names, array indexes, the
+	               pointers that must fail, and paths through containers
+	               large enough to be indexed.
+ ************************************************************************/
+
+#include "check.h"
+
+static const char *const rfc =
+    "{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, \"g|h\": 4, \"i\\\\j\": 5,"
+    " \"k\\\"l\": 6, \" \": 7, \"m~n\": 8, \"~1\": 9, \"a\": {\"id\": 10}, \"b\": {\"id\": 11}}";
+
+/* The pointer resolves to a node formatting as want, or to nothing */
+static void resolves(JNODE_p root, const char *pointer, const char *want) {
+    JNODE_p node = json_pointer(root, pointer);
+    char *got = node ? json_format_style(node, JSON_MINIFY) : NULL;
+    CHECK(want ? got && !strcmp(got, want) : !node, "\"%s\": %s, want %s", pointer, got ? got : "nothing",
+          want ? want : "nothing");
+    json_free(got);
+}
+
+int main(void) {
+    JNODE_p root = json_parse(rfc);
+    resolves(root, "/foo", "[\"bar\",\"baz\"]");
+    resolves(root, "/foo/0", "\"bar\"");
+    resolves(root, "/foo/1", "\"baz\"");
+    resolves(root, "/", "0");
+    resolves(root, "/a~1b", "1");
+    resolves(root, "/c%d", "2");
+    resolves(root, "/e^f", "3");
+    resolves(root, "/g|h", "4");
+    resolves(root, "/i\\j", "5");
+    resolves(root, "/k\"l", "6");
+    resolves(root, "/ ", "7");
+    resolves(root, "/m~0n", "8");
+    resolves(root, "/~01", "9");  // ~0 first, then the 1
+    resolves(root, "/a/id", "10");
+    resolves(root, "/b/id", "11");
+    JNODE_p whole = json_pointer(root, "");
+    CHECK(whole == root, "\"\": not the root");
+
+    static const char *const fail[] = {
+        "foo", "/~2", "/~", "/m~n", "/foo/01", "/foo/-", "/foo/2", "/foo/-1", "/foo/bar", "/FOO", "/foo/0/x",
+        "/a/id/x", "/a~1b/0", "/missing",
+    };
+    for (size_t i = 0; i < sizeof(fail) / sizeof(fail[0]); i++)
+        resolves(root, fail[i], NULL);
+    CHECK(!json_path_compile("no slash") && !json_path_compile("/~x"), "malformed pointers compiled");
+
+    /* One compiled path across documents, through indexed containers */
+    JPATH_p path = json_path_compile("/records/1999/geo/lat");
+    char *text = corpus(2000);
+    JARENA_p arena = json_arena_create(0);
+    JNODE_p a = json_parse(text), b = json_parse_arena(text, arena);
+    JNODE_p lat_a = json_path_get(a, path), lat_b = json_path_get(b, path);
+    CHECK(lat_a && lat_b && lat_a->value.double_val == 1999 % 90 + 0.5 && lat_b->value.double_val ==
+              lat_a->value.double_val, "indexed path");
+    json_array_get(json_object_get(a, "records"), 0);  // with the array view built
+    CHECK(json_path_get(a, path) == lat_a, "indexed path, view built");
+    json_path_free(path);
+    resolves(a, "/records/2000", NULL);
+    resolves(a, "/records/0/a long member name", "\"a string past seven bytes\"");
+
+    json_delete(a);
+    json_arena_destroy(arena);
+    free(text);
+    json_delete(root);
+    CHECK_DONE("test_path");
+}
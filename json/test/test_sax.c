@@ -0,0 +1,205 @@
+/*************************************************************************
+	> File Name: test/test_sax.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: The event parser against json_parse: a handler builds
+	               the tree back from the events, taking some values as
+	               SAX_TREE subtrees, and must end with the tree
+	               json_parse gives, from text, a FILE and a descriptor,
+	               across window refills and tokens larger than the
+	               window. Also streams, stops and malformed input.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+
+#include "check.h"
+
+/* Which values are taken as trees */
+enum { TREE_NONE, TREE_KEYS, TREE_RECORDS, TREE_ROOT };
+
+typedef struct Rebuild {
+    JNODE_p out;          // every value of the input, in order
+    JNODE_p stack[64];    // open containers, innermost last
+    int depth;
+    char *key;            // name of the member whose value comes next
+    int mode;
+    long scalars, stop_after;  // stop_after 0: never
+} REBUILD_t;
+
+static int add(REBUILD_t *b, JNODE_p node) {
+    JNODE_p parent = b->depth ? b->stack[b->depth - 1] : b->out;
+    if ((parent->type & 255) != J_Object || node->name)
+        return json_add_to_array(parent, node);  // trees come named
+    return json_add_to_object(parent, b->key, node, 1);
+}
+
+static int start(REBUILD_t *b, JNODE_p node) {
+    int tree = (b->mode == TREE_ROOT && !b->depth) || (b->mode == TREE_RECORDS && b->depth == 2);
+    if (tree) {
+        json_delete(node);
+        return SAX_TREE;
+    }
+    if (!add(b, node) || b->depth == 64)
+        return SAX_STOP;
+    b->stack[b->depth++] = node;
+    return SAX_GO;
+}
+
+static int start_object(void *ctx) {
+    return start((REBUILD_t *)ctx, create_object());
+}
+
+static int start_array(void *ctx) {
+    return start((REBUILD_t *)ctx, create_array());
+}
+
+static int end(void *ctx) {
+    ((REBUILD_t *)ctx)->depth--;
+    return SAX_GO;
+}
+
+static int key(void *ctx, const char *name, size_t len) {
+    REBUILD_t *b = (REBUILD_t *)ctx;
+    if (strlen(name) != len)
+        return SAX_STOP;
+    free(b->key);
+    b->key = (char *)malloc(len + 1);
+    memcpy(b->key, name, len + 1);
+    if (b->mode == TREE_KEYS && (!strcmp(name, "geo") || !strcmp(name, "tags") || !strcmp(name, "id")))
+        return SAX_TREE;
+    return SAX_GO;
+}
+
+static int scalar(void *ctx, const JNODE_t *value) {
+    REBUILD_t *b = (REBUILD_t *)ctx;
+    JNODE_p node = NULL;
+    if (b->depth && (b->stack[b->depth - 1]->type & 255) == J_Object && strcmp(value->name, b->key))
+        return SAX_STOP;  // a member named other than its key
+    switch (value->type & 255) {
+        case J_True: node = create_true(); break;
+        case J_False: node = create_false(); break;
+        case J_Int: node = create_int(value->value.int_val); break;
+        case J_Int64: node = create_int64(value->value.int64_val); break;
+        case J_Double: node = create_double(value->value.double_val); break;
+        case J_String: node = create_string(value->value.string_val); break;
+        default: node = create_null(); break;
+    }
+    if (!add(b, node)) {
+        json_delete(node);
+        return SAX_STOP;
+    }
+    return b->stop_after && ++b->scalars == b->stop_after ? SAX_STOP : SAX_GO;
+}
+
+static int tree(void *ctx, JNODE_p node) {
+    REBUILD_t *b = (REBUILD_t *)ctx;
+    if (!add(b, node)) {
+        json_delete(node);
+        return SAX_STOP;
+    }
+    return SAX_GO;
+}
+
+static const JSAX_t handler = {start_object, end, start_array, end, key, scalar, tree};
+
+/* The input read from source 0 text, 1 FILE, 2 descriptor. Returns what
+   the parser did, out gets the values rebuilt. */
+static int rebuild(const char *text, int source, int mode, long stop_after, JNODE_p *out) {
+    REBUILD_t b;
+    int ret = 0;
+    memset(&b, 0, sizeof(b));
+    b.out = create_array();
+    b.mode = mode;
+    b.stop_after = stop_after;
+    if (!source) {
+        ret = json_sax_parse(text, &handler, &b);
+    } else {
+        FILE *fp = tmpfile();
+        fputs(text, fp);
+        fflush(fp);
+        rewind(fp);
+        if (source == 1) {
+            ret = json_sax_parse_file(fp, &handler, &b);
+        } else {
+            lseek(fileno(fp), 0, SEEK_SET);
+            ret = json_sax_parse_fd(fileno(fp), &handler, &b);
+        }
+        fclose(fp);
+    }
+    free(b.key);
+    *out = b.out;
+    return ret;
+}
+
+/* Each value of want parsed on its own, in an array */
+static void same_events(const char *text, const char *want, const char *what) {
+    JNODE_p expect = json_parse(want);
+    for (int source = 0; source < 3; source++) {
+        for (int mode = TREE_NONE; mode <= TREE_ROOT; mode++) {
+            JNODE_p got = NULL;
+            int ret = rebuild(text, source, mode, 0, &got);
+            CHECK(ret == 1 && same_tree(got, expect), "%s: source %d, trees %d, returned %d", what, source, mode,
+                  ret);
+            json_delete(got);
+        }
+    }
+    json_delete(expect);
+}
+
+/* A document in brackets, the form same_events compares with */
+static char *bracketed(const char *text) {
+    size_t len = strlen(text);
+    char *out = (char *)malloc(len + 3);
+    out[0] = '[';
+    memcpy(out + 1, text, len);
+    strcpy(out + 1 + len, "]");
+    return out;
+}
+
+int main(void) {
+    char *text = corpus(2000);  // several windows
+    char *want = bracketed(text);
+    same_events(text, want, "corpus");
+    free(want);
+    free(text);
+
+    size_t big = 3 * 65536 + 17;  // tokens larger than the window
+    text = (char *)malloc(big * 2 + 64);
+    strcpy(text, "{\"");
+    memset(text + 2, 'k', big);
+    strcpy(text + 2 + big, "\": [\"");
+    size_t at = strlen(text);
+    for (size_t i = 0; i + 1 < big; i += 2)
+        memcpy(text + at + i, "\\n", 2);
+    strcpy(text + at + big - 1, "\", 1]}");
+    want = bracketed(text);
+    same_events(text, want, "large tokens");
+    free(want);
+    free(text);
+
+    same_events("1 \"two\"\n[3]\n\n{\"four\": {\"id\": 4}}\n  null -0.5 true", "[1, \"two\", [3], {\"four\": "
+                "{\"id\": 4}}, null, -0.5, true]", "stream");
+    same_events("  \n ", "[]", "empty");
+
+    JNODE_p got = NULL;  // stopped after the third scalar, nothing kept
+    for (int source = 0; source < 3; source++) {
+        int ret = rebuild("[1, [2, 3, 4], 5] 6", source, TREE_NONE, 3, &got);
+        JNODE_p expect = json_parse("[[1, [2, 3]]]");
+        CHECK(ret == -1 && same_tree(got, expect), "stop: source %d returned %d", source, ret);
+        json_delete(expect);
+        json_delete(got);
+    }
+
+    static const char *const bad[] = {"[1,]", "{\"a\" 1}", "{\"a\": tru}", "[\"open", "{\"a\": {\"id\": [}}", "1 ]",
+                                      "[1 2]", "{1: 2}"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        for (int mode = TREE_NONE; mode <= TREE_ROOT; mode++) {
+            int ret = rebuild(bad[i], 0, mode, 0, &got);
+            CHECK(ret == 0, "bad %zu: trees %d, returned %d", i, mode, ret);
+            json_delete(got);
+        }
+    }
+    CHECK_DONE("test_sax");
+}
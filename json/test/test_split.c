@@ -0,0 +1,124 @@
+/*************************************************************************
+	> File Name: test/test_split.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: json_parse_parallel against json_parse_r: the same tree
+	               for every pointer and thread count, on the heap, in an
+	               arena and with interned names, the same error for
+	               broken text, and arrays that stay usable afterwards.
+ ************************************************************************/
+
+#include "check.h"
+
+#define RECORDS 1000     // past the 256KB the split starts at
+#define ELEMENTS 20000   // the same for the root array
+
+/* Same result from both, then both take an append the same way */
+static void compare(const char *text, const char *pointer, int threads, int valid, const char *what) {
+    JERROR_t e1, e2;
+    for (int alloc = 0; alloc < 3; alloc++) {  // heap, arena, arena with a pool
+        JARENA_p a1 = alloc ? json_arena_create(0) : NULL, a2 = alloc ? json_arena_create(0) : NULL;
+        if (alloc == 2) {
+            json_arena_intern(a1, NULL);
+            json_arena_intern(a2, NULL);
+        }
+        JNODE_p want = json_parse_r(text, a1, &e1);
+        JNODE_p got = json_parse_parallel(text, pointer, a2, threads, &e2);
+        CHECK(valid ? got && same_tree(got, want) : !got && !want, "%s, %s, %d threads, alloc %d", what,
+              pointer ? pointer : "NULL", threads, alloc);
+        CHECK(e1.code == e2.code && e1.offset == e2.offset && e1.line == e2.line && e1.column == e2.column,
+              "%s, %d threads: errors differ, %d at %zu against %d at %zu", what, threads, e1.code, e1.offset,
+              e2.code, e2.offset);
+
+        JNODE_p x = json_pointer(want, pointer ? pointer : ""), y = json_pointer(got, pointer ? pointer : "");
+        if (!alloc && x && y && (x->type & 255) == J_Array && (y->type & 255) == J_Array) {
+            size_t n = json_array_size(x);
+            CHECK(json_array_size(y) == n && n && same_tree(json_array_get(y, n - 1), json_array_get(x, n - 1)),
+                  "%s, %d threads: size or last element", what, threads);
+            json_add_to_array(x, create_string("appended"));
+            json_add_to_array(y, create_string("appended"));
+            json_del_from_array(x, 0);
+            json_del_from_array(y, 0);
+            CHECK(same_tree(got, want), "%s, %d threads: edited arrays differ", what, threads);
+        }
+        if (alloc) {
+            json_arena_destroy(a1);
+            json_arena_destroy(a2);
+        } else {
+            json_delete(want);
+            json_delete(got);
+        }
+    }
+}
+
+/* Elements of every kind, with brackets and commas inside strings */
+static char *root_array(void) {
+    size_t cap = (size_t)ELEMENTS * 64, n = 0;
+    char *text = (char *)malloc(cap);
+    n += snprintf(text + n, cap - n, "[");
+    for (int i = 0; i < ELEMENTS; i++) {
+        const char *sep = i ? ",\n" : "\n";
+        switch (i % 6) {
+            case 0: n += snprintf(text + n, cap - n, "%s%d", sep, i); break;
+            case 1: n += snprintf(text + n, cap - n, "%s\"],[{\\\"%d\\\"}\"", sep, i); break;
+            case 2: n += snprintf(text + n, cap - n, "%s[[%d, {}], [], [\"]\"]]", sep, i); break;
+            case 3:
+                n += snprintf(text + n, cap - n, "%s{\"k\": {\"a\": [%d.5e-3, null]}, \"s\": \"}\"}", sep, i);
+                break;
+            case 4: n += snprintf(text + n, cap - n, "%s%s", sep, i % 4 ? "true" : "false"); break;
+            default: n += snprintf(text + n, cap - n, "%s\"a string past the inline limit %d\"", sep, i); break;
+        }
+    }
+    snprintf(text + n, cap - n, "\n]");
+    return text;
+}
+
+/* text with its first from after the middle replaced by to */
+static char *cut(const char *text, const char *from, const char *to) {
+    size_t len = strlen(text);
+    const char *at = strstr(text + len / 2, from);
+    if (!at)
+        return NULL;
+    size_t head = at - text, f = strlen(from), t = strlen(to);
+    char *out = (char *)malloc(len + t + 1);
+    memcpy(out, text, head);
+    memcpy(out + head, to, t);
+    strcpy(out + head + t, at + f);
+    return out;
+}
+
+int main(void) {
+    char *records = corpus(RECORDS), *array = root_array();
+    static const int threads[] = {2, 3, 8};
+    CHECK(strlen(records) > 256 << 10 && strlen(array) > 256 << 10, "too short to be split");
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        compare(array, NULL, threads[t], 1, "root array");
+        compare(array, "", threads[t], 1, "root array");
+        compare(records, "/records", threads[t], 1, "records");
+        compare(records, "/records/7/tags", threads[t], 1, "small array");
+        compare(records, "/version", threads[t], 1, "not an array");
+        compare(records, "/missing", threads[t], 1, "missing");
+        compare(records, "/records/x", threads[t], 1, "bad pointer");
+
+        static const char *const cuts[][2] = {
+            {"\"ok\": true", "\"ok\": tru"}, {"\"e\": []", "\"e\": [,]"}, {"}}", "}]"}, {"\"nil\": null", "\"nil\" 1"},
+        };
+        for (size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); c++) {
+            char *bad = cut(records, cuts[c][0], cuts[c][1]);
+            CHECK(bad, "%s: not in the corpus", cuts[c][0]);
+            if (bad)
+                compare(bad, "/records", threads[t], 0, cuts[c][1]);
+            free(bad);
+        }
+        char *bad = cut(array, "[[", "[[,");
+        compare(bad, NULL, threads[t], 0, "broken root array");
+        free(bad);
+        bad = cut(records, "", "");  // a copy
+        bad[strlen(bad) * 2 / 3] = 0;
+        compare(bad, "/records", threads[t], 0, "truncated");
+        free(bad);
+    }
+    free(records);
+    free(array);
+    CHECK_DONE("test_split");
+}
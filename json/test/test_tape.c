@@ -0,0 +1,158 @@
+/*************************************************************************
+	> File Name: test/test_tape.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: The tape, built from a tree and from text, gives the
+	               same tree back, and its accessors reach the values the
+	               tree holds. So does a tape saved as an image and mapped
+	               back, and a corrupt image is read without crashing.
+ ************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <unistd.h>
+#include "check.h"
+
+#define RECORDS 300
+#define CORRUPTIONS 2000
+
+/* Walks the records on the tape against the same records in the tree */
+static void navigate(JTAPE_p tape, JNODE_p root) {
+    size_t records = json_tape_get(tape, 0, "records");
+    CHECK(json_tape_type(tape, records) == J_Array, "records: type %d", json_tape_type(tape, records));
+    CHECK(json_tape_size(tape, records) == RECORDS, "records: %zu", json_tape_size(tape, records));
+    CHECK(json_tape_get(tape, 0, "Records") == JTAPE_END, "names compare exactly");
+    CHECK(json_tape_index(tape, records, RECORDS) == JTAPE_END, "index past the end");
+
+    JNODE_p node = json_pointer(root, "/records")->child;
+    size_t at = json_tape_first(tape, records), n = 0;
+    for (; at != JTAPE_END; at = json_tape_next(tape, at), node = node->next, n++) {
+        CHECK(at == json_tape_index(tape, records, n), "record %zu: index", n);
+        size_t id = json_tape_get(tape, at, "id"), x = json_tape_get(tape, at, "x");
+        size_t big = json_tape_get(tape, at, "big"), name = json_tape_get(tape, at, "name");
+        CHECK(json_tape_int64(tape, id) == json_object_get(node, "id")->value.int_val, "record %zu: id", n);
+        CHECK(json_tape_double(tape, x) == json_object_get(node, "x")->value.double_val, "record %zu: x", n);
+        CHECK(json_tape_int64(tape, big) == json_object_get(node, "big")->value.int64_val, "record %zu: big", n);
+        size_t len = 0;
+        const char *s = json_tape_string(tape, name, &len);
+        CHECK(s && len == strlen(s) && !strcmp(s, json_object_get(node, "name")->value.string_val),
+              "record %zu: name", n);
+        CHECK(!strcmp(json_tape_name(tape, name), "name"), "record %zu: member name", n);
+        size_t members = 0, last = JTAPE_END;  // iteration ends where skip says the record does
+        for (size_t m = json_tape_first(tape, at); m != JTAPE_END; m = json_tape_next(tape, m))
+            members++, last = m;
+        CHECK(members == json_tape_size(tape, at) && json_tape_skip(tape, last) + 1 == json_tape_skip(tape, at),
+              "record %zu: %zu members", n, members);
+    }
+    CHECK(n == RECORDS && !node, "%zu records iterated", n);
+}
+
+static void image(JNODE_p root) {
+    char path[] = "/tmp/test_tape_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "image: no temporary file");
+    if (fd < 0)
+        return;
+    close(fd);
+    CHECK(json_save_image(root, path), "image: not saved");
+    JTAPE_p image = json_open_image(path);
+    CHECK(image, "image: not opened");
+    if (image) {
+        JNODE_p back = json_tape_to_tree(image, 0, NULL);
+        CHECK(same_tree(root, back), "image: round trip");
+        navigate(image, root);
+        json_delete(back);
+        json_tape_free(image);
+    }
+    unlink(path);
+}
+
+/* Everything reachable from at, through every accessor */
+static size_t walk(JTAPE_p tape, size_t at, int depth) {
+    size_t len = 0, seen = 1;
+    json_tape_int64(tape, at);
+    json_tape_double(tape, at);
+    json_tape_string(tape, at, &len);
+    json_tape_name(tape, at);
+    json_tape_size(tape, at);
+    json_tape_get(tape, at, "id");
+    json_tape_index(tape, at, 2);
+    json_tape_skip(tape, at);
+    for (size_t c = json_tape_first(tape, at); c != JTAPE_END && depth < 64; c = json_tape_next(tape, c))
+        seen += walk(tape, c, depth + 1);
+    return seen;
+}
+
+/* Random bytes of a small image overwritten: opening and reading it
+   must not crash or read past the mapping */
+static void corrupt(void) {
+    char path[] = "/tmp/test_tape_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0, "corrupt: no temporary file");
+    if (fd < 0)
+        return;
+    close(fd);
+    char *text = corpus(2);
+    JNODE_p small = json_parse(text);
+    CHECK(json_save_image(small, path), "corrupt: not saved");
+    FILE *fp = fopen(path, "rb");
+    static char good[16384], bad[16384];
+    size_t len = fp ? fread(good, 1, sizeof(good), fp) : 0, head = 32;
+    if (fp)
+        fclose(fp);
+    CHECK(len > head && len < sizeof(good), "corrupt: image of %zu bytes", len);
+    unsigned seed = 1;
+    for (int i = 0; i < CORRUPTIONS && len > head; i++) {
+        memcpy(bad, good, len);
+        for (int n = 1 + i % 4; n; n--) {
+            seed = seed * 1103515245 + 12345;
+            size_t at = head + (seed >> 8) % (len - head);
+            seed = seed * 1103515245 + 12345;
+            bad[at] = (char)(i % 3 ? seed >> 16 : bad[at] ^ (1 << (seed >> 16) % 8));
+        }
+        fp = fopen(path, "wb");
+        fwrite(bad, 1, len, fp);
+        fclose(fp);
+        JTAPE_p tape = json_open_image(path);
+        if (!tape)
+            continue;
+        walk(tape, 0, 0);
+        JARENA_p arena = json_arena_create(0);
+        json_delete(json_tape_to_tree(tape, 0, NULL));
+        json_tape_to_tree(tape, 0, arena);
+        json_arena_destroy(arena);
+        json_tape_free(tape);
+    }
+    unlink(path);
+    json_delete(small);
+    free(text);
+}
+
+int main(void) {
+    char *text = corpus(RECORDS);
+    JNODE_p root = json_parse(text);
+    JTAPE_p from_tree = json_tape_from_tree(root);
+    JTAPE_p from_text = json_tape_parse(text, NULL);
+    CHECK(from_tree && from_text, "no tape");
+    if (from_tree && from_text) {
+        JNODE_p a = json_tape_to_tree(from_tree, 0, NULL);
+        JARENA_p arena = json_arena_create(0);
+        JNODE_p b = json_tape_to_tree(from_text, 0, arena);
+        CHECK(same_tree(root, a) && same_tree(root, b), "round trip");
+        navigate(from_tree, root);
+        navigate(from_text, root);
+        image(root);
+        corrupt();
+        json_delete(a);
+        json_arena_destroy(arena);
+    }
+    JERROR_t err;
+    JTAPE_p bad = json_tape_parse("{\"a\": [1, 2}", &err);
+    CHECK(!bad && err.code != JSON_OK, "malformed text taped");
+    json_tape_free(bad);
+    json_tape_free(from_tree);
+    json_tape_free(from_text);
+    json_delete(root);
+    free(text);
+    CHECK_DONE("test_tape");
+}
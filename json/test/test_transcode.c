@@ -0,0 +1,78 @@
+/*************************************************************************
+	> File Name: test/test_transcode.c
+	> Author: racle
+	> Mail: racleray@qq.com
+	> Description: The transcoder against json_format_style: json_format
+	               text fed in chunks of several sizes comes out as the
+	               tree formatted in the same layout, and malformed text
+	               fails.
+ ************************************************************************/
+
+#include "check.h"
+
+#define RECORDS 300
+
+typedef struct Sink {
+    char *buf;
+    size_t len;
+} SINK_t;
+
+static int collect(void *ctx, const char *data, size_t len) {
+    SINK_t *s = (SINK_t *)ctx;
+    char *grown = (char *)realloc(s->buf, s->len + len + 1);
+    if (!grown)
+        return 0;
+    s->buf = grown;
+    memcpy(s->buf + s->len, data, len);
+    s->len += len;
+    s->buf[s->len] = 0;
+    return 1;
+}
+
+/* The text fed in chunks of size, out.buf NULL or partial on failure */
+static int transcode(const char *text, int indent, size_t size, SINK_t *out) {
+    size_t len = strlen(text);
+    JXCODE_p x = json_transcoder_create(indent, collect, out);
+    int ok = 1;
+    for (size_t at = 0; ok && at < len; at += size)
+        ok = json_transcoder_feed(x, text + at, len - at < size ? len - at : size);
+    ok = json_transcoder_finish(x) && ok;
+    json_transcoder_free(x);
+    return ok;
+}
+
+int main(void) {
+    static const int indents[] = {JSON_MINIFY, JSON_TABS, 1, 4};
+    static const size_t sizes[] = {1, 2, 3, 7, 64, 4096};
+    char *corpus_text = corpus(RECORDS);
+    JNODE_p root = json_parse(corpus_text);
+    char *text = json_format(root);
+    for (size_t i = 0; i < sizeof(indents) / sizeof(indents[0]); i++) {
+        char *want = json_format_style(root, indents[i]);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            SINK_t out = {NULL, 0};
+            int ok = transcode(text, indents[i], sizes[s], &out);
+            CHECK(ok && out.buf && !strcmp(out.buf, want), "indent %d, chunks of %zu", indents[i], sizes[s]);
+            free(out.buf);
+        }
+        json_free(want);
+    }
+
+    SINK_t out = {NULL, 0};  // a sequence of documents, one per line
+    CHECK(transcode("{\"a\": 1}\n\n[1, 2]  \"s\" 3", JSON_MINIFY, 1, &out) && out.buf &&
+              !strcmp(out.buf, "{\"a\":1}\n[1,2]\n\"s\"\n3"),
+          "sequence: %s", out.buf ? out.buf : "(nothing)");
+    free(out.buf);
+    static const char *const bad[] = {"{\"a\":1,}", "[1 2]", "{\"a\" 1}", "[1,", "\"open", "tru", "]"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        out.buf = NULL, out.len = 0;
+        CHECK(!transcode(bad[i], JSON_MINIFY, 1, &out), "%s: accepted", bad[i]);
+        free(out.buf);
+    }
+    CHECK(!json_transcoder_create(-2, collect, &out) && !json_format_style(root, -2), "indent -2 accepted");
+
+    json_free(text);
+    json_delete(root);
+    free(corpus_text);
+    CHECK_DONE("test_transcode");
+}